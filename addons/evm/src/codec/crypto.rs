@@ -6,12 +6,15 @@ use alloy::{
 use alloy_signer_local::{coins_bip39::English, LocalSigner, MnemonicBuilder};
 use hmac::digest::generic_array::GenericArray;
 use libsecp256k1::{recover, Message, RecoveryId, Signature};
+use txtx_addon_kit::crypto::{cached_secret_key_from_mnemonic, SecretBytes};
 use txtx_addon_kit::hex;
+use txtx_addon_kit::types::run_resources::RunResources;
 
 use crate::constants::DEFAULT_DERIVATION_PATH;
 
 pub type SecretKeySigner = LocalSigner<SigningKey>;
 pub fn mnemonic_to_secret_key_signer(
+    run_resources: &RunResources,
     mnemonic: &str,
     derivation_path: Option<&str>,
     is_encrypted: Option<bool>,
@@ -22,18 +25,33 @@ pub fn mnemonic_to_secret_key_signer(
     }
     let derivation_path = derivation_path.unwrap_or(DEFAULT_DERIVATION_PATH);
 
-    let mut mnemonic_builder = MnemonicBuilder::<English>::default()
-        .phrase(mnemonic)
-        .derivation_path(derivation_path)
-        .map_err(|e| format!("failed to instantiate secret key signer from mnemonic: {e}"))?;
+    // the key is derived once per run, then rebuilt from its cached bytes
+    let secret_key = cached_secret_key_from_mnemonic(
+        run_resources,
+        "evm",
+        mnemonic,
+        derivation_path,
+        password,
+        || {
+            let mut mnemonic_builder = MnemonicBuilder::<English>::default()
+                .phrase(mnemonic)
+                .derivation_path(derivation_path)
+                .map_err(|e| {
+                    format!("failed to instantiate secret key signer from mnemonic: {e}")
+                })?;
 
-    if let Some(password) = password {
-        mnemonic_builder = mnemonic_builder.password(password)
-    }
-    let signer = mnemonic_builder
-        .build()
-        .map_err(|e| format!("failed to build secret key signer from mnemonic: {e}"))?;
-    Ok(signer)
+            if let Some(password) = password {
+                mnemonic_builder = mnemonic_builder.password(password)
+            }
+            let signer = mnemonic_builder
+                .build()
+                .map_err(|e| format!("failed to build secret key signer from mnemonic: {e}"))?;
+            Ok(SecretBytes::new(signer.credential().to_bytes().to_vec()))
+        },
+    )?;
+    let signing_key = SigningKey::from_slice(&secret_key)
+        .map_err(|e| format!("failed to generate signing key from secret key: {e}"))?;
+    Ok(SecretKeySigner::from_signing_key(signing_key))
 }
 
 pub fn secret_key_to_secret_key_signer(secret_key: &Vec<u8>) -> Result<SecretKeySigner, String> {
@@ -395,6 +395,7 @@ impl CommandImplementation for SignEvmContractCall {
         background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let construct_did = construct_did.clone();
         let spec = spec.clone();
@@ -404,6 +405,7 @@ impl CommandImplementation for SignEvmContractCall {
         let background_tasks_uuid = background_tasks_uuid.clone();
         let supervision_context = supervision_context.clone();
         let cloud_service_context = cloud_service_context.clone();
+        let auth_context = auth_context.clone();
 
         let future = async move {
             let mut result = CommandExecutionResult::new();
@@ -427,6 +429,7 @@ impl CommandImplementation for SignEvmContractCall {
                 &background_tasks_uuid,
                 &supervision_context,
                 &cloud_service_context,
+                &auth_context,
             )?
             .await?;
 
@@ -439,7 +442,7 @@ impl CommandImplementation for SignEvmContractCall {
 }
 
 #[cfg(not(feature = "wasm"))]
-async fn build_unsigned_contract_call(
+pub async fn build_unsigned_contract_call(
     signer_state: &ValueStore,
     _spec: &CommandSpecification,
     values: &ValueStore,
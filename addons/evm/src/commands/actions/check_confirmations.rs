@@ -1,3 +1,8 @@
+use std::future::Future;
+use std::time::Duration;
+
+use tokio::sync::watch;
+use tokio::time::{sleep, timeout};
 use txtx_addon_kit::types::cloud_interface::CloudServiceContext;
 use txtx_addon_kit::types::commands::{CommandExecutionFutureResult, PreCommandSpecification};
 use txtx_addon_kit::types::frontend::LogDispatcher;
@@ -12,7 +17,11 @@ use txtx_addon_kit::types::{
 };
 use txtx_addon_kit::uuid::Uuid;
 
-use crate::constants::{DEFAULT_CONFIRMATIONS_NUMBER, RPC_API_URL};
+use crate::constants::{DEFAULT_CONFIRMATIONS_NUMBER, RPC_API_URL, RPC_WS_URL};
+
+/// Time awaited for a new head notification before polling the chain head, in case
+/// notifications are lost
+const NEW_HEAD_TIMEOUT: Duration = Duration::from_secs(30);
 
 lazy_static! {
     pub static ref CHECK_CONFIRMATIONS: PreCommandSpecification = define_command! {
@@ -37,6 +46,13 @@ lazy_static! {
                     tainting: false,
                     internal: false
                 },
+                rpc_ws_url: {
+                    documentation: "The websocket URL (ws:// or wss://) of the EVM API. When provided, new blocks are awaited with a `newHeads` subscription instead of polling.",
+                    typing: Type::string(),
+                    optional: true,
+                    tainting: false,
+                    internal: false
+                },
                 chain_id: {
                     documentation: "The chain ID of the network to check the transaction on.",
                     typing: Type::integer(),
@@ -126,6 +142,7 @@ impl CommandImplementation for CheckEvmConfirmations {
         _background_tasks_uuid: &Uuid,
         _supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         use alloy_chains::{Chain, ChainKind};
         use txtx_addon_kit::{
@@ -139,7 +156,7 @@ impl CommandImplementation for CheckEvmConfirmations {
                 ADDRESS_ABI_MAP, ALREADY_DEPLOYED, CHAIN_ID, CONTRACT_ADDRESS, LOGS, RAW_LOGS,
                 TX_HASH,
             },
-            rpc::EvmRpc,
+            rpc::{new_heads, EvmRpc},
             typing::{EvmValue, RawLog},
         };
 
@@ -177,6 +194,8 @@ impl CommandImplementation for CheckEvmConfirmations {
 
         let tx_hash_bytes = inputs.get_expected_buffer_bytes(TX_HASH)?;
         let rpc_api_url = inputs.get_expected_string(RPC_API_URL)?.to_owned();
+        let rpc_ws_url = inputs.get_string(RPC_WS_URL).map(|url| url.to_string());
+        let run_resources = auth_context.run_resources.clone();
 
         let progress_symbol = ["|", "/", "-", "\\", "|", "/", "-", "\\"];
 
@@ -194,9 +213,20 @@ impl CommandImplementation for CheckEvmConfirmations {
 
             let backoff_ms = 500;
 
-            let rpc = EvmRpc::new(&rpc_api_url).map_err(|e| diagnosed_error!("{e}"))?;
+            let rpc = EvmRpc::for_run(&run_resources, &rpc_api_url)
+                .map_err(|e| diagnosed_error!("{e}"))?;
+            let mut heads = match rpc_ws_url {
+                Some(rpc_ws_url) => match new_heads(&run_resources, &rpc_ws_url).await {
+                    Ok(heads) => Some(heads),
+                    Err(e) => {
+                        logger.warn("Websocket", format!("{}, polling for new blocks instead", e));
+                        None
+                    }
+                },
+                None => None,
+            };
 
-            let mut tx_inclusion_block = u64::MAX - confirmations_required as u64;
+            let mut tx_inclusion_block;
             let mut current_block = 0;
             let mut previous_block = 0;
             let _receipt = loop {
@@ -206,7 +236,7 @@ impl CommandImplementation for CheckEvmConfirmations {
                     diagnosed_error!("failed to verify transaction {}: {}", tx_hash, e)
                 })?
                 else {
-                    sleep_ms(backoff_ms * 10);
+                    sleep(Duration::from_millis(backoff_ms * 10)).await;
                     continue;
                 };
                 let Some(block_number) = receipt.block_number else {
@@ -218,14 +248,14 @@ impl CommandImplementation for CheckEvmConfirmations {
                         ),
                     );
 
-                    sleep_ms(backoff_ms);
+                    sleep(Duration::from_millis(backoff_ms)).await;
                     continue;
                 };
                 if current_block == 0 {
-                    tx_inclusion_block = block_number;
                     current_block = block_number;
                     previous_block = block_number;
                 }
+                tx_inclusion_block = block_number;
 
                 if !receipt.status() {
                     let diag = match rpc.get_transaction_return_value(&tx_hash_bytes).await {
@@ -270,15 +300,24 @@ impl CommandImplementation for CheckEvmConfirmations {
 
                 if current_block >= tx_inclusion_block + confirmations_required as u64 {
                     break receipt;
-                } else {
-                    let block = rpc.get_block_number().await.unwrap_or(current_block);
+                }
+                // only the chain head is followed until the confirmations are reached, the receipt
+                // is then fetched again to check that the transaction was not reorged out
+                while current_block < tx_inclusion_block + confirmations_required as u64 {
+                    let block = next_head(
+                        &mut heads,
+                        current_block,
+                        Duration::from_millis(backoff_ms),
+                        || rpc.get_block_number(),
+                    )
+                    .await;
                     // only send updates when the mined block is actually updated, so we're not spamming with updates every 500ms
                     if previous_block != block {
                         let _ = logger.pending_info(
                             "Pending",
                             format!(
                                 "{}/{} blocks confirmed for Tx 0x{} on chain {}",
-                                current_block - tx_inclusion_block,
+                                block.saturating_sub(tx_inclusion_block),
                                 confirmations_required,
                                 tx_hash,
                                 chain_name
@@ -287,9 +326,6 @@ impl CommandImplementation for CheckEvmConfirmations {
                         previous_block = block.clone();
                     }
                     current_block = block;
-
-                    sleep_ms(backoff_ms);
-                    continue;
                 }
             };
 
@@ -310,7 +346,78 @@ impl CommandImplementation for CheckEvmConfirmations {
     }
 }
 
-pub fn sleep_ms(millis: u64) -> () {
-    let t = std::time::Duration::from_millis(millis);
-    std::thread::sleep(t);
+/// Returns the chain head following `current_block`, notified by the `newHeads` subscription
+/// `heads` when there's one, and polled with `poll_head` otherwise. The subscription is dropped
+/// once its connection closed, the next heads being polled.
+async fn next_head<F, Fut, E>(
+    heads: &mut Option<watch::Receiver<Option<u64>>>,
+    current_block: u64,
+    poll_interval: Duration,
+    poll_head: F,
+) -> u64
+where
+    F: FnOnce() -> Fut,
+    Fut: Future<Output = Result<u64, E>>,
+{
+    let Some(heads_rx) = heads.as_mut() else {
+        sleep(poll_interval).await;
+        return poll_head().await.unwrap_or(current_block);
+    };
+    let notified = timeout(NEW_HEAD_TIMEOUT, heads_rx.changed()).await;
+    match notified {
+        Ok(Ok(())) => heads_rx.borrow_and_update().unwrap_or(current_block),
+        // the connection closed, polling from now on
+        Ok(Err(_)) => {
+            *heads = None;
+            poll_head().await.unwrap_or(current_block)
+        }
+        // notifications may have been lost
+        Err(_) => poll_head().await.unwrap_or(current_block),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::time::Duration;
+
+    use tokio::sync::watch;
+
+    use super::next_head;
+
+    fn block_on<F: std::future::Future>(future: F) -> F::Output {
+        tokio::runtime::Builder::new_current_thread()
+            .enable_time()
+            .build()
+            .unwrap()
+            .block_on(future)
+    }
+
+    #[test]
+    fn it_follows_new_heads_notifications() {
+        let (heads_tx, heads_rx) = watch::channel(None);
+        let mut heads = Some(heads_rx);
+        heads_tx.send(Some(12)).unwrap();
+        let block = block_on(next_head(&mut heads, 10, Duration::ZERO, || async {
+            Err::<u64, String>("unexpected poll".into())
+        }));
+        assert_eq!(block, 12);
+        assert!(heads.is_some());
+    }
+
+    #[test]
+    fn it_polls_once_the_subscription_closed() {
+        let (heads_tx, heads_rx) = watch::channel(None);
+        let mut heads = Some(heads_rx);
+        drop(heads_tx);
+        let block =
+            block_on(next_head(&mut heads, 10, Duration::ZERO, || async { Ok::<u64, String>(11) }));
+        assert_eq!(block, 11);
+        assert!(heads.is_none());
+
+        // the next heads are polled, the current block is kept when polling fails
+        let block = block_on(next_head(&mut heads, 11, Duration::ZERO, || async {
+            Err::<u64, String>("connection refused".into())
+        }));
+        assert_eq!(block, 11);
+    }
 }
@@ -596,6 +596,7 @@ impl CommandImplementation for DeployContract {
         background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let construct_did = construct_did.clone();
         let spec = spec.clone();
@@ -605,6 +606,7 @@ impl CommandImplementation for DeployContract {
         let background_tasks_uuid = background_tasks_uuid.clone();
         let supervision_context = supervision_context.clone();
         let cloud_service_context = cloud_service_context.clone();
+        let auth_context = auth_context.clone();
 
         let future = async move {
             let mut result = CommandExecutionResult::new();
@@ -630,6 +632,7 @@ impl CommandImplementation for DeployContract {
                 &background_tasks_uuid,
                 &supervision_context,
                 &cloud_service_context,
+                &auth_context,
             )?
             .await?;
 
@@ -833,6 +836,51 @@ impl ContractDeploymentTransactionRequestBuilder {
     }
 }
 
+/// Estimates the cost of the deployment, and the amount it transfers, without signing it.
+/// Contracts already deployed cost nothing.
+#[cfg(not(feature = "wasm"))]
+pub async fn estimate_deployment_cost(
+    signer_state: &ValueStore,
+    values: &ValueStore,
+) -> Result<(i128, u64), Diagnostic> {
+    use crate::codec::contract_deployment::{
+        ProxiedDeploymentTransaction, TransactionDeploymentRequestData,
+    };
+    use crate::constants::CHAIN_ID;
+
+    let from = signer_state.get_expected_value("signer_address")?;
+    let rpc_api_url = values.get_expected_string(RPC_API_URL)?;
+    let chain_id = values.get_expected_uint(CHAIN_ID)?;
+
+    let deployer = ContractDeploymentTransactionRequestBuilder::new(
+        &rpc_api_url,
+        chain_id,
+        from,
+        signer_state,
+        values,
+    )
+    .await
+    .map_err(|e| diagnosed_error!("{}", e))?;
+
+    let tx_cost = match deployer
+        .get_implementation_deployment_transaction(values)
+        .await
+        .map_err(|e| diagnosed_error!("{}", e))?
+    {
+        ContractDeploymentTransaction::Create(status)
+        | ContractDeploymentTransaction::Create2(status) => match status {
+            ContractDeploymentTransactionStatus::AlreadyDeployed(_) => return Ok((0, 0)),
+            ContractDeploymentTransactionStatus::NotYetDeployed(
+                TransactionDeploymentRequestData { tx_cost, .. },
+            ) => tx_cost,
+        },
+        ContractDeploymentTransaction::Proxied(ProxiedDeploymentTransaction {
+            tx_cost, ..
+        }) => tx_cost,
+    };
+    Ok((tx_cost, deployer.amount))
+}
+
 #[derive(Clone, Debug)]
 pub struct ProxiedContractInitializer {
     function_name: String,
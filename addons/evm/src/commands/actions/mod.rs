@@ -2,7 +2,11 @@ use std::collections::HashMap;
 
 use alloy::primitives::Address;
 use check_confirmations::CHECK_CONFIRMATIONS;
-use txtx_addon_kit::types::signers::SignerInstance;
+use txtx_addon_kit::types::cost_estimation::{
+    CostEstimationFuture, CostEstimationRequest, CostEstimationResult, SignerBalance,
+    TransactionCostEstimate,
+};
+use txtx_addon_kit::types::signers::{SignerInstance, SignersState};
 use txtx_addon_kit::types::stores::ValueStore;
 use txtx_addon_kit::types::{
     commands::PreCommandSpecification, diagnostics::Diagnostic, types::Value, ConstructDid, Did,
@@ -62,3 +66,124 @@ pub fn get_meta_description(
     let signer_instance = signers_instances.get(signer_did).expect("Signer instance not found");
     format!("A transaction will be signed by the {} signer. {}", signer_instance.name, description)
 }
+
+/// Estimates the costs of the transactions of `commands`, concurrently with the balances of
+/// the signers paying them, fetched once per address and endpoint.
+#[cfg(not(feature = "wasm"))]
+pub fn estimate_transactions_costs(
+    commands: Vec<CostEstimationRequest>,
+    signers: SignersState,
+) -> CostEstimationFuture {
+    use std::collections::BTreeMap;
+
+    use txtx_addon_kit::futures::future::join_all;
+    use txtx_addon_kit::futures::join;
+
+    use crate::constants::{CHECKED_ADDRESS, RPC_API_URL};
+    use crate::rpc::EvmRpc;
+
+    let future = async move {
+        let payers = commands
+            .iter()
+            .map(|command| {
+                let network = command.inputs.get_string(RPC_API_URL).unwrap_or("").to_string();
+                let payer = get_signer_did(&command.inputs).ok().map(|signer_did| {
+                    let address = signers
+                        .get_signer_state(&signer_did)
+                        .and_then(|state| state.get_string(CHECKED_ADDRESS))
+                        .map(|address| address.to_string());
+                    (signer_did, address)
+                });
+                (network, payer)
+            })
+            .collect::<Vec<_>>();
+        let mut balances_to_check = BTreeMap::new();
+        for (network, payer) in payers.iter() {
+            if let Some((signer_did, Some(address))) = payer {
+                balances_to_check
+                    .entry((network.clone(), address.clone()))
+                    .or_insert_with(|| signer_did.clone());
+            }
+        }
+
+        let signers = &signers;
+        let estimates = join_all(commands.iter().zip(payers.iter()).map(
+            |(command, (network, payer))| async move {
+                let signer_state =
+                    payer.as_ref().and_then(|(signer_did, _)| signers.get_signer_state(signer_did));
+                let cost = match signer_state {
+                    Some(signer_state) => estimate_transaction_cost(command, signer_state).await,
+                    None => Err(diagnosed_error!("signer requires user interaction")),
+                };
+                let (fee, amount) = match cost {
+                    Ok((fee, amount)) => (Ok(fee.max(0) as u128), amount as u128),
+                    Err(diag) => (Err(diag.message), 0),
+                };
+                TransactionCostEstimate {
+                    construct_did: command.construct_did.clone(),
+                    construct_name: command.construct_name.clone(),
+                    network: network.clone(),
+                    denomination: "wei".into(),
+                    payer: payer.clone(),
+                    fee,
+                    amount,
+                }
+            },
+        ));
+        let balances = join_all(balances_to_check.into_iter().map(
+            |((network, address), signer_did)| async move {
+                let balance = match (
+                    EvmRpc::new(&network),
+                    get_expected_address(&Value::string(address.clone())),
+                ) {
+                    (Ok(rpc), Ok(evm_address)) => rpc
+                        .get_balance(&evm_address)
+                        .await
+                        .map(|balance| u128::try_from(balance).unwrap_or(u128::MAX))
+                        .map_err(|e| e.to_string()),
+                    (Err(e), _) | (_, Err(e)) => Err(e),
+                };
+                SignerBalance { signer_did, network, denomination: "wei".into(), address, balance }
+            },
+        ));
+        let (transactions, balances) = join!(estimates, balances);
+        CostEstimationResult { transactions, balances }
+    };
+    Box::pin(future)
+}
+
+/// Returns the fee of the transaction produced by `command`, and the amount it transfers.
+#[cfg(not(feature = "wasm"))]
+async fn estimate_transaction_cost(
+    command: &CostEstimationRequest,
+    signer_state: &ValueStore,
+) -> Result<(i128, u64), Diagnostic> {
+    let Some(spec) = ACTIONS.iter().find_map(|action| match action {
+        PreCommandSpecification::Atomic(spec) if spec.matcher == command.matcher => Some(spec),
+        _ => None,
+    }) else {
+        return Err(diagnosed_error!("unknown action '{}'", command.matcher));
+    };
+    let (amount, _, _) =
+        get_common_tx_params_from_args(&command.inputs).map_err(|e| diagnosed_error!("{}", e))?;
+    let fee = match command.matcher.as_str() {
+        "send_eth" => {
+            send_eth::build_unsigned_transfer(signer_state, spec, &command.inputs).await?.1
+        }
+        "call_contract" => {
+            call_contract::build_unsigned_contract_call(signer_state, spec, &command.inputs)
+                .await?
+                .1
+        }
+        "deploy_contract" => {
+            return deploy_contract::estimate_deployment_cost(signer_state, &command.inputs).await
+        }
+        _ => {
+            return Err(diagnosed_error!(
+                "cost estimation is not supported by '{}'",
+                command.matcher
+            ))
+        }
+    };
+    Ok((fee, amount))
+}
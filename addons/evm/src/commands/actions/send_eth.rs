@@ -312,6 +312,7 @@ impl CommandImplementation for SendEth {
         background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let construct_did = construct_did.clone();
         let spec = spec.clone();
@@ -321,6 +322,7 @@ impl CommandImplementation for SendEth {
         let background_tasks_uuid = background_tasks_uuid.clone();
         let supervision_context = supervision_context.clone();
         let cloud_service_context = cloud_service_context.clone();
+        let auth_context = auth_context.clone();
 
         let future = async move {
             let mut result = CommandExecutionResult::new();
@@ -334,6 +336,7 @@ impl CommandImplementation for SendEth {
                 &background_tasks_uuid,
                 &supervision_context,
                 &cloud_service_context,
+                &auth_context,
             )?
             .await?;
 
@@ -346,7 +349,7 @@ impl CommandImplementation for SendEth {
 }
 
 #[cfg(not(feature = "wasm"))]
-async fn build_unsigned_transfer(
+pub async fn build_unsigned_transfer(
     signer_state: &ValueStore,
     _spec: &CommandSpecification,
     values: &ValueStore,
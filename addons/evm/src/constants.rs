@@ -34,6 +34,7 @@ pub const FORMATTED_TRANSACTION: &str = "formatted_transaction";
 pub const CHAIN_ID: &str = "chain_id";
 pub const NETWORK_ID: &str = "network_id";
 pub const RPC_API_URL: &str = "rpc_api_url";
+pub const RPC_WS_URL: &str = "rpc_ws_url";
 pub const BLOCK_EXPLORER_API_KEY: &str = "block_explorer_api_key";
 pub const TRANSACTION_TO: &str = "to";
 pub const SIGNER: &str = "signer";
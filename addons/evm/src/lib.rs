@@ -19,8 +19,10 @@ mod typing;
 use constants::NAMESPACE;
 use txtx_addon_kit::{
     types::{
-        commands::PreCommandSpecification, functions::FunctionSpecification,
-        signers::SignerSpecification,
+        commands::PreCommandSpecification,
+        cost_estimation::{CostEstimationFuture, CostEstimationRequest},
+        functions::FunctionSpecification,
+        signers::{SignerSpecification, SignersState},
     },
     Addon,
 };
@@ -62,4 +64,13 @@ impl Addon for EvmNetworkAddon {
     fn get_signers(&self) -> Vec<SignerSpecification> {
         signers::WALLETS.clone()
     }
+
+    #[cfg(not(feature = "wasm"))]
+    fn estimate_transactions_costs(
+        &self,
+        commands: Vec<CostEstimationRequest>,
+        signers: SignersState,
+    ) -> CostEstimationFuture {
+        crate::commands::actions::estimate_transactions_costs(commands, signers)
+    }
 }
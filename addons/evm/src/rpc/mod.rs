@@ -1,7 +1,8 @@
-use std::fmt::Debug;
-use std::future::Future;
+use std::collections::HashMap;
+use std::fmt::{Debug, Display};
+use std::future::{Future, IntoFuture};
 use std::str::FromStr;
-use std::thread::sleep;
+use std::sync::{Arc, Mutex};
 use std::time::Duration;
 
 use alloy::consensus::TxEnvelope;
@@ -22,7 +23,13 @@ use alloy_rpc_types::trace::geth::{
     GethDebugTracingCallOptions, GethDebugTracingOptions, GethTrace,
 };
 use alloy_rpc_types::{Block, BlockId, BlockNumberOrTag, FeeHistory};
+use txtx_addon_kit::helpers::rpc_limiter::{rpc_endpoint_limiter, RpcEndpointLimiter};
 use txtx_addon_kit::reqwest::Url;
+use txtx_addon_kit::types::run_resources::RunResources;
+
+mod new_heads;
+
+pub use new_heads::new_heads;
 
 #[derive(Debug)]
 pub enum RpcError {
@@ -49,6 +56,28 @@ impl Into<String> for RpcError {
     }
 }
 
+/// Sends `request` within the budget of its endpoint, shared by all the clients of the process.
+/// Endpoints answering HTTP 429 are throttled.
+async fn limited<T, E: Display>(
+    limiter: &Arc<RpcEndpointLimiter>,
+    request: impl IntoFuture<Output = Result<T, E>>,
+) -> Result<T, E> {
+    let _permit = limiter.acquire().await;
+    let result = request.await;
+    if let Err(e) = &result {
+        if e.to_string().contains("HTTP error 429") {
+            limiter.throttle(None);
+        }
+    }
+    result
+}
+
+/// Clients of the endpoints used by a run, by url.
+#[derive(Default)]
+struct EvmRunRpcs {
+    rpcs: Mutex<HashMap<String, EvmRpc>>,
+}
+
 pub type WalletProvider = FillProvider<
     JoinFill<
         Identity,
@@ -62,6 +91,7 @@ pub type WalletProvider = FillProvider<
 pub struct EvmWalletRpc {
     pub url: Url,
     pub wallet: EthereumWallet,
+    pub limiter: Arc<RpcEndpointLimiter>,
     pub provider: FillProvider<
         JoinFill<
             Identity,
@@ -75,13 +105,13 @@ impl EvmWalletRpc {
         let url = Url::try_from(url).map_err(|e| format!("invalid rpc url {}: {}", url, e))?;
 
         let provider = ProviderBuilder::new().on_http(url.clone());
-        Ok(Self { url, wallet, provider })
+        let limiter = rpc_endpoint_limiter(url.as_str());
+        Ok(Self { url, wallet, limiter, provider })
     }
     pub async fn sign_and_send_tx(&self, tx_envelope: TxEnvelope) -> Result<[u8; 32], RpcError> {
-        let pending_tx =
-            self.provider.send_tx_envelope(tx_envelope).await.map_err(|e| {
-                RpcError::Message(format!("failed to sign and send transaction: {e}"))
-            })?;
+        let pending_tx = limited(&self.limiter, self.provider.send_tx_envelope(tx_envelope))
+            .await
+            .map_err(|e| RpcError::Message(format!("failed to sign and send transaction: {e}")))?;
         let tx_hash = pending_tx.tx_hash().0;
         Ok(tx_hash)
     }
@@ -90,6 +120,7 @@ impl EvmWalletRpc {
 #[derive(Clone, Debug)]
 pub struct EvmRpc {
     pub url: Url,
+    pub limiter: Arc<RpcEndpointLimiter>,
     pub provider: FillProvider<
         JoinFill<
             Identity,
@@ -113,37 +144,59 @@ impl EvmRpc {
                 Ok(result) => return Ok(result),
                 Err(_) if attempts < max_retries => {
                     attempts += 1;
-                    sleep(Duration::from_secs(2));
+                    tokio::time::sleep(Duration::from_secs(2)).await;
                 }
                 Err(err) => return Err(err),
             }
         }
     }
     pub fn new(url: &str) -> Result<Self, String> {
-        let url = Url::try_from(url).map_err(|e| format!("invalid rpc url {}: {}", url, e))?;
-        let provider = ProviderBuilder::new().on_http(url.clone());
-        Ok(Self { url, provider })
+        let parsed_url =
+            Url::try_from(url).map_err(|e| format!("invalid rpc url {}: {}", url, e))?;
+        if matches!(parsed_url.scheme(), "ws" | "wss") {
+            return Err(format!(
+                "invalid rpc url {}: use an http(s) url, and rpc_ws_url for websockets",
+                url
+            ));
+        }
+        let provider = ProviderBuilder::new().on_http(parsed_url.clone());
+        let limiter = rpc_endpoint_limiter(parsed_url.as_str());
+        Ok(Self { url: parsed_url, limiter, provider })
+    }
+
+    /// Returns the client of the endpoint `url` shared by the constructs of the run, so that
+    /// the connections to the endpoint are kept alive between requests. Connections are bound to
+    /// the runtime executing the run, and are not shared with other runs.
+    pub fn for_run(run_resources: &RunResources, url: &str) -> Result<Self, String> {
+        let run_rpcs = run_resources.get_or_init(EvmRunRpcs::default);
+        if let Some(rpc) = run_rpcs.rpcs.lock().unwrap().get(url) {
+            return Ok(rpc.clone());
+        }
+        let rpc = EvmRpc::new(url)?;
+        run_rpcs.rpcs.lock().unwrap().insert(url.to_string(), rpc.clone());
+        Ok(rpc)
     }
 
     pub async fn get_chain_id(&self) -> Result<u64, RpcError> {
-        self.provider
-            .get_chain_id()
+        limited(&self.limiter, self.provider.get_chain_id())
             .await
             .map_err(|e| RpcError::Message(format!("error getting chain id: {}", e.to_string())))
     }
 
     pub async fn get_nonce(&self, address: &Address) -> Result<u64, RpcError> {
         EvmRpc::retry_async(|| async {
-            self.provider.get_transaction_count(address.clone()).await.map_err(|e| {
-                RpcError::Message(format!("error getting transaction count: {}", e.to_string()))
-            })
+            limited(&self.limiter, self.provider.get_transaction_count(address.clone()))
+                .await
+                .map_err(|e| {
+                    RpcError::Message(format!("error getting transaction count: {}", e.to_string()))
+                })
         })
         .await
     }
 
     pub async fn get_gas_price(&self) -> Result<u128, RpcError> {
         EvmRpc::retry_async(|| async {
-            self.provider.get_gas_price().await.map_err(|e| {
+            limited(&self.limiter, self.provider.get_gas_price()).await.map_err(|e| {
                 RpcError::Message(format!("error getting gas price: {}", e.to_string()))
             })
         })
@@ -152,7 +205,7 @@ impl EvmRpc {
 
     pub async fn estimate_gas(&self, tx: &TransactionRequest) -> Result<u64, RpcError> {
         EvmRpc::retry_async(|| async {
-            self.provider.estimate_gas(tx.clone()).await.map_err(|e| {
+            limited(&self.limiter, self.provider.estimate_gas(tx.clone())).await.map_err(|e| {
                 RpcError::Message(format!("error getting gas estimate: {}", e.to_string()))
             })
         })
@@ -161,7 +214,7 @@ impl EvmRpc {
 
     pub async fn estimate_eip1559_fees(&self) -> Result<Eip1559Estimation, RpcError> {
         EvmRpc::retry_async(|| async {
-            self.provider.estimate_eip1559_fees().await.map_err(|e| {
+            limited(&self.limiter, self.provider.estimate_eip1559_fees()).await.map_err(|e| {
                 RpcError::Message(format!("error getting EIP 1559 fees: {}", e.to_string()))
             })
         })
@@ -170,16 +223,16 @@ impl EvmRpc {
 
     pub async fn get_fee_history(&self) -> Result<FeeHistory, RpcError> {
         EvmRpc::retry_async(|| async {
-            self.provider
-                .get_fee_history(
+            limited(
+                &self.limiter,
+                self.provider.get_fee_history(
                     EIP1559_FEE_ESTIMATION_PAST_BLOCKS,
                     BlockNumberOrTag::Latest,
                     &[EIP1559_FEE_ESTIMATION_REWARD_PERCENTILE],
-                )
-                .await
-                .map_err(|e| {
-                    RpcError::Message(format!("error getting fee history: {}", e.to_string()))
-                })
+                ),
+            )
+            .await
+            .map_err(|e| RpcError::Message(format!("error getting fee history: {}", e.to_string())))
         })
         .await
     }
@@ -199,7 +252,7 @@ impl EvmRpc {
 
     pub async fn get_balance(&self, address: &Address) -> Result<Uint<256, 4>, RpcError> {
         EvmRpc::retry_async(|| async {
-            self.provider.get_balance(address.clone()).await.map_err(|e| {
+            limited(&self.limiter, self.provider.get_balance(address.clone())).await.map_err(|e| {
                 RpcError::Message(format!("error getting account balance: {}", e.to_string()))
             })
         })
@@ -213,23 +266,27 @@ impl EvmRpc {
     ) -> Result<String, CallFailureResult> {
         let call_res = if retry {
             EvmRpc::retry_async(|| async {
-                self.provider.call(tx.clone()).block(BlockId::pending()).await.map_err(|e| {
+                limited(&self.limiter, self.provider.call(tx.clone()).block(BlockId::pending()))
+                    .await
+                    .map_err(|e| {
+                        if let Some(e) = e.as_error_resp() {
+                            RpcError::MessageWithCode(e.message.to_string(), e.code)
+                        } else {
+                            RpcError::Message(e.to_string())
+                        }
+                    })
+            })
+            .await
+        } else {
+            limited(&self.limiter, self.provider.call(tx.clone()).block(BlockId::latest()))
+                .await
+                .map_err(|e| {
                     if let Some(e) = e.as_error_resp() {
                         RpcError::MessageWithCode(e.message.to_string(), e.code)
                     } else {
                         RpcError::Message(e.to_string())
                     }
                 })
-            })
-            .await
-        } else {
-            self.provider.call(tx.clone()).block(BlockId::latest()).await.map_err(|e| {
-                if let Some(e) = e.as_error_resp() {
-                    RpcError::MessageWithCode(e.message.to_string(), e.code)
-                } else {
-                    RpcError::Message(e.to_string())
-                }
-            })
         };
 
         let result = match call_res {
@@ -255,7 +312,7 @@ impl EvmRpc {
 
     pub async fn get_code(&self, address: &Address) -> Result<Bytes, RpcError> {
         EvmRpc::retry_async(|| async {
-            self.provider.get_code_at(address.clone()).await.map_err(|e| {
+            limited(&self.limiter, self.provider.get_code_at(address.clone())).await.map_err(|e| {
                 RpcError::Message(format!(
                     "error getting code at address {}: {}",
                     address.to_string(),
@@ -268,18 +325,20 @@ impl EvmRpc {
 
     pub async fn get_transaction_return_value(&self, tx_hash: &Vec<u8>) -> Result<String, String> {
         let result = EvmRpc::retry_async(|| async {
-            self.provider
-                .debug_trace_transaction(
+            limited(
+                &self.limiter,
+                self.provider.debug_trace_transaction(
                     FixedBytes::from_slice(&tx_hash),
                     GethDebugTracingOptions::default(),
-                )
-                .await
-                .map_err(|e| {
-                    RpcError::Message(format!(
-                        "received error result from RPC API during debug_trace_transaction: {}",
-                        e
-                    ))
-                })
+                ),
+            )
+            .await
+            .map_err(|e| {
+                RpcError::Message(format!(
+                    "received error result from RPC API during debug_trace_transaction: {}",
+                    e
+                ))
+            })
         })
         .await
         .map_err(|e| e.to_string())?;
@@ -298,19 +357,21 @@ impl EvmRpc {
 
     pub async fn trace_call(&self, tx: &TransactionRequest) -> Result<String, String> {
         let result = EvmRpc::retry_async(|| async {
-            self.provider
-                .debug_trace_call(
+            limited(
+                &self.limiter,
+                self.provider.debug_trace_call(
                     tx.clone(),
                     BlockId::latest(),
                     GethDebugTracingCallOptions::default(),
-                )
-                .await
-                .map_err(|e| {
-                    RpcError::Message(format!(
-                        "received error result from RPC API during trace_call: {}",
-                        e
-                    ))
-                })
+                ),
+            )
+            .await
+            .map_err(|e| {
+                RpcError::Message(format!(
+                    "received error result from RPC API during trace_call: {}",
+                    e
+                ))
+            })
         })
         .await
         .map_err(|e| e.to_string())?;
@@ -324,14 +385,19 @@ impl EvmRpc {
         &self,
         tx_hash: &Vec<u8>,
     ) -> Result<Option<TransactionReceipt>, RpcError> {
-        self.provider.get_transaction_receipt(FixedBytes::from_slice(&tx_hash)).await.map_err(|e| {
+        limited(
+            &self.limiter,
+            self.provider.get_transaction_receipt(FixedBytes::from_slice(&tx_hash)),
+        )
+        .await
+        .map_err(|e| {
             RpcError::Message(format!("error getting transaction receipt: {}", e.to_string()))
         })
     }
 
     pub async fn get_block_number(&self) -> Result<u64, RpcError> {
         EvmRpc::retry_async(|| async {
-            self.provider.get_block_number().await.map_err(|e| {
+            limited(&self.limiter, self.provider.get_block_number()).await.map_err(|e| {
                 RpcError::Message(format!("error getting block number: {}", e.to_string()))
             })
         })
@@ -343,7 +409,7 @@ impl EvmRpc {
             RpcError::Message(format!("error parsing block hash: {}", e.to_string()))
         })?;
         EvmRpc::retry_async(|| async {
-            self.provider.get_block_by_hash(block_hash).await.map_err(|e| {
+            limited(&self.limiter, self.provider.get_block_by_hash(block_hash)).await.map_err(|e| {
                 RpcError::Message(format!("error getting block by hash: {}", e.to_string()))
             })
         })
@@ -352,8 +418,7 @@ impl EvmRpc {
 
     pub async fn get_latest_block(&self) -> Result<Option<Block>, RpcError> {
         EvmRpc::retry_async(|| async {
-            self.provider
-                .get_block(BlockId::latest())
+            limited(&self.limiter, self.provider.get_block(BlockId::latest()))
                 .await
                 .map_err(|e| RpcError::Message(format!("error getting block: {}", e.to_string())))
         })
@@ -390,3 +455,24 @@ impl CallFailureResult {
         }
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use txtx_addon_kit::types::run_resources::RunResources;
+
+    use super::{EvmRpc, EvmRunRpcs};
+
+    #[test]
+    fn it_shares_clients_within_a_run_only() {
+        let url = "http://127.0.0.1:8545";
+        let run = RunResources::new();
+        EvmRpc::for_run(&run, url).unwrap();
+        EvmRpc::for_run(&run.clone(), url).unwrap();
+        assert_eq!(run.get_or_init(EvmRunRpcs::default).rpcs.lock().unwrap().len(), 1);
+
+        let other_run = RunResources::new();
+        assert!(other_run.get_or_init(EvmRunRpcs::default).rpcs.lock().unwrap().is_empty());
+
+        assert!(EvmRpc::for_run(&run, "ws://127.0.0.1:8546").is_err());
+    }
+}
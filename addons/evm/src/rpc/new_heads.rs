@@ -0,0 +1,119 @@
+use std::collections::HashMap;
+use std::sync::Mutex;
+
+use serde_json::{json, Value as JsonValue};
+use tokio::sync::watch;
+use tokio_tungstenite::tungstenite::Message;
+use txtx_addon_kit::futures::{SinkExt, StreamExt};
+use txtx_addon_kit::types::run_resources::RunResources;
+
+/// `newHeads` subscriptions of a run, by websocket url. A subscription is shared by the constructs
+/// of the run awaiting confirmations on the endpoint, and ends once the run is dropped.
+#[derive(Default)]
+struct NewHeadsSubscriptions {
+    heads: Mutex<HashMap<String, watch::Receiver<Option<u64>>>>,
+}
+
+/// Returns the chain heads of the websocket endpoint `ws_url`, subscribing on first use in the
+/// run. The receiver holds the number of the latest head, and fails once the connection closed.
+pub async fn new_heads(
+    run_resources: &RunResources,
+    ws_url: &str,
+) -> Result<watch::Receiver<Option<u64>>, String> {
+    let subscriptions = run_resources.get_or_init(NewHeadsSubscriptions::default);
+    if let Some(heads) = subscriptions.heads.lock().unwrap().get(ws_url) {
+        // the connection is still open
+        if heads.has_changed().is_ok() {
+            return Ok(heads.clone());
+        }
+    }
+    let heads = subscribe_new_heads(ws_url).await?;
+    subscriptions.heads.lock().unwrap().insert(ws_url.to_string(), heads.clone());
+    Ok(heads)
+}
+
+async fn subscribe_new_heads(ws_url: &str) -> Result<watch::Receiver<Option<u64>>, String> {
+    if !ws_url.starts_with("ws://") && !ws_url.starts_with("wss://") {
+        return Err(format!("invalid websocket url {}: expected a ws:// or wss:// url", ws_url));
+    }
+    let (mut stream, _) = tokio_tungstenite::connect_async(ws_url)
+        .await
+        .map_err(|e| format!("unable to connect to {}: {}", ws_url, e))?;
+    let request =
+        json!({ "jsonrpc": "2.0", "id": 1, "method": "eth_subscribe", "params": ["newHeads"] });
+    stream
+        .send(Message::Text(request.to_string()))
+        .await
+        .map_err(|e| format!("unable to subscribe to new heads on {}: {}", ws_url, e))?;
+
+    // the subscription id is answered before any notification
+    let subscription_id = loop {
+        let text = match stream.next().await {
+            Some(Ok(Message::Text(text))) => text,
+            Some(Ok(_)) => continue,
+            Some(Err(e)) => {
+                return Err(format!("unable to subscribe to new heads on {}: {}", ws_url, e))
+            }
+            None => return Err(format!("{} closed the connection", ws_url)),
+        };
+        let response: JsonValue = serde_json::from_str(&text)
+            .map_err(|e| format!("invalid response from {}: {}", ws_url, e))?;
+        if let Some(error) = response.get("error") {
+            return Err(format!("unable to subscribe to new heads on {}: {}", ws_url, error));
+        }
+        if let Some(subscription_id) = response.get("result").and_then(|id| id.as_str()) {
+            break subscription_id.to_string();
+        }
+    };
+
+    let (heads_tx, heads_rx) = watch::channel(None);
+    tokio::spawn(async move {
+        while let Some(Ok(message)) = stream.next().await {
+            let Message::Text(text) = message else {
+                continue;
+            };
+            let Some(block_number) = parse_new_head_notification(&text, &subscription_id) else {
+                continue;
+            };
+            // stops once no construct nor run is holding the subscription
+            if heads_tx.send(Some(block_number)).is_err() {
+                break;
+            }
+        }
+    });
+    Ok(heads_rx)
+}
+
+/// Returns the block number of a notification of the `newHeads` subscription `subscription_id`.
+fn parse_new_head_notification(text: &str, subscription_id: &str) -> Option<u64> {
+    let notification: JsonValue = serde_json::from_str(text).ok()?;
+    if notification.get("method")?.as_str()? != "eth_subscription" {
+        return None;
+    }
+    let params = notification.get("params")?;
+    if params.get("subscription")?.as_str()? != subscription_id {
+        return None;
+    }
+    let block_number = params.get("result")?.get("number")?.as_str()?;
+    u64::from_str_radix(block_number.trim_start_matches("0x"), 16).ok()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::parse_new_head_notification;
+
+    #[test]
+    fn it_parses_new_head_notifications() {
+        let notification = r#"{"jsonrpc":"2.0","method":"eth_subscription","params":{"subscription":"0xcd0c3e8af590364c09d0fa6a1210faf5","result":{"number":"0x1b4","hash":"0xdc0818cf78f21a8e70579cb46a43643f78291264dda342ae31049421c82d21ae"}}}"#;
+        assert_eq!(
+            parse_new_head_notification(notification, "0xcd0c3e8af590364c09d0fa6a1210faf5"),
+            Some(436)
+        );
+        assert_eq!(parse_new_head_notification(notification, "0x1"), None);
+        let response = r#"{"jsonrpc":"2.0","id":1,"result":"0xcd0c3e8af590364c09d0fa6a1210faf5"}"#;
+        assert_eq!(
+            parse_new_head_notification(response, "0xcd0c3e8af590364c09d0fa6a1210faf5"),
+            None
+        );
+    }
+}
@@ -159,8 +159,14 @@ impl SignerImplementation for EvmSecretKeySigner {
                 let derivation_path = values.get_string("derivation_path");
                 let is_encrypted = values.get_bool("is_encrypted");
                 let password = values.get_string("password");
-                mnemonic_to_secret_key_signer(mnemonic, derivation_path, is_encrypted, password)
-                    .map_err(|e| (signers.clone(), signer_state.clone(), diagnosed_error!("{e}")))?
+                mnemonic_to_secret_key_signer(
+                    &auth_ctx.run_resources,
+                    mnemonic,
+                    derivation_path,
+                    is_encrypted,
+                    password,
+                )
+                .map_err(|e| (signers.clone(), signer_state.clone(), diagnosed_error!("{e}")))?
             };
 
         let expected_address: Address = expected_signer.address();
@@ -99,6 +99,7 @@ impl CommandImplementation for PackageRollup {
         _background_tasks_uuid: &Uuid,
         _supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        _auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let inputs = inputs.clone();
 
@@ -150,6 +150,7 @@ impl CommandImplementation for StartRollup {
         background_tasks_uuid: &Uuid,
         _supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        _auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let construct_did = construct_did.clone();
         let inputs = inputs.clone();
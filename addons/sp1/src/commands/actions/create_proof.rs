@@ -115,6 +115,7 @@ impl CommandImplementation for CreateProof {
         _background_tasks_uuid: &Uuid,
         _supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        _auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         use std::{
             sync::{Arc, Mutex},
@@ -162,6 +162,7 @@ impl CommandImplementation for BroadcastStacksTransaction {
         background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        _auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         use txtx_addon_kit::{
             constants::SIGNED_TRANSACTION_BYTES, types::frontend::ProgressBarStatusColor,
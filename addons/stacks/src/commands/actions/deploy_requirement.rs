@@ -376,6 +376,7 @@ impl CommandImplementation for StacksDeployContractRequirement {
         background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         StacksDeployContract::build_background_task(
             &construct_did,
@@ -386,6 +387,7 @@ impl CommandImplementation for StacksDeployContractRequirement {
             &background_tasks_uuid,
             &supervision_context,
             &cloud_service_context,
+            auth_context,
         )
     }
 }
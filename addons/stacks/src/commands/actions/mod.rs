@@ -31,6 +31,11 @@ use deploy_requirement::DEPLOY_STACKS_REQUIREMENT;
 use encode_contract_call::ENCODE_STACKS_CONTRACT_CALL;
 use send_stx::SEND_STX_TRANSFER;
 use sign_transaction::SIGN_STACKS_TRANSACTION;
+use txtx_addon_kit::types::cost_estimation::{
+    CostEstimationFuture, CostEstimationRequest, CostEstimationResult, SignerBalance,
+    TransactionCostEstimate,
+};
+use txtx_addon_kit::types::signers::SignersState;
 use txtx_addon_kit::types::stores::ValueStore;
 use txtx_addon_kit::types::{
     commands::{CommandSpecification, PreCommandSpecification},
@@ -248,3 +253,153 @@ pub fn get_signer_did(args: &ValueStore) -> Result<ConstructDid, Diagnostic> {
     let signer_did = ConstructDid(Did::from_hex_string(signer));
     Ok(signer_did)
 }
+
+/// Estimates the fees of the transactions of `commands`, concurrently with the balances of
+/// the signers paying them, fetched once per address and endpoint.
+#[cfg(not(feature = "wasm"))]
+pub fn estimate_transactions_costs(
+    commands: Vec<CostEstimationRequest>,
+    signers: SignersState,
+) -> CostEstimationFuture {
+    use std::collections::BTreeMap;
+
+    use txtx_addon_kit::futures::future::join_all;
+    use txtx_addon_kit::futures::join;
+
+    use crate::constants::{CHECKED_ADDRESS, RPC_API_AUTH_TOKEN, RPC_API_URL};
+    use crate::rpc::StacksRpc;
+
+    let future = async move {
+        let payers = commands
+            .iter()
+            .map(|command| {
+                let network = command.inputs.get_string(RPC_API_URL).unwrap_or("").to_string();
+                let payer = get_signer_did(&command.inputs).ok().map(|signer_did| {
+                    let address = signers
+                        .get_signer_state(&signer_did)
+                        .and_then(|state| state.get_string(CHECKED_ADDRESS))
+                        .map(|address| address.to_string());
+                    (signer_did, address)
+                });
+                (network, payer)
+            })
+            .collect::<Vec<_>>();
+        // balances are fetched with the auth token of the first command sent to the endpoint
+        let mut balances_to_check = BTreeMap::new();
+        for (command, (network, payer)) in commands.iter().zip(payers.iter()) {
+            if let Some((signer_did, Some(address))) = payer {
+                balances_to_check.entry((network.clone(), address.clone())).or_insert_with(|| {
+                    let auth_token =
+                        command.inputs.get_string(RPC_API_AUTH_TOKEN).map(|t| t.to_string());
+                    (signer_did.clone(), auth_token)
+                });
+            }
+        }
+
+        let estimates = join_all(commands.iter().zip(payers.iter()).map(
+            |(command, (network, payer))| async move {
+                let (fee, amount) = match estimate_transaction_fee(command).await {
+                    Ok((fee, amount)) => (Ok(fee as u128), amount as u128),
+                    Err(diag) => (Err(diag.message), 0),
+                };
+                TransactionCostEstimate {
+                    construct_did: command.construct_did.clone(),
+                    construct_name: command.construct_name.clone(),
+                    network: network.clone(),
+                    denomination: "µSTX".into(),
+                    payer: payer.clone(),
+                    fee,
+                    amount,
+                }
+            },
+        ));
+        let balances = join_all(balances_to_check.into_iter().map(
+            |((network, address), (signer_did, auth_token))| async move {
+                let rpc = StacksRpc::new(&network, &auth_token);
+                let balance = rpc
+                    .get_balance(&address)
+                    .await
+                    .map(|balance| balance.balance)
+                    .map_err(|e| e.to_string());
+                SignerBalance {
+                    signer_did, network, denomination: "µSTX".into(), address, balance
+                }
+            },
+        ));
+        let (transactions, balances) = join!(estimates, balances);
+        CostEstimationResult { transactions, balances }
+    };
+    Box::pin(future)
+}
+
+/// Returns the fee of the transaction produced by `command`, and the amount it transfers.
+#[cfg(not(feature = "wasm"))]
+async fn estimate_transaction_fee(
+    command: &CostEstimationRequest,
+) -> Result<(u64, u64), Diagnostic> {
+    use crate::constants::{NETWORK_ID, TRANSACTION_PAYLOAD_BYTES};
+    use sign_transaction::get_transaction_fee;
+
+    let Some(spec) = ACTIONS.iter().find_map(|action| match action {
+        PreCommandSpecification::Atomic(spec) if spec.matcher == command.matcher => Some(spec),
+        _ => None,
+    }) else {
+        return Err(diagnosed_error!("unknown action '{}'", command.matcher));
+    };
+    let values = &command.inputs;
+    let mut amount = 0;
+    let payload = match command.matcher.as_str() {
+        "sign_transaction" => values.get_expected_value(TRANSACTION_PAYLOAD_BYTES)?.clone(),
+        "send_stx" => {
+            amount = values.get_expected_uint("amount")?;
+            encode_stx_transfer(
+                spec,
+                values.get_expected_value("recipient")?,
+                amount,
+                &values.get_value("memo"),
+                values.get_expected_string(NETWORK_ID)?,
+            )?
+        }
+        "call_contract" => {
+            let empty_vec = vec![];
+            encode_contract_call(
+                spec,
+                values.get_expected_string("function_name")?,
+                values.get_expected_array("function_args").unwrap_or(&empty_vec),
+                values.get_expected_string(NETWORK_ID)?,
+                values.get_expected_value("contract_id")?,
+            )?
+        }
+        "deploy_contract" => {
+            let contract = values.get_expected_object("contract")?;
+            let Some(contract_source) = contract.get("contract_source").and_then(|v| v.as_string())
+            else {
+                return Err(diagnosed_error!("unable to retrieve 'contract_source'"));
+            };
+            let Some(contract_name) =
+                values.get_value("contract_instance_name").and_then(|v| v.as_string())
+            else {
+                return Err(diagnosed_error!("unable to retrieve 'contract_instance_name'"));
+            };
+            let clarity_version = match contract.get("clarity_version").map(|v| v.as_uint()) {
+                Some(Some(Ok(value))) => Some(value),
+                _ => None,
+            };
+            encode_contract_deployment(spec, contract_source, contract_name, clarity_version)?
+        }
+        _ => {
+            return Err(diagnosed_error!(
+                "cost estimation is not supported by '{}'",
+                command.matcher
+            ))
+        }
+    };
+    let payload_bytes = payload.get_buffer_bytes_result()?;
+    let transaction_payload = TransactionPayload::consensus_deserialize(&mut &payload_bytes[..])
+        .map_err(|e| diagnosed_error!("invalid transaction payload: {}", e))?;
+    let fee = values.get_value("fee").map(|v| v.expect_uint()).transpose()?;
+    let fee =
+        get_transaction_fee(fee, values.get_string("fee_strategy"), &transaction_payload, values)
+            .await?;
+    Ok((fee, amount))
+}
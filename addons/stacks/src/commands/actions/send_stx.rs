@@ -260,6 +260,7 @@ impl CommandImplementation for SendStxTransfer {
         background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         BroadcastStacksTransaction::build_background_task(
             &construct_did,
@@ -270,6 +271,7 @@ impl CommandImplementation for SendStxTransfer {
             &background_tasks_uuid,
             &supervision_context,
             &cloud_service_context,
+            auth_context,
         )
     }
 }
@@ -311,30 +311,20 @@ impl CommandImplementation for SignStacksTransaction {
     }
 }
 
+/// Returns `fee` when set, otherwise the fee estimated by the node for `transaction_payload`,
+/// following `fee_strategy` ('low', 'medium' or 'high').
 #[cfg(not(feature = "wasm"))]
-async fn build_unsigned_transaction(
-    construct_did: &ConstructDid,
-    signer_state: &mut ValueStore,
-    _spec: &CommandSpecification,
+pub async fn get_transaction_fee(
     fee: Option<u64>,
     fee_strategy: Option<&str>,
-    nonce: Option<u64>,
-    post_conditions: Vec<Value>,
-    post_condition_mode: Value,
+    transaction_payload: &TransactionPayload,
     values: &ValueStore,
-) -> Result<StacksTransaction, Diagnostic> {
-    use crate::constants::REQUIRED_SIGNATURE_COUNT;
-
+) -> Result<u64, Diagnostic> {
     use crate::constants::RPC_API_AUTH_TOKEN;
-    let transaction_payload_bytes = values.get_expected_buffer_bytes(TRANSACTION_PAYLOAD_BYTES)?;
-    let transaction_payload =
-        match TransactionPayload::consensus_deserialize(&mut &transaction_payload_bytes[..]) {
-            Ok(res) => res,
-            Err(e) => {
-                todo!("transaction payload invalid, return diagnostic ({})", e.to_string())
-            }
-        };
 
+    if let Some(fee) = fee {
+        return Ok(fee);
+    }
     let network_id = values.get_expected_string(NETWORK_ID)?;
     let default_payload = {
         let boot_address = match network_id {
@@ -359,25 +349,47 @@ async fn build_unsigned_transaction(
     let rpc_api_url = values.get_expected_string(RPC_API_URL)?;
     let rpc_api_auth_token = values.get_string(RPC_API_AUTH_TOKEN).and_then(|t| Some(t.to_owned()));
 
-    let fee = match fee {
-        Some(fee) => fee,
-        None => {
-            let fee_strategy = match fee_strategy {
-                Some("low") => 0,
-                Some("medium") => 1,
-                Some("high") => 2,
-                _ => 1,
-            };
-            let rpc = StacksRpc::new(&rpc_api_url, &rpc_api_auth_token);
-            let fee = rpc
-                .estimate_transaction_fee(&transaction_payload, fee_strategy, &default_payload)
-                .await
-                .map_err(|e| {
-                    diagnosed_error!("failure fetching fee estimation: {}", e.to_string())
-                })?;
-            fee
-        }
+    let fee_strategy = match fee_strategy {
+        Some("low") => 0,
+        Some("medium") => 1,
+        Some("high") => 2,
+        _ => 1,
     };
+    let rpc = StacksRpc::new(&rpc_api_url, &rpc_api_auth_token);
+    rpc.estimate_transaction_fee(transaction_payload, fee_strategy, &default_payload)
+        .await
+        .map_err(|e| diagnosed_error!("failure fetching fee estimation: {}", e.to_string()))
+}
+
+#[cfg(not(feature = "wasm"))]
+async fn build_unsigned_transaction(
+    construct_did: &ConstructDid,
+    signer_state: &mut ValueStore,
+    _spec: &CommandSpecification,
+    fee: Option<u64>,
+    fee_strategy: Option<&str>,
+    nonce: Option<u64>,
+    post_conditions: Vec<Value>,
+    post_condition_mode: Value,
+    values: &ValueStore,
+) -> Result<StacksTransaction, Diagnostic> {
+    use crate::constants::REQUIRED_SIGNATURE_COUNT;
+
+    use crate::constants::RPC_API_AUTH_TOKEN;
+    let transaction_payload_bytes = values.get_expected_buffer_bytes(TRANSACTION_PAYLOAD_BYTES)?;
+    let transaction_payload =
+        match TransactionPayload::consensus_deserialize(&mut &transaction_payload_bytes[..]) {
+            Ok(res) => res,
+            Err(e) => {
+                todo!("transaction payload invalid, return diagnostic ({})", e.to_string())
+            }
+        };
+
+    let network_id = values.get_expected_string(NETWORK_ID)?;
+    let rpc_api_url = values.get_expected_string(RPC_API_URL)?;
+    let rpc_api_auth_token = values.get_string(RPC_API_AUTH_TOKEN).and_then(|t| Some(t.to_owned()));
+
+    let fee = get_transaction_fee(fee, fee_strategy, &transaction_payload, values).await?;
 
     // Extract network_id
     let transaction_version = match network_id {
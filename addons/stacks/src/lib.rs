@@ -26,9 +26,10 @@ use constants::NAMESPACE;
 use txtx_addon_kit::{
     types::{
         commands::{CommandInputsEvaluationResult, CommandInstance, PreCommandSpecification},
+        cost_estimation::{CostEstimationFuture, CostEstimationRequest},
         diagnostics::Diagnostic,
         functions::FunctionSpecification,
-        signers::SignerSpecification,
+        signers::{SignerSpecification, SignersState},
         stores::ValueStore,
         AddonPostProcessingResult, ConstructDid, ContractSourceTransform,
     },
@@ -73,6 +74,15 @@ impl Addon for StacksNetworkAddon {
         signers::WALLETS.clone()
     }
 
+    #[cfg(not(feature = "wasm"))]
+    fn estimate_transactions_costs(
+        &self,
+        commands: Vec<CostEstimationRequest>,
+        signers: SignersState,
+    ) -> CostEstimationFuture {
+        crate::commands::actions::estimate_transactions_costs(commands, signers)
+    }
+
     fn get_domain_specific_commands_inputs_dependencies<'a>(
         self: &Self,
         commands_instances: &'a Vec<(
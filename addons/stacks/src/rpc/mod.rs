@@ -7,11 +7,13 @@ use clarity_repl::clarity::util::hash::{hex_bytes, to_hex};
 use clarity_repl::clarity::vm::types::Value;
 use serde_json::Value as JsonValue;
 use std::io::Cursor;
+use std::sync::Arc;
 use txtx_addon_kit::helpers::format_currency;
+use txtx_addon_kit::helpers::rpc_limiter::{rpc_endpoint_limiter, RpcEndpointLimiter};
 use txtx_addon_kit::reqwest::header::{HeaderMap, AUTHORIZATION};
 
 use serde_json::json;
-use txtx_addon_kit::reqwest::Client;
+use txtx_addon_kit::reqwest::{self, Client, RequestBuilder, Response};
 
 #[derive(Debug)]
 pub enum RpcError {
@@ -45,6 +47,7 @@ impl std::fmt::Display for RpcError {
 pub struct StacksRpc {
     pub url: String,
     pub client: Client,
+    pub limiter: Arc<RpcEndpointLimiter>,
 }
 
 pub struct PostTransactionResult {
@@ -193,9 +196,19 @@ impl StacksRpc {
         Self {
             url: url.into(),
             client: Client::builder().default_headers(default_headers).build().unwrap(),
+            limiter: rpc_endpoint_limiter(url),
         }
     }
 
+    /// Sends `request` within the budget of the endpoint, shared by all the clients of the
+    /// process. Endpoints answering HTTP 429 are throttled.
+    async fn send(&self, request: RequestBuilder) -> Result<Response, reqwest::Error> {
+        let _permit = self.limiter.acquire().await;
+        let res = request.send().await?;
+        self.limiter.record_http_response(&res);
+        Ok(res)
+    }
+
     #[cfg(not(feature = "wasm"))]
     #[async_recursion]
     pub async fn estimate_transaction_fee(
@@ -208,10 +221,7 @@ impl StacksRpc {
         let payload = json!({ "transaction_payload": to_hex(&tx) });
         let path = format!("{}/v2/fees/transaction", self.url);
         let res = self
-            .client
-            .post(path)
-            .json(&payload)
-            .send()
+            .send(self.client.post(path).json(&payload))
             .await
             .map_err(|e| RpcError::Message(e.to_string()))?;
 
@@ -251,11 +261,12 @@ impl StacksRpc {
     ) -> Result<PostTransactionResult, RpcError> {
         let path = format!("{}/v2/transactions", self.url);
         let res = self
-            .client
-            .post(path)
-            .header("Content-Type", "application/octet-stream")
-            .body(transaction.clone())
-            .send()
+            .send(
+                self.client
+                    .post(path)
+                    .header("Content-Type", "application/octet-stream")
+                    .body(transaction.clone()),
+            )
             .await
             .map_err(|e| RpcError::Message(e.to_string()))?;
 
@@ -347,9 +358,7 @@ impl StacksRpc {
             format!("{}/v2/accounts/{addr}?unanchored=true", self.url, addr = address,);
 
         let mut res: Balance = self
-            .client
-            .get(request_url)
-            .send()
+            .send(self.client.get(request_url))
             .await
             .map_err(|e| RpcError::Message(e.to_string()))?
             .json()
@@ -369,9 +378,7 @@ impl StacksRpc {
     pub async fn get_pox_info(&self) -> Result<PoxInfo, RpcError> {
         let request_url = format!("{}/v2/pox", self.url);
 
-        self.client
-            .get(request_url)
-            .send()
+        self.send(self.client.get(request_url))
             .await
             .map_err(|e| RpcError::Message(e.to_string()))?
             .json::<PoxInfo>()
@@ -382,9 +389,7 @@ impl StacksRpc {
     pub async fn get_info(&self) -> Result<NodeInfo, RpcError> {
         let request_url = format!("{}/v2/info", self.url);
 
-        self.client
-            .get(request_url)
-            .send()
+        self.send(self.client.get(request_url))
             .await
             .map_err(|e| RpcError::Message(e.to_string()))?
             .json::<NodeInfo>()
@@ -395,9 +400,7 @@ impl StacksRpc {
     pub async fn get_tx(&self, txid: &str) -> Result<GetTransactionResponse, RpcError> {
         let request_url = format!("{}/extended/v1/tx/{}", self.url, txid);
 
-        self.client
-            .get(request_url)
-            .send()
+        self.send(self.client.get(request_url))
             .await
             .map_err(|e| RpcError::Message(e.to_string()))?
             .json::<GetTransactionResponse>()
@@ -413,7 +416,7 @@ impl StacksRpc {
         let request_url =
             format!("{}/v2/contracts/source/{}/{}", self.url, principal, contract_name);
 
-        let res = self.client.get(request_url).send().await;
+        let res = self.send(self.client.get(request_url)).await;
 
         match res {
             Ok(response) => match response.json().await {
@@ -443,13 +446,10 @@ impl StacksRpc {
             arguments.push(bytes_to_hex(&bytes));
         }
         let res = self
-            .client
-            .post(path)
-            .json(&json!({
+            .send(self.client.post(path).json(&json!({
                 "sender": sender,
                 "arguments": arguments,
-            }))
-            .send()
+            })))
             .await
             .map_err(|e| RpcError::Message(e.to_string()))?;
 
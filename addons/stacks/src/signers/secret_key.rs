@@ -119,7 +119,7 @@ impl SignerImplementation for StacksSecretKey {
         signers: SignersState,
         _signers_instances: &HashMap<ConstructDid, SignerInstance>,
         supervision_context: &RunbookSupervisionContext,
-        _auth_ctx: &txtx_addon_kit::types::AuthorizationContext,
+        auth_ctx: &txtx_addon_kit::types::AuthorizationContext,
         _is_balance_check_required: bool,
         _is_public_key_required: bool,
     ) -> SignerActionsFutureResult {
@@ -150,9 +150,15 @@ impl SignerImplementation for StacksSecretKey {
                     values.get_string("derivation_path").unwrap_or(DEFAULT_DERIVATION_PATH);
                 let is_encrypted = values.get_bool("is_encrypted").unwrap_or(false);
                 let password = values.get_string("password");
-                secret_key_bytes_from_mnemonic(mnemonic, derivation_path, is_encrypted, password)
-                    .map_err(|e| (signers.clone(), signer_state.clone(), diagnosed_error!("{e}")))?
-                    .to_vec()
+                secret_key_bytes_from_mnemonic(
+                    &auth_ctx.run_resources,
+                    mnemonic,
+                    derivation_path,
+                    is_encrypted,
+                    password,
+                )
+                .map_err(|e| (signers.clone(), signer_state.clone(), diagnosed_error!("{e}")))?
+                .to_vec()
             }
         };
 
@@ -427,7 +427,7 @@ impl DeploymentTransaction {
         &self,
         rpc_api_url: &str,
     ) -> Result<Transaction, Diagnostic> {
-        let rpc_client = RpcClient::new_with_commitment(
+        let rpc_client = crate::rpc::blocking_rpc_client(
             rpc_api_url,
             CommitmentConfig { commitment: self.commitment_level },
         );
@@ -589,7 +589,8 @@ impl DeploymentTransaction {
             // (because the bpf program throws if so), so after the extend program tx we'll wait one slot before continuing
             DeploymentTransactionType::ExtendProgram
             | DeploymentTransactionType::CreateBufferAndExtendProgram { .. } => {
-                let rpc_client = RpcClient::new(rpc_api_url.to_string());
+                let rpc_client =
+                    crate::rpc::blocking_rpc_client(rpc_api_url, CommitmentConfig::default());
                 wait_n_slots(&rpc_client, 1);
             }
             _ => {}
@@ -1381,7 +1382,8 @@ impl UpgradeableProgramDeployer {
         let temp_upgrade_authority_pubkey = temp_upgrade_authority_keypair.pubkey();
 
         // use processed commitment so we're sure to get the most recent balance
-        let rpc_client = RpcClient::new_with_commitment(rpc_api_url, CommitmentConfig::confirmed());
+        let rpc_client =
+            crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::confirmed());
 
         let err_prefix = format!(
             "failed to close temp upgrade authority account ({}) and send funds back to the payer",
@@ -1598,6 +1600,39 @@ where
     PACKET_DATA_SIZE.saturating_sub(tx_size).saturating_sub(1)
 }
 
+/// Estimates the lamports paid to deploy a program of `binary_len` bytes: the fees of the
+/// transactions creating, writing and finalizing the buffer, and the rent of the program
+/// accounts. Buffers already written and rent already held by upgraded programs are not
+/// deducted, so upgrades are overestimated.
+pub async fn estimate_program_deployment_lamports(
+    rpc_client: &solana_client::nonblocking::rpc_client::RpcClient,
+    binary_len: usize,
+) -> Result<u64, Diagnostic> {
+    // the size of the write messages does not depend on the actual accounts
+    let buffer_pubkey = Pubkey::new_from_array([1; 32]);
+    let authority_pubkey = Pubkey::new_from_array([2; 32]);
+    let create_msg = |offset: u32, bytes: Vec<u8>| {
+        let instruction =
+            bpf_loader_upgradeable::write(&buffer_pubkey, &authority_pubkey, offset, bytes);
+        Message::new_with_blockhash(&[instruction], Some(&authority_pubkey), &Hash::default())
+    };
+    let write_tx_count = binary_len.div_ceil(calculate_max_chunk_size(&create_msg));
+    // buffer creation, buffer authority transfer, deployment and return of the funds
+    let tx_count = write_tx_count + 4;
+    let mut lamports = LAMPORTS_PER_SIGNATURE * tx_count as u64;
+
+    for account_size in [
+        UpgradeableLoaderState::size_of_programdata(binary_len),
+        UpgradeableLoaderState::size_of_program(),
+    ] {
+        lamports += rpc_client
+            .get_minimum_balance_for_rent_exemption(account_size)
+            .await
+            .map_err(|e| diagnosed_error!("failed to get rent exemption: {e}"))?;
+    }
+    Ok(lamports)
+}
+
 pub fn transaction_is_fully_signed(transaction: &Transaction) -> bool {
     let expected_signature_count = transaction.message.header.num_required_signatures as usize;
     let actual_signature_count = transaction.signatures.len();
@@ -1,22 +1,31 @@
 use std::sync::Arc;
+use std::time::Duration;
 
 use solana_client::rpc_client::RpcClient;
-use solana_client::rpc_config::RpcSendTransactionConfig;
+use solana_client::rpc_config::{RpcSendTransactionConfig, RpcSignatureSubscribeConfig};
+use solana_client::rpc_response::RpcSignatureResult;
 use solana_commitment_config::{CommitmentConfig, CommitmentLevel};
 use solana_transaction::Transaction;
 use txtx_addon_kit::channel;
 use txtx_addon_kit::constants::SIGNED_TRANSACTION_BYTES;
+use txtx_addon_kit::futures::StreamExt;
 use txtx_addon_kit::types::commands::CommandExecutionResult;
 use txtx_addon_kit::types::commands::{CommandExecutionFutureResult, CommandSpecification};
 use txtx_addon_kit::types::diagnostics::Diagnostic;
 use txtx_addon_kit::types::frontend::{BlockEvent, LogDispatcher};
+use txtx_addon_kit::types::run_resources::RunResources;
 use txtx_addon_kit::types::stores::ValueStore;
 use txtx_addon_kit::types::types::{RunbookSupervisionContext, ThirdPartySignatureStatus, Value};
-use txtx_addon_kit::types::ConstructDid;
+use txtx_addon_kit::types::{AuthorizationContext, ConstructDid};
 
 use crate::constants::{
-    COMMITMENT_LEVEL, DO_AWAIT_CONFIRMATION, IS_DEPLOYMENT, RPC_API_URL, SIGNATURE,
+    COMMITMENT_LEVEL, DO_AWAIT_CONFIRMATION, IS_DEPLOYMENT, RPC_API_URL, RPC_WS_URL, SIGNATURE,
 };
+use crate::rpc::{evict_pubsub_client, pubsub_client};
+
+/// Time allowed for a transaction to reach its commitment level once sent, past the lifetime
+/// of its blockhash (150 slots)
+const SIGNATURE_NOTIFICATION_TIMEOUT: Duration = Duration::from_secs(90);
 
 pub fn send_transaction_background_task(
     construct_did: &ConstructDid,
@@ -25,6 +34,7 @@ pub fn send_transaction_background_task(
     outputs: &ValueStore,
     progress_tx: &channel::Sender<BlockEvent>,
     _supervision_context: &RunbookSupervisionContext,
+    auth_context: &AuthorizationContext,
 ) -> CommandExecutionFutureResult {
     let outputs = outputs.clone();
     let third_party_signature_status = inputs.get_third_party_signature_status();
@@ -41,9 +51,11 @@ pub fn send_transaction_background_task(
     let inputs = inputs.clone();
     let progress_tx = progress_tx.clone();
     let construct_did = construct_did.clone();
+    let run_resources = auth_context.run_resources.clone();
 
     let future = async move {
         let rpc_api_url = inputs.get_expected_string(RPC_API_URL).unwrap().to_string();
+        let rpc_ws_url = inputs.get_string(RPC_WS_URL).map(|url| url.to_string());
         let commitment_level = inputs.get_expected_string(COMMITMENT_LEVEL).unwrap_or("confirmed");
         let do_await_confirmation = inputs.get_bool(DO_AWAIT_CONFIRMATION).unwrap_or(true);
         let is_deployment = inputs.get_bool(IS_DEPLOYMENT).unwrap_or(false);
@@ -63,10 +75,8 @@ pub fn send_transaction_background_task(
             },
         };
 
-        let client = Arc::new(RpcClient::new_with_commitment(
-            rpc_api_url.clone(),
-            commitment_config.clone(),
-        ));
+        let client =
+            Arc::new(crate::rpc::blocking_rpc_client(&rpc_api_url, commitment_config.clone()));
 
         let logger =
             LogDispatcher::new(construct_did.as_uuid(), "svm::send_transaction", &progress_tx);
@@ -76,12 +86,25 @@ pub fn send_transaction_background_task(
         let transaction_bytes = signed_transaction_value
             .get_buffer_bytes_result()
             .map_err(|e| diagnosed_error!("{}", e))?;
-        let signature = send_transaction(
-            client.clone(),
-            do_await_confirmation,
-            &transaction_bytes,
-            commitment_config.commitment,
-        )
+        let signature = match rpc_ws_url.filter(|_| do_await_confirmation) {
+            Some(rpc_ws_url) => {
+                send_and_confirm_transaction_with_subscription(
+                    client.clone(),
+                    &run_resources,
+                    &rpc_ws_url,
+                    &transaction_bytes,
+                    commitment_config,
+                    &logger,
+                )
+                .await
+            }
+            None => send_transaction(
+                client.clone(),
+                do_await_confirmation,
+                &transaction_bytes,
+                commitment_config.commitment,
+            ),
+        }
         .map_err(|diag| {
             logger.failure_with_diag("Failed", "Failed to broadcast transaction", &diag);
             diag
@@ -126,3 +149,79 @@ pub fn send_transaction(
 
     Ok(signature.to_string())
 }
+
+/// Sends a transaction and waits for it to reach `commitment`, notified by a signature
+/// subscription on the websocket endpoint `ws_url` instead of polling the RPC. Falls back to
+/// polling if the subscription can't be opened or ends early.
+pub async fn send_and_confirm_transaction_with_subscription(
+    rpc_client: Arc<RpcClient>,
+    run_resources: &RunResources,
+    ws_url: &str,
+    transaction_bytes: &Vec<u8>,
+    commitment: CommitmentConfig,
+    logger: &LogDispatcher,
+) -> Result<String, Diagnostic> {
+    let transaction: Transaction = serde_json::from_slice(&transaction_bytes).map_err(|e| {
+        diagnosed_error!("unable to deserialize transaction from bytes ({})", e.to_string())
+    })?;
+    let signature = transaction.signatures.first().cloned().unwrap_or_default();
+
+    // subscribing before sending the transaction, so that the notification can't be missed
+    let pubsub = match pubsub_client(run_resources, ws_url).await {
+        Ok(pubsub) => Some(pubsub),
+        Err(e) => {
+            logger.warn("Websocket", format!("{}, polling for the confirmation instead", e));
+            None
+        }
+    };
+    let config = RpcSignatureSubscribeConfig {
+        commitment: Some(commitment),
+        enable_received_notification: Some(false),
+    };
+    let subscription = match pubsub.as_ref() {
+        Some(pubsub) => match pubsub.signature_subscribe(&signature, Some(config)).await {
+            Ok(subscription) => Some(subscription),
+            Err(e) => {
+                // the shared connection was closed, the next transaction reconnects
+                evict_pubsub_client(run_resources, ws_url);
+                logger.warn(
+                    "Websocket",
+                    format!("unable to subscribe to {}: {}, polling instead", signature, e),
+                );
+                None
+            }
+        },
+        None => None,
+    };
+
+    rpc_client
+        .send_transaction(&transaction)
+        .map_err(|e| diagnosed_error!("unable to send transaction ({})", e.to_string()))?;
+
+    let mut confirmed = false;
+    if let Some((mut notifications, unsubscribe)) = subscription {
+        let notification =
+            tokio::time::timeout(SIGNATURE_NOTIFICATION_TIMEOUT, notifications.next()).await;
+        if let Ok(Some(response)) = notification {
+            if let RpcSignatureResult::ProcessedSignature(result) = response.value {
+                if let Some(err) = result.err {
+                    return Err(diagnosed_error!(
+                        "unable to send and confirm transaction ({:?})",
+                        err
+                    ));
+                }
+                confirmed = true;
+            }
+        }
+        drop(notifications);
+        unsubscribe().await;
+    }
+
+    if !confirmed {
+        rpc_client.poll_for_signature_with_commitment(&signature, commitment).map_err(|e| {
+            diagnosed_error!("unable to send and confirm transaction ({})", e.to_string())
+        })?;
+    }
+
+    Ok(signature.to_string())
+}
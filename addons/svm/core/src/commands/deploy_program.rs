@@ -2,7 +2,6 @@ use std::collections::HashMap;
 use std::str::FromStr;
 use std::vec;
 
-use solana_client::rpc_client::RpcClient;
 use solana_commitment_config::CommitmentConfig;
 use solana_pubkey::Pubkey;
 use txtx_addon_kit::channel;
@@ -220,7 +219,7 @@ impl CommandImplementation for DeployProgram {
         let do_cheatcode_deployment = values.get_bool(INSTANT_SURFNET_DEPLOYMENT).unwrap_or(false);
 
         let rpc_client =
-            RpcClient::new_with_commitment(rpc_api_url.clone(), CommitmentConfig::finalized());
+            crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::finalized());
 
         let is_surfnet = UpgradeableProgramDeployer::check_is_surfnet(&rpc_client)
             .map_err(|e| (signers.clone(), authority_signer_state.clone(), e))?;
@@ -412,7 +411,7 @@ impl CommandImplementation for DeployProgram {
         let transaction_array = transactions.as_array().unwrap();
         let transaction_count = transaction_array.len();
         for (i, transaction_value) in transaction_array.iter().enumerate() {
-            let new_did = ConstructDid(Did::from_components(vec![
+            let new_did = ConstructDid(Did::from_components([
                 construct_did.as_bytes(),
                 cursor.to_string().as_bytes(),
             ]));
@@ -738,6 +737,7 @@ impl CommandImplementation for DeployProgram {
         _background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let construct_did = construct_did.clone();
         let spec = spec.clone();
@@ -745,6 +745,7 @@ impl CommandImplementation for DeployProgram {
         let outputs = outputs.clone();
         let progress_tx = progress_tx.clone();
         let supervision_context = supervision_context.clone();
+        let auth_context = auth_context.clone();
         let cloud_service_context = cloud_service_context.clone();
 
         let future = async move {
@@ -791,9 +792,7 @@ impl CommandImplementation for DeployProgram {
                     let (upgrade_authority, data) =
                         deployment_transaction.cheatcode_data.as_ref().unwrap();
                     cheatcode_deploy_program(
-                        &solana_client::nonblocking::rpc_client::RpcClient::new(
-                            rpc_api_url.clone(),
-                        ),
+                        &crate::rpc::rpc_client(&rpc_api_url, CommitmentConfig::default()),
                         program_id,
                         data,
                         Some(*upgrade_authority),
@@ -832,6 +831,7 @@ impl CommandImplementation for DeployProgram {
                         &outputs,
                         &progress_tx,
                         &supervision_context,
+                        &auth_context,
                     ) {
                         Ok(res) => match res.await {
                             Ok(res) => res,
@@ -853,7 +853,8 @@ impl CommandImplementation for DeployProgram {
             deployment_transaction.post_send_actions(&rpc_api_url);
 
             if transaction_index == transaction_count - 1 {
-                let rpc_client = RpcClient::new(rpc_api_url);
+                let rpc_client =
+                    crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::default());
                 if let Ok(slot) = rpc_client.get_slot() {
                     result.insert(SLOT, Value::integer(slot as i128));
                 };
@@ -244,6 +244,7 @@ impl CommandImplementation for DeployProgram {
         _background_tasks_uuid: &Uuid,
         _supervision_context: &RunbookSupervisionContext,
         cloud_service_context: &Option<CloudServiceContext>,
+        _auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let outputs = outputs.clone();
         let progress_tx = progress_tx.clone();
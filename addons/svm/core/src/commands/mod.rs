@@ -1,3 +1,5 @@
+use std::str::FromStr;
+
 use crate::constants::{SIGNER, SIGNERS};
 use deploy_program::DEPLOY_PROGRAM;
 use deploy_subraph::DEPLOY_SUBGRAPH;
@@ -9,7 +11,13 @@ use setup_surfnet::SETUP_SURFNET;
 use solana_client::rpc_request::RpcRequest;
 // use srs::create_class::CREATE_CLASS;
 // use srs::create_record::CREATE_RECORD;
+use solana_pubkey::Pubkey;
 use txtx_addon_kit::types::commands::PreCommandSpecification;
+use txtx_addon_kit::types::cost_estimation::{
+    CostEstimationFuture, CostEstimationRequest, CostEstimationResult, SignerBalance,
+    TransactionCostEstimate,
+};
+use txtx_addon_kit::types::signers::SignersState;
 use txtx_addon_kit::types::stores::ValueStore;
 use txtx_addon_kit::types::{diagnostics::Diagnostic, ConstructDid, Did};
 
@@ -84,3 +92,154 @@ lazy_static! {
         // CREATE_RECORD.clone(),
     ];
 }
+
+/// Estimates the fees of the transactions of `commands`, concurrently with the balances of
+/// the signers paying them, fetched once per address and endpoint.
+pub fn estimate_transactions_costs(
+    commands: Vec<CostEstimationRequest>,
+    signers: SignersState,
+) -> CostEstimationFuture {
+    use std::collections::BTreeMap;
+
+    use solana_commitment_config::CommitmentConfig;
+    use txtx_addon_kit::futures::future::join_all;
+    use txtx_addon_kit::futures::join;
+
+    use crate::constants::{AUTHORITY, CHECKED_PUBLIC_KEY, PAYER, RPC_API_URL};
+    use crate::typing::SvmValue;
+
+    let future = async move {
+        let payers = commands
+            .iter()
+            .map(|command| {
+                let network = command.inputs.get_string(RPC_API_URL).unwrap_or("").to_string();
+                let signer_did = match command.matcher.as_str() {
+                    "deploy_program" => get_custom_signer_did(&command.inputs, PAYER)
+                        .or_else(|_| get_custom_signer_did(&command.inputs, AUTHORITY)),
+                    "process_instructions" => get_signers_did(&command.inputs).and_then(|dids| {
+                        dids.into_iter().next().ok_or(diagnosed_error!("no signer"))
+                    }),
+                    _ => get_signer_did(&command.inputs),
+                };
+                let payer = signer_did.ok().map(|signer_did| {
+                    let pubkey = signers
+                        .get_signer_state(&signer_did)
+                        .and_then(|state| state.get_value(CHECKED_PUBLIC_KEY))
+                        .and_then(|value| SvmValue::to_pubkey(value).ok());
+                    (signer_did, pubkey)
+                });
+                (network, payer)
+            })
+            .collect::<Vec<_>>();
+        let mut balances_to_check = BTreeMap::new();
+        for (network, payer) in payers.iter() {
+            if let Some((signer_did, Some(pubkey))) = payer {
+                balances_to_check
+                    .entry((network.clone(), *pubkey))
+                    .or_insert_with(|| signer_did.clone());
+            }
+        }
+
+        let estimates = join_all(commands.iter().zip(payers.iter()).map(
+            |(command, (network, payer))| async move {
+                let payer_pubkey = payer.as_ref().and_then(|(_, pubkey)| *pubkey);
+                let (fee, amount) = match estimate_transaction_fee(command, payer_pubkey).await {
+                    Ok((fee, amount)) => (Ok(fee as u128), amount as u128),
+                    Err(diag) => (Err(diag.message), 0),
+                };
+                TransactionCostEstimate {
+                    construct_did: command.construct_did.clone(),
+                    construct_name: command.construct_name.clone(),
+                    network: network.clone(),
+                    denomination: "lamports".into(),
+                    payer: payer.clone().map(|(signer_did, pubkey)| {
+                        (signer_did, pubkey.map(|pubkey| pubkey.to_string()))
+                    }),
+                    fee,
+                    amount,
+                }
+            },
+        ));
+        let balances = join_all(balances_to_check.into_iter().map(
+            |((network, pubkey), signer_did)| async move {
+                let rpc_client = crate::rpc::rpc_client(&network, CommitmentConfig::default());
+                let balance = rpc_client
+                    .get_balance(&pubkey)
+                    .await
+                    .map(|balance| balance as u128)
+                    .map_err(|e| e.to_string());
+                SignerBalance {
+                    signer_did,
+                    network,
+                    denomination: "lamports".into(),
+                    address: pubkey.to_string(),
+                    balance,
+                }
+            },
+        ));
+        let (transactions, balances) = join!(estimates, balances);
+        CostEstimationResult { transactions, balances }
+    };
+    Box::pin(future)
+}
+
+/// Returns the fee of the transaction produced by `command`, and the amount it transfers.
+/// Program deployments are estimated with the rent of the program accounts.
+async fn estimate_transaction_fee(
+    command: &CostEstimationRequest,
+    payer: Option<Pubkey>,
+) -> Result<(u64, u64), Diagnostic> {
+    use solana_commitment_config::CommitmentConfig;
+    use solana_message::Message;
+
+    use crate::codec::estimate_program_deployment_lamports;
+    use crate::codec::instruction::parse_instructions_map;
+    use crate::codec::ProgramArtifacts;
+    use crate::constants::{AMOUNT, PROGRAM, RECIPIENT, RPC_API_URL};
+
+    let values = &command.inputs;
+    let rpc_client = crate::rpc::rpc_client(
+        values.get_expected_string(RPC_API_URL)?,
+        CommitmentConfig::default(),
+    );
+    let mut amount = 0;
+    let instructions = match command.matcher.as_str() {
+        "send_sol" => {
+            let Some(payer) = payer else {
+                return Err(diagnosed_error!("signer requires user interaction"));
+            };
+            amount = values.get_expected_uint(AMOUNT)?;
+            let recipient = Pubkey::from_str(values.get_expected_string(RECIPIENT)?)
+                .map_err(|e| diagnosed_error!("invalid recipient: {}", e.to_string()))?;
+            vec![solana_system_interface::instruction::transfer(&payer, &recipient, amount)]
+        }
+        "process_instructions" => parse_instructions_map(values)
+            .map_err(|e| diagnosed_error!("invalid instructions: {e}"))?,
+        "deploy_program" => {
+            let program_artifacts =
+                ProgramArtifacts::from_value(values.get_expected_value(PROGRAM)?)
+                    .map_err(|e| diagnosed_error!("{}", e))?;
+            let lamports =
+                estimate_program_deployment_lamports(&rpc_client, program_artifacts.bin().len())
+                    .await?;
+            return Ok((lamports, 0));
+        }
+        _ => {
+            return Err(diagnosed_error!(
+                "cost estimation is not supported by '{}'",
+                command.matcher
+            ))
+        }
+    };
+    // fees depend on the signatures required, the payer being one of them
+    let mut message = Message::new(&instructions, payer.as_ref());
+    message.recent_blockhash = rpc_client
+        .get_latest_blockhash()
+        .await
+        .map_err(|e| diagnosed_error!("failed to retrieve latest blockhash: {}", e.to_string()))?;
+    let fee = rpc_client
+        .get_fee_for_message(&message)
+        .await
+        .map_err(|e| diagnosed_error!("failed to retrieve fee: {}", e.to_string()))?;
+    Ok((fee, amount))
+}
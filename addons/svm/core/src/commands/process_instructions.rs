@@ -1,6 +1,6 @@
 use std::collections::HashMap;
 
-use solana_client::rpc_client::RpcClient;
+use solana_commitment_config::CommitmentConfig;
 use solana_message::Message;
 use solana_transaction::Transaction;
 use txtx_addon_kit::channel;
@@ -152,7 +152,7 @@ impl CommandImplementation for ProcessInstructions {
         })?;
 
         let mut message = Message::new(&instructions, None);
-        let client = RpcClient::new(rpc_api_url);
+        let client = crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::default());
         message.recent_blockhash = client.get_latest_blockhash().map_err(|e| {
             (
                 signers.clone(),
@@ -217,6 +217,7 @@ impl CommandImplementation for ProcessInstructions {
         _background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         send_transaction_background_task(
             &construct_did,
@@ -225,6 +226,7 @@ impl CommandImplementation for ProcessInstructions {
             &outputs,
             &progress_tx,
             &supervision_context,
+            auth_context,
         )
     }
 }
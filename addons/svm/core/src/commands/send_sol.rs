@@ -1,7 +1,7 @@
 use std::collections::HashMap;
 use std::str::FromStr;
 
-use solana_client::rpc_client::RpcClient;
+use solana_commitment_config::CommitmentConfig;
 use solana_message::Message;
 use solana_pubkey::Pubkey;
 use solana_transaction::Transaction;
@@ -166,7 +166,7 @@ impl CommandImplementation for SendSol {
             solana_system_interface::instruction::transfer(&signer_pubkey, &recipient, amount);
 
         let mut message = Message::new(&vec![instruction], None);
-        let client = RpcClient::new(rpc_api_url);
+        let client = crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::default());
         message.recent_blockhash = client.get_latest_blockhash().map_err(|e| {
             (
                 signers.clone(),
@@ -232,6 +232,7 @@ impl CommandImplementation for SendSol {
         _background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         send_transaction_background_task(
             &construct_did,
@@ -240,6 +241,7 @@ impl CommandImplementation for SendSol {
             &outputs,
             &progress_tx,
             &supervision_context,
+            auth_context,
         )
     }
 }
@@ -1,7 +1,7 @@
 use std::collections::{HashMap, VecDeque};
 use std::str::FromStr;
 
-use solana_client::rpc_client::RpcClient;
+use solana_commitment_config::CommitmentConfig;
 use solana_message::Message;
 use solana_pubkey::Pubkey;
 use solana_transaction::Transaction;
@@ -269,7 +269,7 @@ impl CommandImplementation for SendToken {
             )
         })?]);
 
-        let client = RpcClient::new(rpc_api_url);
+        let client = crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::default());
 
         let do_create_account = match client.get_account(&recipient_token_address) {
             Ok(recipient_account) => recipient_account.lamports == 0,
@@ -439,6 +439,7 @@ impl CommandImplementation for SendToken {
         _background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let logger = LogDispatcher::new(construct_did.as_uuid(), "svm::send_token", &progress_tx);
         let recipient_token_address =
@@ -486,6 +487,7 @@ impl CommandImplementation for SendToken {
             &outputs,
             &progress_tx,
             &supervision_context,
+            auth_context,
         )
     }
 }
@@ -10,7 +10,7 @@ mod tokens;
 use clone_program_account::SurfpoolProgramCloning;
 use set_account::SurfpoolAccountUpdate;
 use set_token_account::SurfpoolTokenAccountUpdate;
-use solana_client::nonblocking::rpc_client::RpcClient;
+use solana_commitment_config::CommitmentConfig;
 use txtx_addon_kit::channel;
 use txtx_addon_kit::types::cloud_interface::CloudServiceContext;
 use txtx_addon_kit::types::commands::{
@@ -206,7 +206,7 @@ impl CommandImplementation for SetupSurfpool {
 
             let rpc_api_url = values.get_expected_string(RPC_API_URL)?;
 
-            let rpc_client = RpcClient::new(rpc_api_url.to_string());
+            let rpc_client = crate::rpc::rpc_client(rpc_api_url, CommitmentConfig::default());
 
             let version = RpcVersionInfo::fetch_non_blocking(&rpc_client).await?;
             if version.surfnet_version.is_none() {
@@ -271,6 +271,7 @@ impl CommandImplementation for SetupSurfpool {
         _background_tasks_uuid: &Uuid,
         _supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        _auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         return_synchronous_ok(CommandExecutionResult::new())
     }
@@ -2,7 +2,6 @@ use std::collections::HashMap;
 use std::future;
 
 use kaigan::types::RemainderStr;
-use solana_client::rpc_client::RpcClient;
 use solana_record_service_client::accounts::Class;
 use solana_record_service_client::instructions::{
     CreateClassBuilder, FreezeClassBuilder, UpdateClassMetadataBuilder,
@@ -222,7 +221,7 @@ impl CommandImplementation for ProcessInstructions {
             .map_err(|diag| (signers.clone(), signer_state.clone(), diag))?
             .to_string();
 
-        let client = RpcClient::new(rpc_api_url);
+        let client = crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::default());
 
         let authority = signer_state
             .get_expected_value(CHECKED_PUBLIC_KEY)
@@ -478,6 +477,7 @@ impl CommandImplementation for ProcessInstructions {
         _background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let construct_did = construct_did.clone();
         let spec = spec.clone();
@@ -485,6 +485,7 @@ impl CommandImplementation for ProcessInstructions {
         let outputs = outputs.clone();
         let progress_tx = progress_tx.clone();
         let supervision_context = supervision_context.clone();
+        let auth_context = auth_context.clone();
 
         let future = async move {
             let name = inputs.get_value("name").unwrap();
@@ -503,6 +504,7 @@ impl CommandImplementation for ProcessInstructions {
                     &outputs,
                     &progress_tx,
                     &supervision_context,
+                    &auth_context,
                 ) {
                     Ok(res) => match res.await {
                         Ok(res) => res,
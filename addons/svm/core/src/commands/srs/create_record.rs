@@ -1,6 +1,5 @@
 use borsh::BorshDeserialize;
 use kaigan::types::{RemainderStr, RemainderVec};
-use solana_client::rpc_client::RpcClient;
 use solana_commitment_config::CommitmentConfig;
 use solana_message::Message;
 use solana_pubkey::Pubkey;
@@ -263,7 +262,7 @@ impl CommandImplementation for ProcessInstructions {
             .get_expected_string(RPC_API_URL)
             .map_err(|diag| (signers.clone(), owner_signer_state.clone(), diag))?
             .to_string();
-        let client = RpcClient::new(rpc_api_url);
+        let client = crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::default());
 
         let class = args
             .get_expected_value("class")
@@ -604,6 +603,7 @@ impl CommandImplementation for ProcessInstructions {
         _background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        auth_context: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let construct_did = construct_did.clone();
         let spec = spec.clone();
@@ -611,6 +611,7 @@ impl CommandImplementation for ProcessInstructions {
         let outputs = outputs.clone();
         let progress_tx = progress_tx.clone();
         let supervision_context = supervision_context.clone();
+        let auth_context = auth_context.clone();
 
         let future = async move {
             let name = inputs.get_value("name").unwrap();
@@ -649,6 +650,7 @@ impl CommandImplementation for ProcessInstructions {
                     &outputs,
                     &progress_tx,
                     &supervision_context,
+                    &auth_context,
                 ) {
                     Ok(res) => match res.await {
                         Ok(res) => res,
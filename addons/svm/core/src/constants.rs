@@ -29,6 +29,7 @@ pub const KEYPAIR_JSON: &str = "keypair_json";
 
 // Defaults keys
 pub const RPC_API_URL: &str = "rpc_api_url";
+pub const RPC_WS_URL: &str = "rpc_ws_url";
 pub const PROGRAM_ID: &str = "program_id";
 pub const PROGRAM_IDL: &str = "program_idl";
 pub const PROGRAM: &str = "program";
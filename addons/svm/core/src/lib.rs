@@ -21,8 +21,10 @@ pub mod typing {
 use constants::NAMESPACE;
 use txtx_addon_kit::{
     types::{
-        commands::PreCommandSpecification, functions::FunctionSpecification,
-        signers::SignerSpecification,
+        commands::PreCommandSpecification,
+        cost_estimation::{CostEstimationFuture, CostEstimationRequest},
+        functions::FunctionSpecification,
+        signers::{SignerSpecification, SignersState},
     },
     Addon,
 };
@@ -66,6 +68,14 @@ impl Addon for SvmNetworkAddon {
         signers::SIGNERS.clone()
     }
 
+    fn estimate_transactions_costs(
+        &self,
+        commands: Vec<CostEstimationRequest>,
+        signers: SignersState,
+    ) -> CostEstimationFuture {
+        crate::commands::estimate_transactions_costs(commands, signers)
+    }
+
     fn to_json(
         &self,
         value: &txtx_addon_kit::types::types::Value,
@@ -10,3 +10,121 @@
 //         RpcClient::
 //     }
 // }
+
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex};
+
+use solana_client::client_error::{ClientErrorKind, Result as ClientResult};
+use solana_client::http_sender::HttpSender;
+use solana_client::nonblocking::pubsub_client::PubsubClient;
+use solana_client::rpc_client::RpcClientConfig;
+use solana_client::rpc_request::RpcRequest;
+use solana_client::rpc_sender::{RpcSender, RpcTransportStats};
+use solana_commitment_config::CommitmentConfig;
+use txtx_addon_kit::helpers::rpc_limiter::{rpc_endpoint_limiter, RpcEndpointLimiter};
+use txtx_addon_kit::types::run_resources::RunResources;
+
+/// Websocket clients of a run, by endpoint. A client spawns its connection on the runtime
+/// executing the run, and is not shared with other runs.
+#[derive(Default)]
+struct PubsubClients {
+    clients: Mutex<HashMap<String, Arc<PubsubClient>>>,
+}
+
+/// Returns the websocket client of the endpoint `ws_url`, connecting on first use in the run.
+/// The connection is long-lived and shared by the constructs of the run subscribing to this
+/// endpoint.
+pub async fn pubsub_client(
+    run_resources: &RunResources,
+    ws_url: &str,
+) -> Result<Arc<PubsubClient>, String> {
+    if !ws_url.starts_with("ws://") && !ws_url.starts_with("wss://") {
+        return Err(format!("invalid websocket url {}: expected a ws:// or wss:// url", ws_url));
+    }
+    let pubsub_clients = run_resources.get_or_init(PubsubClients::default);
+    if let Some(client) = pubsub_clients.clients.lock().unwrap().get(ws_url) {
+        return Ok(client.clone());
+    }
+    let client = PubsubClient::new(ws_url)
+        .await
+        .map_err(|e| format!("unable to connect to {}: {}", ws_url, e))?;
+    Ok(pubsub_clients
+        .clients
+        .lock()
+        .unwrap()
+        .entry(ws_url.to_string())
+        .or_insert_with(|| Arc::new(client))
+        .clone())
+}
+
+/// Drops the shared connection to `ws_url`, the next subscription of the run reconnects.
+pub fn evict_pubsub_client(run_resources: &RunResources, ws_url: &str) {
+    run_resources.get_or_init(PubsubClients::default).clients.lock().unwrap().remove(ws_url);
+}
+
+/// Sends the requests of an RPC client within the budget of its endpoint, shared with the other
+/// clients of the endpoint (see [txtx_addon_kit::helpers::rpc_limiter]).
+struct LimitedHttpSender {
+    inner: HttpSender,
+    limiter: Arc<RpcEndpointLimiter>,
+}
+
+#[async_trait::async_trait]
+impl RpcSender for LimitedHttpSender {
+    async fn send(
+        &self,
+        request: RpcRequest,
+        params: serde_json::Value,
+    ) -> ClientResult<serde_json::Value> {
+        let _permit = self.limiter.acquire().await;
+        let result = self.inner.send(request, params).await;
+        // the http sender retries throttled requests on its own, and only fails once its
+        // retries are exhausted
+        if let Err(e) = &result {
+            if let ClientErrorKind::Reqwest(e) = e.kind() {
+                if e.status().map(|status| status.as_u16()) == Some(429) {
+                    self.limiter.throttle(None);
+                }
+            }
+        }
+        result
+    }
+
+    fn get_transport_stats(&self) -> RpcTransportStats {
+        self.inner.get_transport_stats()
+    }
+
+    fn url(&self) -> String {
+        self.inner.url()
+    }
+}
+
+fn limited_http_sender(rpc_api_url: &str) -> LimitedHttpSender {
+    LimitedHttpSender {
+        inner: HttpSender::new(rpc_api_url.to_string()),
+        limiter: rpc_endpoint_limiter(rpc_api_url),
+    }
+}
+
+/// Returns a client of the endpoint `rpc_api_url`, sending its requests within the budget of the
+/// endpoint.
+pub fn rpc_client(
+    rpc_api_url: &str,
+    commitment: CommitmentConfig,
+) -> solana_client::nonblocking::rpc_client::RpcClient {
+    solana_client::nonblocking::rpc_client::RpcClient::new_sender(
+        limited_http_sender(rpc_api_url),
+        RpcClientConfig::with_commitment(commitment),
+    )
+}
+
+/// Blocking flavor of [rpc_client].
+pub fn blocking_rpc_client(
+    rpc_api_url: &str,
+    commitment: CommitmentConfig,
+) -> solana_client::rpc_client::RpcClient {
+    solana_client::rpc_client::RpcClient::new_sender(
+        limited_http_sender(rpc_api_url),
+        RpcClientConfig::with_commitment(commitment),
+    )
+}
@@ -5,6 +5,7 @@ pub mod web_wallet;
 use crate::functions::lamports_to_sol;
 use secret_key::SVM_SECRET_KEY;
 use solana_client::nonblocking::rpc_client::RpcClient;
+use solana_commitment_config::CommitmentConfig;
 use solana_pubkey::Pubkey;
 use squads::SVM_SQUADS;
 use txtx_addon_kit::types::{
@@ -44,7 +45,7 @@ pub async fn get_additional_actions_for_address(
 ) -> Result<Vec<ActionItemRequest>, Diagnostic> {
     let mut action_items: Vec<ActionItemRequest> = vec![];
 
-    let solana_rpc = RpcClient::new(rpc_api_url.to_string());
+    let solana_rpc = crate::rpc::rpc_client(rpc_api_url, CommitmentConfig::default());
 
     if do_request_public_key {
         action_items.push(
@@ -1,6 +1,5 @@
 use std::collections::HashMap;
 
-use solana_client::rpc_client::RpcClient;
 use solana_commitment_config::{CommitmentConfig, CommitmentLevel};
 use solana_keypair::Keypair;
 use solana_transaction::Transaction;
@@ -200,6 +199,7 @@ impl SignerImplementation for SvmSecretKey {
                     let is_encrypted = values.get_bool(IS_ENCRYPTED).unwrap_or(false);
                     let password = values.get_string(PASSWORD);
                     secret_key_bytes_from_mnemonic(
+                        &auth_ctx.run_resources,
                         mnemonic,
                         derivation_path,
                         is_encrypted,
@@ -409,10 +409,8 @@ impl SignerImplementation for SvmSecretKey {
                 "confirmed" => CommitmentLevel::Confirmed,
                 _ => CommitmentLevel::Processed,
             };
-            let rpc_client = RpcClient::new_with_commitment(
-                rpc_api_url.clone(),
-                CommitmentConfig { commitment },
-            );
+            let rpc_client =
+                crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig { commitment });
 
             let blockhash = rpc_client.get_latest_blockhash().map_err(|e| {
                 (
@@ -1,6 +1,6 @@
 use std::collections::HashMap;
 
-use solana_client::rpc_client::RpcClient;
+use solana_commitment_config::CommitmentConfig;
 use solana_signature::Signature;
 use solana_transaction::Transaction;
 use txtx_addon_kit::channel;
@@ -200,7 +200,7 @@ impl SignerImplementation for SvmSecretKey {
         let rpc_api_url = values
             .get_expected_string(RPC_API_URL)
             .map_err(|e| (signers.clone(), signer_state.clone(), e))?;
-        let client = RpcClient::new(rpc_api_url.to_string());
+        let client = crate::rpc::blocking_rpc_client(rpc_api_url, CommitmentConfig::default());
 
         let vault_index = values
             .get_u8(VAULT_INDEX)
@@ -508,7 +508,7 @@ impl SignerImplementation for SvmSecretKey {
             .map_err(|e| (signers.clone(), signer_state.clone(), e))?
             .to_string();
 
-        let rpc_client = RpcClient::new(rpc_api_url);
+        let rpc_client = crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::default());
 
         // The squads signer will have multiple passes through `check_signability` and `sign`. The enum variants are
         // ordered in accordance with the pass we're making through this function
@@ -724,7 +724,8 @@ impl SignerImplementation for SvmSecretKey {
                         .get_expected_string(RPC_API_URL)
                         .map_err(|e| (signers.clone(), signer_state.clone(), e))?
                         .to_string();
-                    let rpc_client = RpcClient::new(rpc_api_url);
+                    let rpc_client =
+                        crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::default());
 
                     multisig.get_proposal_status(&rpc_client, construct_did).map_err(|e| {
                         (
@@ -808,7 +809,8 @@ impl SignerImplementation for SvmSecretKey {
                 .map_err(|e| (signers.clone(), signer_state.clone(), e))?
                 .to_string();
 
-            let rpc_client = RpcClient::new(rpc_api_url);
+            let rpc_client =
+                crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::default());
 
             let third_party_signature_status = signer_state
                 .get_scoped_value(&construct_did.to_string(), THIRD_PARTY_SIGNATURE_STATUS)
@@ -1,6 +1,5 @@
 use std::collections::HashMap;
 
-use solana_client::rpc_client::RpcClient;
 use solana_commitment_config::CommitmentConfig;
 use solana_signature::Signature;
 use solana_transaction::Transaction;
@@ -385,7 +384,7 @@ impl SignerImplementation for SvmWebWallet {
                 .to_string();
 
             let rpc_client =
-                RpcClient::new_with_commitment(rpc_api_url.clone(), CommitmentConfig::processed());
+                crate::rpc::blocking_rpc_client(&rpc_api_url, CommitmentConfig::processed());
 
             let blockhash = rpc_client.get_latest_blockhash().map_err(|e| {
                 (
@@ -25,3 +25,8 @@ pub const RE_EXECUTE_COMMAND: &str = "re_execute_command";
 
 pub const THIRD_PARTY_SIGNATURE_STATUS: &str = "third_party_signature_status";
 pub const RUNBOOK_COMPLETE_ADDITIONAL_INFO: &str = "runbook_complete_additional_info";
+
+// Addons
+pub const RPC_API_URL: &str = "rpc_api_url";
+pub const RPC_MAX_IN_FLIGHT_REQUESTS: &str = "rpc_max_in_flight_requests";
+pub const RPC_REQUESTS_PER_SECOND: &str = "rpc_requests_per_second";
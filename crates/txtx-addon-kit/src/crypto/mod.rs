@@ -1,10 +1,94 @@
+use std::collections::HashMap;
+use std::sync::atomic::{compiler_fence, Ordering};
+use std::sync::Mutex;
+
 use hmac::Hmac;
 use libsecp256k1::SecretKey;
 use pbkdf2::pbkdf2;
-use sha2::Sha512;
+use sha2::{Digest, Sha256, Sha512};
 use tiny_hderive::bip32::ExtendedPrivKey;
 
+use crate::types::run_resources::RunResources;
+
+/// BIP39 seeds and secret keys derived during a run, by fingerprint of their inputs. They are
+/// kept in the resources of the run, and zeroized once the run is dropped.
+#[derive(Default)]
+struct DerivedSecrets {
+    secrets: Mutex<HashMap<[u8; 32], SecretBytes>>,
+}
+
+/// Secret bytes, overwritten with zeros when dropped.
+#[derive(Clone)]
+pub struct SecretBytes(Vec<u8>);
+
+impl SecretBytes {
+    pub fn new(bytes: Vec<u8>) -> Self {
+        Self(bytes)
+    }
+}
+
+impl std::ops::Deref for SecretBytes {
+    type Target = [u8];
+    fn deref(&self) -> &[u8] {
+        &self.0
+    }
+}
+
+impl Drop for SecretBytes {
+    fn drop(&mut self) {
+        for byte in self.0.iter_mut() {
+            // volatile writes are not elided, even though the bytes are never read again
+            unsafe { std::ptr::write_volatile(byte, 0) };
+        }
+        compiler_fence(Ordering::SeqCst);
+    }
+}
+
+/// Fingerprint of the inputs of a derivation, so that mnemonics are not kept in memory.
+fn derivation_fingerprint(domain: &str, inputs: &[&str]) -> [u8; 32] {
+    let mut hasher = Sha256::new();
+    hasher.update(domain.as_bytes());
+    for input in inputs.iter() {
+        hasher.update((input.len() as u64).to_be_bytes());
+        hasher.update(input.as_bytes());
+    }
+    hasher.finalize().into()
+}
+
+/// Returns the secret identified by `fingerprint`, derived with `derive` on first use in the
+/// run and cached until the run is dropped.
+fn derived_secret(
+    run_resources: &RunResources,
+    fingerprint: [u8; 32],
+    derive: impl FnOnce() -> Result<SecretBytes, String>,
+) -> Result<SecretBytes, String> {
+    let derived_secrets = run_resources.get_or_init(DerivedSecrets::default);
+    if let Some(secret) = derived_secrets.secrets.lock().unwrap().get(&fingerprint) {
+        return Ok(secret.clone());
+    }
+    let secret = derive()?;
+    derived_secrets.secrets.lock().unwrap().insert(fingerprint, secret.clone());
+    Ok(secret)
+}
+
+/// Returns the secret key derived by `derive` for the mnemonic and derivation path, cached
+/// for the run: signers sharing a mnemonic are activated and re-evaluated without paying
+/// for the key derivation again. `domain` identifies the derivation scheme.
+pub fn cached_secret_key_from_mnemonic(
+    run_resources: &RunResources,
+    domain: &str,
+    mnemonic: &str,
+    derivation_path: &str,
+    password: Option<&str>,
+    derive: impl FnOnce() -> Result<SecretBytes, String>,
+) -> Result<SecretBytes, String> {
+    let fingerprint =
+        derivation_fingerprint(domain, &[mnemonic, password.unwrap_or(""), derivation_path]);
+    derived_secret(run_resources, fingerprint, derive)
+}
+
 pub fn secret_key_bytes_from_mnemonic(
+    run_resources: &RunResources,
     mnemonic: &str,
     derivation_path: &str,
     is_encrypted: bool,
@@ -13,10 +97,27 @@ pub fn secret_key_bytes_from_mnemonic(
     if is_encrypted {
         return Err(format!("encrypted secret keys not yet supported"));
     }
-    let bip39_seed = get_bip39_seed_from_mnemonic(mnemonic, password.unwrap_or(""))?;
-    let ext = ExtendedPrivKey::derive(&bip39_seed[..], derivation_path)
-        .map_err(|e| format!("failed to derive private key: {:?}", e))?;
-    Ok(ext.secret())
+    let password = password.unwrap_or("");
+    let secret_key = cached_secret_key_from_mnemonic(
+        run_resources,
+        "bip32",
+        mnemonic,
+        derivation_path,
+        Some(password),
+        || {
+            // the PBKDF2 seed is shared by all the derivation paths of a mnemonic
+            let bip39_fingerprint = derivation_fingerprint("bip39", &[mnemonic, password]);
+            let bip39_seed = derived_secret(run_resources, bip39_fingerprint, || {
+                get_bip39_seed_from_mnemonic(mnemonic, password).map(SecretBytes)
+            })?;
+            let ext = ExtendedPrivKey::derive(&bip39_seed, derivation_path)
+                .map_err(|e| format!("failed to derive private key: {:?}", e))?;
+            Ok(SecretBytes(ext.secret().to_vec()))
+        },
+    )?;
+    let mut secret_key_bytes = [0u8; 32];
+    secret_key_bytes.copy_from_slice(&secret_key);
+    Ok(secret_key_bytes)
 }
 
 pub fn secret_key_from_bytes(secret_key_bytes: &Vec<u8>) -> Result<SecretKey, String> {
@@ -34,3 +135,42 @@ pub fn get_bip39_seed_from_mnemonic(mnemonic: &str, password: &str) -> Result<Ve
         .map_err(|e| e.to_string())?;
     Ok(seed)
 }
+
+#[cfg(test)]
+mod tests {
+    use super::{derivation_fingerprint, secret_key_bytes_from_mnemonic, DerivedSecrets};
+    use crate::types::run_resources::RunResources;
+
+    const MNEMONIC: &str = "test test test test test test test test test test test junk";
+
+    #[test]
+    fn it_caches_derived_secret_keys_per_mnemonic_and_path() {
+        let run = RunResources::new();
+        let first = secret_key_bytes_from_mnemonic(&run, MNEMONIC, "m/44'/60'/0'/0/0", false, None)
+            .unwrap();
+        let second =
+            secret_key_bytes_from_mnemonic(&run, MNEMONIC, "m/44'/60'/0'/0/1", false, None)
+                .unwrap();
+        assert_ne!(first, second);
+        assert_eq!(
+            first,
+            secret_key_bytes_from_mnemonic(&run, MNEMONIC, "m/44'/60'/0'/0/0", false, None)
+                .unwrap()
+        );
+        // well-known first account of this mnemonic
+        assert_eq!(
+            crate::hex::encode(first),
+            "ac0974bec39a17e36ba4a6b4d238ff944bacb478cbed5efcae784d7bf4f2ff80"
+        );
+
+        let derived_secrets = run.get_or_init(DerivedSecrets::default);
+        let secrets = derived_secrets.secrets.lock().unwrap();
+        assert!(secrets.contains_key(&derivation_fingerprint("bip39", &[MNEMONIC, ""])));
+        assert!(secrets
+            .contains_key(&derivation_fingerprint("bip32", &[MNEMONIC, "", "m/44'/60'/0'/0/1"])));
+
+        // secrets are scoped to the run deriving them
+        let other_run = RunResources::new();
+        assert!(other_run.get_or_init(DerivedSecrets::default).secrets.lock().unwrap().is_empty());
+    }
+}
@@ -0,0 +1,69 @@
+//! Base58 (bitcoin alphabet) encoding specialized for 32 byte values (public keys, hashes).
+//!
+//! Generic base58 encoders divide the whole input by 58 once per output character, one byte
+//! at a time. Here the 256 bit input is held in eight 32 bit limbs and divided by 58^5 per
+//! pass, so an encoding takes 9 passes of 8 word divisions by a constant.
+
+const ALPHABET: &[u8; 58] = b"123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+const RADIX: u64 = 58 * 58 * 58 * 58 * 58;
+/// 58^45 > 2^256, so 9 groups of 5 digits always hold a 32 byte value.
+const DIGIT_GROUPS: usize = 9;
+const MAX_DIGITS: usize = DIGIT_GROUPS * 5;
+
+/// Encodes a 32 byte value in base58, producing the same output as a generic encoder.
+pub fn encode_32(bytes: &[u8; 32]) -> String {
+    let mut limbs = [0u32; 8];
+    for (limb, chunk) in limbs.iter_mut().zip(bytes.chunks_exact(4)) {
+        *limb = u32::from_be_bytes([chunk[0], chunk[1], chunk[2], chunk[3]]);
+    }
+
+    let mut digits = [0u8; MAX_DIGITS];
+    for group in (0..DIGIT_GROUPS).rev() {
+        let mut remainder = 0u64;
+        for limb in limbs.iter_mut() {
+            let accumulator = (remainder << 32) | *limb as u64;
+            *limb = (accumulator / RADIX) as u32;
+            remainder = accumulator % RADIX;
+        }
+        for digit in digits[group * 5..group * 5 + 5].iter_mut().rev() {
+            *digit = (remainder % 58) as u8;
+            remainder /= 58;
+        }
+    }
+
+    // each leading zero byte is encoded as a leading '1', the value itself starts at the
+    // first non-zero digit
+    let leading_zeros = bytes.iter().take_while(|b| **b == 0).count();
+    let first_digit = digits.iter().position(|d| *d != 0).unwrap_or(MAX_DIGITS);
+    let mut encoded = String::with_capacity(leading_zeros + MAX_DIGITS - first_digit);
+    encoded.extend(std::iter::repeat('1').take(leading_zeros));
+    encoded.extend(digits[first_digit..].iter().map(|d| ALPHABET[*d as usize] as char));
+    encoded
+}
+
+#[cfg(test)]
+mod tests {
+    use super::encode_32;
+    use test_case::test_case;
+
+    #[test_case(
+        "aca1e2ae0c54a9a8f12da5dde27a93bb5ff94aeef722b1e474a16318234f83c8",
+        "CctJBuDbaFtojUWfQ3iEcq77eFDjojCtoS4Q59f6bUtF"
+    )]
+    #[test_case(
+        "0000000000000000000000000000000000000000000000000000000000000000",
+        "11111111111111111111111111111111"
+    )]
+    #[test_case(
+        "0000000000000000000000000000000000000000000000000000000000000001",
+        "11111111111111111111111111111112"
+    )]
+    #[test_case(
+        "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+        "JEKNVnkbo3jma5nREBBJCDoXFVeKkD56V3xKrvRmWxFG"
+    )]
+    fn it_encodes_32_bytes(hex_input: &str, expected: &str) {
+        let bytes: [u8; 32] = hex::decode(hex_input).unwrap().try_into().unwrap();
+        assert_eq!(encode_32(&bytes), expected);
+    }
+}
@@ -4,7 +4,7 @@ use std::fmt::{self, Display, Formatter};
 use std::fs;
 use std::fs::File;
 use std::hash::{Hash, Hasher};
-use std::io::Write;
+use std::io::{BufWriter, Write};
 use std::path::Path;
 use std::str::FromStr;
 use std::{collections::HashMap, future::Future, path::PathBuf, pin::Pin};
@@ -174,6 +174,51 @@ impl FileLocation {
         Ok(())
     }
 
+    fn fs_buffered_writer(file_path: &PathBuf) -> Result<BufWriter<File>, String> {
+        let mut parent_directory = file_path.clone();
+        parent_directory.pop();
+        fs::create_dir_all(&parent_directory).map_err(|e| {
+            format!("unable to create parent directory {}\n{}", parent_directory.display(), e)
+        })?;
+        let file = File::create(file_path)
+            .map_err(|e| format!("unable to open file {}\n{}", file_path.display(), e))?;
+        Ok(BufWriter::new(file))
+    }
+
+    fn fs_write_atomically<F>(file_path: &PathBuf, write: F) -> Result<(), String>
+    where
+        F: FnOnce(&mut BufWriter<File>) -> Result<(), String>,
+    {
+        let file_name = file_path
+            .file_name()
+            .ok_or_else(|| format!("unable to write file {}: not a file", file_path.display()))?;
+        let mut temp_path = file_path.clone();
+        temp_path.set_file_name(format!(".{}.tmp", file_name.to_string_lossy()));
+
+        let mut writer = FileLocation::fs_buffered_writer(&temp_path)?;
+        let res = write(&mut writer)
+            .and_then(|_| {
+                writer
+                    .flush()
+                    .map_err(|e| format!("unable to write file {}\n{}", temp_path.display(), e))
+            })
+            .and_then(|_| {
+                writer
+                    .get_ref()
+                    .sync_all()
+                    .map_err(|e| format!("unable to write file {}\n{}", temp_path.display(), e))
+            });
+        drop(writer);
+        if let Err(e) = res {
+            let _ = fs::remove_file(&temp_path);
+            return Err(e);
+        }
+        fs::rename(&temp_path, file_path).map_err(|e| {
+            let _ = fs::remove_file(&temp_path);
+            format!("unable to write file {}\n{}", file_path.display(), e)
+        })
+    }
+
     fn fs_create_dir_all(path: &Path) -> Result<(), String> {
         fs::create_dir_all(path).map_err(|e| {
             format!("unable to create directory {}\n{}", path.display(), e.to_string())
@@ -356,6 +401,27 @@ impl FileLocation {
         }
     }
 
+    /// Opens a buffered writer on the file, creating parent directories as needed, so that
+    /// large content can be streamed to disk rather than assembled in memory first.
+    pub fn get_buffered_writer(&self) -> Result<BufWriter<File>, String> {
+        match self {
+            FileLocation::FileSystem { path } => FileLocation::fs_buffered_writer(path),
+            FileLocation::Url { url: _url } => unimplemented!(),
+        }
+    }
+
+    /// Streams content to a temporary file next to this location, then renames it into place,
+    /// so that a failed or interrupted write leaves any previous file untouched.
+    pub fn write_atomically<F>(&self, write: F) -> Result<(), String>
+    where
+        F: FnOnce(&mut BufWriter<File>) -> Result<(), String>,
+    {
+        match self {
+            FileLocation::FileSystem { path } => FileLocation::fs_write_atomically(path, write),
+            FileLocation::Url { url: _url } => unimplemented!(),
+        }
+    }
+
     pub fn create_dir_all(&self) -> Result<(), String> {
         match self {
             FileLocation::FileSystem { path } => FileLocation::fs_create_dir_all(path),
@@ -496,3 +562,33 @@ pub fn get_path_from_components(comps: Vec<&str>) -> String {
     }
     path.display().to_string()
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn it_leaves_previous_file_untouched_when_atomic_write_fails() {
+        let mut path = std::env::temp_dir();
+        path.push(format!("txtx-fs-test-{}", std::process::id()));
+        path.push("state.json");
+        let location = FileLocation::from_path(path.clone());
+
+        location
+            .write_atomically(|writer| writer.write_all(b"{}").map_err(|e| e.to_string()))
+            .unwrap();
+        assert_eq!(fs::read_to_string(&path).unwrap(), "{}");
+
+        let res = location.write_atomically(|writer| {
+            writer.write_all(b"{\"partial\"").map_err(|e| e.to_string())?;
+            Err("serialization failed".into())
+        });
+        assert!(res.is_err());
+        assert_eq!(fs::read_to_string(&path).unwrap(), "{}");
+        let mut temp_path = path.clone();
+        temp_path.set_file_name(".state.json.tmp");
+        assert!(!temp_path.exists());
+
+        let _ = fs::remove_dir_all(path.parent().unwrap());
+    }
+}
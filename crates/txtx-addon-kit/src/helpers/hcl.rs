@@ -306,7 +306,7 @@ impl RawHclContent {
 
     pub fn to_bytes(&self) -> Result<Vec<u8>, Diagnostic> {
         let mut bytes = vec![0u8; 2 * self.0.len()];
-        crate::hex::encode_to_slice(self.0.clone(), &mut bytes).map_err(|e| {
+        crate::helpers::hex::encode_to_slice(self.0.clone(), &mut bytes).map_err(|e| {
             Diagnostic::error_from_string(format!("failed to encode raw content: {e}"))
         })?;
         Ok(bytes)
@@ -0,0 +1,344 @@
+//! Hex codec used across txtx for buffers, dids, state files and frontend payloads.
+//!
+//! The API mirrors the `hex` crate (and reuses its [FromHexError]) so it can be used as a
+//! drop-in replacement. On x86_64, 16 byte blocks are encoded and decoded with SSE2 (part of
+//! the x86_64 baseline, so no runtime detection is needed); remainders and other targets go
+//! through table driven scalar loops.
+
+use serde::{Serialize, Serializer};
+use std::fmt;
+
+pub use hex::FromHexError;
+
+/// Number of input bytes encoded per chunk when streaming hex into a formatter.
+const STREAM_CHUNK_SIZE: usize = 512;
+
+const HEX_CHARS: &[u8; 16] = b"0123456789abcdef";
+const INVALID_NIBBLE: u8 = 0xff;
+const HEX_DECODE_TABLE: [u8; 256] = build_decode_table();
+
+const fn build_decode_table() -> [u8; 256] {
+    let mut table = [INVALID_NIBBLE; 256];
+    let mut i = 0;
+    while i < 256 {
+        let c = i as u8;
+        table[i] = match c {
+            b'0'..=b'9' => c - b'0',
+            b'a'..=b'f' => c - b'a' + 10,
+            b'A'..=b'F' => c - b'A' + 10,
+            _ => INVALID_NIBBLE,
+        };
+        i += 1;
+    }
+    table
+}
+
+/// Encodes `data` as a lowercase hex string.
+pub fn encode<T: AsRef<[u8]>>(data: T) -> String {
+    encode_with_prefix(data.as_ref(), "")
+}
+
+/// Encodes `data` as a lowercase hex string, prefixed with `0x`.
+pub fn encode_prefixed<T: AsRef<[u8]>>(data: T) -> String {
+    encode_with_prefix(data.as_ref(), "0x")
+}
+
+fn encode_with_prefix(src: &[u8], prefix: &str) -> String {
+    let mut buffer = vec![0u8; prefix.len() + src.len() * 2];
+    buffer[..prefix.len()].copy_from_slice(prefix.as_bytes());
+    encode_into(src, &mut buffer[prefix.len()..]);
+    // SAFETY: the prefix is a valid str and the encoder only writes ascii hex digits
+    unsafe { String::from_utf8_unchecked(buffer) }
+}
+
+/// Encodes `src` as lowercase hex into `dst`, which must be exactly twice as long as `src`.
+pub fn encode_to_slice<T: AsRef<[u8]>>(src: T, dst: &mut [u8]) -> Result<(), FromHexError> {
+    let src = src.as_ref();
+    if dst.len() != src.len() * 2 {
+        return Err(FromHexError::InvalidStringLength);
+    }
+    encode_into(src, dst);
+    Ok(())
+}
+
+fn encode_into(src: &[u8], dst: &mut [u8]) {
+    debug_assert_eq!(dst.len(), src.len() * 2);
+    let encoded = simd::encode_blocks(src, dst);
+    encode_scalar(&src[encoded..], &mut dst[encoded * 2..]);
+}
+
+fn encode_scalar(src: &[u8], dst: &mut [u8]) {
+    for (byte, out) in src.iter().zip(dst.chunks_exact_mut(2)) {
+        out[0] = HEX_CHARS[(byte >> 4) as usize];
+        out[1] = HEX_CHARS[(byte & 0x0f) as usize];
+    }
+}
+
+/// Decodes a hex string (upper or lower case, without prefix) into bytes.
+pub fn decode<T: AsRef<[u8]>>(data: T) -> Result<Vec<u8>, FromHexError> {
+    let src = data.as_ref();
+    if src.len() % 2 != 0 {
+        return Err(FromHexError::OddLength);
+    }
+    let mut bytes = vec![0u8; src.len() / 2];
+    decode_into(src, &mut bytes)?;
+    Ok(bytes)
+}
+
+/// Same as [decode], tolerating an optional `0x` prefix.
+pub fn decode_prefixed<T: AsRef<[u8]>>(data: T) -> Result<Vec<u8>, FromHexError> {
+    let src = data.as_ref();
+    decode(src.strip_prefix(b"0x").unwrap_or(src))
+}
+
+/// Decodes `src` into `dst`, which must be exactly half as long as `src`.
+pub fn decode_to_slice<T: AsRef<[u8]>>(src: T, dst: &mut [u8]) -> Result<(), FromHexError> {
+    let src = src.as_ref();
+    if src.len() % 2 != 0 {
+        return Err(FromHexError::OddLength);
+    }
+    if src.len() != dst.len() * 2 {
+        return Err(FromHexError::InvalidStringLength);
+    }
+    decode_into(src, dst)
+}
+
+fn decode_into(src: &[u8], dst: &mut [u8]) -> Result<(), FromHexError> {
+    debug_assert_eq!(src.len(), dst.len() * 2);
+    // the vectorized pass stops at the first block containing an invalid character,
+    // the scalar pass then reports it with its position
+    let decoded = simd::decode_blocks(src, dst);
+    decode_scalar(&src[decoded * 2..], &mut dst[decoded..], decoded * 2)
+}
+
+fn decode_scalar(src: &[u8], dst: &mut [u8], offset: usize) -> Result<(), FromHexError> {
+    for (i, (pair, out)) in src.chunks_exact(2).zip(dst.iter_mut()).enumerate() {
+        let high = HEX_DECODE_TABLE[pair[0] as usize];
+        if high == INVALID_NIBBLE {
+            return Err(FromHexError::InvalidHexCharacter {
+                c: pair[0] as char,
+                index: offset + 2 * i,
+            });
+        }
+        let low = HEX_DECODE_TABLE[pair[1] as usize];
+        if low == INVALID_NIBBLE {
+            return Err(FromHexError::InvalidHexCharacter {
+                c: pair[1] as char,
+                index: offset + 2 * i + 1,
+            });
+        }
+        *out = (high << 4) | low;
+    }
+    Ok(())
+}
+
+#[cfg(target_arch = "x86_64")]
+mod simd {
+    use std::arch::x86_64::*;
+
+    /// Encodes every complete 16 byte block of `src`, returning the number of bytes consumed.
+    pub fn encode_blocks(src: &[u8], dst: &mut [u8]) -> usize {
+        let blocks = src.len() / 16;
+        // SAFETY: SSE2 is part of the x86_64 baseline. Loads read `blocks * 16` bytes of `src`
+        // and stores write `blocks * 32` bytes of `dst`, which is twice as long as `src`.
+        unsafe {
+            let nibble_mask = _mm_set1_epi8(0x0f);
+            for i in 0..blocks {
+                let input = _mm_loadu_si128(src.as_ptr().add(i * 16) as *const __m128i);
+                let high = nibbles_to_ascii(_mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask));
+                let low = nibbles_to_ascii(_mm_and_si128(input, nibble_mask));
+                let out = dst.as_mut_ptr().add(i * 32);
+                _mm_storeu_si128(out as *mut __m128i, _mm_unpacklo_epi8(high, low));
+                _mm_storeu_si128(out.add(16) as *mut __m128i, _mm_unpackhi_epi8(high, low));
+            }
+        }
+        blocks * 16
+    }
+
+    /// Decodes every complete 32 character block of `src`, stopping early at the first block
+    /// containing an invalid character. Returns the number of bytes written to `dst`.
+    pub fn decode_blocks(src: &[u8], dst: &mut [u8]) -> usize {
+        let blocks = dst.len() / 16;
+        // SAFETY: SSE2 is part of the x86_64 baseline. Loads read `blocks * 32` bytes of `src`,
+        // which is twice as long as `dst`, and stores write `blocks * 16` bytes of `dst`.
+        unsafe {
+            for i in 0..blocks {
+                let input = src.as_ptr().add(i * 32);
+                let (first, first_valid) =
+                    ascii_to_nibbles(_mm_loadu_si128(input as *const __m128i));
+                let (second, second_valid) =
+                    ascii_to_nibbles(_mm_loadu_si128(input.add(16) as *const __m128i));
+                if _mm_movemask_epi8(_mm_and_si128(first_valid, second_valid)) != 0xffff {
+                    return i * 16;
+                }
+                let bytes = _mm_packus_epi16(pack_nibbles(first), pack_nibbles(second));
+                _mm_storeu_si128(dst.as_mut_ptr().add(i * 16) as *mut __m128i, bytes);
+            }
+        }
+        blocks * 16
+    }
+
+    /// Maps each nibble `n` (0..=15) to `'0' + n`, or `'a' + n - 10` above 9.
+    #[inline(always)]
+    unsafe fn nibbles_to_ascii(nibbles: __m128i) -> __m128i {
+        let above_nine = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+        let alpha_offset = _mm_and_si128(above_nine, _mm_set1_epi8((b'a' - b'0' - 10) as i8));
+        _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8(b'0' as i8)), alpha_offset)
+    }
+
+    /// Maps hex characters to their nibble value, along with a mask of the valid lanes.
+    /// Bytes above 0x7f are negative in signed comparisons and therefore never valid.
+    #[inline(always)]
+    unsafe fn ascii_to_nibbles(chars: __m128i) -> (__m128i, __m128i) {
+        let lowercased = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+        let is_digit = _mm_and_si128(
+            _mm_cmpgt_epi8(chars, _mm_set1_epi8(b'0' as i8 - 1)),
+            _mm_cmplt_epi8(chars, _mm_set1_epi8(b'9' as i8 + 1)),
+        );
+        let is_alpha = _mm_and_si128(
+            _mm_cmpgt_epi8(lowercased, _mm_set1_epi8(b'a' as i8 - 1)),
+            _mm_cmplt_epi8(lowercased, _mm_set1_epi8(b'f' as i8 + 1)),
+        );
+        let digits = _mm_and_si128(is_digit, _mm_sub_epi8(chars, _mm_set1_epi8(b'0' as i8)));
+        let alphas =
+            _mm_and_si128(is_alpha, _mm_sub_epi8(lowercased, _mm_set1_epi8((b'a' - 10) as i8)));
+        (_mm_or_si128(digits, alphas), _mm_or_si128(is_digit, is_alpha))
+    }
+
+    /// Combines pairs of nibbles into bytes, one per 16 bit lane.
+    #[inline(always)]
+    unsafe fn pack_nibbles(nibbles: __m128i) -> __m128i {
+        let high = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4);
+        let low = _mm_srli_epi16(nibbles, 8);
+        _mm_or_si128(high, low)
+    }
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+mod simd {
+    pub fn encode_blocks(_src: &[u8], _dst: &mut [u8]) -> usize {
+        0
+    }
+
+    pub fn decode_blocks(_src: &[u8], _dst: &mut [u8]) -> usize {
+        0
+    }
+}
+
+/// Displays a byte slice as a `0x` prefixed hex string.
+///
+/// Encoding happens in fixed-size chunks on the stack, so large buffers (program binaries,
+/// init code, ...) can be written into a serializer's output buffer without first
+/// materializing the full hex `String`.
+pub struct PrefixedHex<'a>(pub &'a [u8]);
+
+impl fmt::Display for PrefixedHex<'_> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let mut buffer = [0u8; STREAM_CHUNK_SIZE * 2];
+        f.write_str("0x")?;
+        for chunk in self.0.chunks(STREAM_CHUNK_SIZE) {
+            let encoded = &mut buffer[..chunk.len() * 2];
+            encode_into(chunk, encoded);
+            // SAFETY: the encoder only writes ascii hex digits
+            f.write_str(unsafe { std::str::from_utf8_unchecked(encoded) })?;
+        }
+        Ok(())
+    }
+}
+
+impl Serialize for PrefixedHex<'_> {
+    fn serialize<S>(&self, serializer: S) -> Result<S::Ok, S::Error>
+    where
+        S: Serializer,
+    {
+        // serde_json forwards `collect_str` straight to its writer
+        serializer.collect_str(self)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use test_case::test_case;
+
+    fn sample(len: usize) -> Vec<u8> {
+        (0..len).map(|i| (i * 7 + 3) as u8).collect()
+    }
+
+    #[test_case(0)]
+    #[test_case(1)]
+    #[test_case(15)]
+    #[test_case(16)]
+    #[test_case(33)]
+    #[test_case(1027)]
+    fn it_matches_reference_codec(len: usize) {
+        let bytes = sample(len);
+        let encoded = encode(&bytes);
+        assert_eq!(encoded, hex::encode(&bytes));
+        assert_eq!(encode_prefixed(&bytes), format!("0x{}", encoded));
+        assert_eq!(decode(&encoded).unwrap(), bytes);
+        assert_eq!(decode(encoded.to_uppercase()).unwrap(), bytes);
+        assert_eq!(decode_prefixed(format!("0x{}", encoded)).unwrap(), bytes);
+    }
+
+    #[test_case(0)]
+    #[test_case(17)]
+    #[test_case(31)]
+    #[test_case(40)]
+    fn it_reports_invalid_characters(position: usize) {
+        for invalid in [b'g', b'G', b'/', b':', b'@', b'`', 0x7f, 0x80, 0xff] {
+            let mut input = encode(sample(32)).into_bytes();
+            input[position] = invalid;
+            assert_eq!(decode(&input), hex::decode(&input));
+        }
+    }
+
+    #[test]
+    fn it_rejects_odd_lengths() {
+        assert_eq!(decode("abc"), Err(FromHexError::OddLength));
+        let mut dst = [0u8; 2];
+        assert_eq!(encode_to_slice([1u8], &mut dst), Err(FromHexError::InvalidStringLength));
+    }
+
+    #[test]
+    fn it_streams_prefixed_hex() {
+        let bytes = sample(2000);
+        assert_eq!(PrefixedHex(&bytes).to_string(), format!("0x{}", hex::encode(&bytes)));
+        assert_eq!(PrefixedHex(&[]).to_string(), "0x");
+        assert_eq!(serde_json::to_string(&PrefixedHex(&[0xde, 0xad])).unwrap(), r#""0xdead""#);
+    }
+
+    /// Micro-benchmark against the `hex` crate:
+    /// `cargo test -p txtx-addon-kit --release -- --ignored bench_hex --nocapture`
+    #[test]
+    #[ignore]
+    fn bench_hex_codec() {
+        use std::hint::black_box;
+        use std::time::Instant;
+
+        let bytes = sample(1 << 20);
+        let encoded = encode(&bytes);
+        let rounds = 50;
+        let timed = |label: &str, f: &dyn Fn()| {
+            let start = Instant::now();
+            for _ in 0..rounds {
+                f();
+            }
+            let elapsed = start.elapsed();
+            let throughput = (rounds * bytes.len()) as f64 / elapsed.as_secs_f64() / 1e6;
+            println!("{label:<20} {:>10.2?} {throughput:>10.1} MB/s", elapsed / rounds as u32);
+        };
+        timed("encode (hex crate)", &|| {
+            black_box(hex::encode(black_box(&bytes)));
+        });
+        timed("encode", &|| {
+            black_box(encode(black_box(&bytes)));
+        });
+        timed("decode (hex crate)", &|| {
+            black_box(hex::decode(black_box(&encoded)).unwrap());
+        });
+        timed("decode", &|| {
+            black_box(decode(black_box(&encoded)).unwrap());
+        });
+    }
+}
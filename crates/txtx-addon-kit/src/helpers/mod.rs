@@ -1,5 +1,8 @@
+pub mod base58;
 pub mod fs;
 pub mod hcl;
+pub mod hex;
+pub mod rpc_limiter;
 
 pub fn format_currency(value: u128, decimals: usize, currency: &str) -> String {
     let divisor = 10u128.pow(decimals as u32);
@@ -0,0 +1,261 @@
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+
+use reqwest::header::RETRY_AFTER;
+use reqwest::StatusCode;
+use tokio::sync::{OwnedSemaphorePermit, Semaphore};
+
+/// Pause applied to an endpoint answering HTTP 429 without a `Retry-After` header
+const DEFAULT_RETRY_AFTER: Duration = Duration::from_secs(1);
+/// Time for the rate of a throttled endpoint to recover its configured value
+const RATE_RECOVERY: Duration = Duration::from_secs(10);
+/// Floor of the rate of a throttled endpoint, in requests per second
+const MIN_REQUESTS_PER_SECOND: f64 = 0.1;
+
+lazy_static! {
+    static ref RPC_ENDPOINTS: Mutex<HashMap<String, Arc<RpcEndpointLimiter>>> =
+        Mutex::new(HashMap::new());
+}
+
+/// Returns the limiter of the RPC endpoint `url`, shared by all the clients of the process
+/// sending requests to this endpoint, whatever the addon or construct creating them.
+pub fn rpc_endpoint_limiter(url: &str) -> Arc<RpcEndpointLimiter> {
+    // parsed urls get a trailing slash
+    let url = url.trim_end_matches('/');
+    RPC_ENDPOINTS
+        .lock()
+        .unwrap()
+        .entry(url.to_string())
+        .or_insert_with(|| Arc::new(RpcEndpointLimiter::new(url)))
+        .clone()
+}
+
+/// Sets the request budget of the RPC endpoint `url`, as configured in an `addon` block.
+pub fn configure_rpc_endpoint(url: &str, limits: RpcEndpointLimits) {
+    rpc_endpoint_limiter(url).set_limits(limits);
+}
+
+/// Returns the usage of the RPC endpoints that received requests, sorted by url.
+pub fn rpc_endpoints_usage() -> Vec<RpcEndpointUsage> {
+    let mut usage = RPC_ENDPOINTS
+        .lock()
+        .unwrap()
+        .values()
+        .map(|limiter| limiter.state.lock().unwrap().usage.clone())
+        .filter(|usage| usage.requests > 0)
+        .collect::<Vec<_>>();
+    usage.sort_by(|a, b| a.url.cmp(&b.url));
+    usage
+}
+
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+pub struct RpcEndpointLimits {
+    /// Maximum number of requests awaiting their response
+    pub max_in_flight_requests: Option<usize>,
+    /// Maximum number of requests sent per second, on average
+    pub requests_per_second: Option<f64>,
+}
+
+#[derive(Clone, Debug, Default)]
+pub struct RpcEndpointUsage {
+    pub url: String,
+    pub requests: u64,
+    /// Responses with the HTTP status 429 (Too Many Requests)
+    pub throttled_responses: u64,
+    /// Time spent by the requests waiting for the budget of the endpoint
+    pub queued: Duration,
+}
+
+#[derive(Debug)]
+struct RpcEndpointState {
+    limits: RpcEndpointLimits,
+    /// Permits of the requests allowed in flight, `None` when unbounded. The semaphore is
+    /// replaced when the limit changes, requests in flight release their permit to the previous
+    /// one.
+    in_flight: Option<Arc<Semaphore>>,
+    /// Token bucket, holding up to one second of requests
+    tokens: f64,
+    refilled_at: Instant,
+    /// Rate right after the last throttled response, and when it was throttled
+    throttled: Option<(f64, Instant)>,
+    paused_until: Option<Instant>,
+    usage: RpcEndpointUsage,
+}
+
+impl RpcEndpointState {
+    /// Returns the rate of the endpoint at `now`: a throttled rate recovers its configured
+    /// value linearly over [RATE_RECOVERY].
+    fn requests_per_second(&self, now: Instant) -> Option<f64> {
+        let rate = self.limits.requests_per_second?;
+        let rate = match self.throttled {
+            Some((throttled_rate, throttled_at)) => {
+                let recovery = now.saturating_duration_since(throttled_at).as_secs_f64()
+                    / RATE_RECOVERY.as_secs_f64();
+                (throttled_rate + (rate - throttled_rate) * recovery).min(rate)
+            }
+            None => rate,
+        };
+        Some(rate.max(MIN_REQUESTS_PER_SECOND))
+    }
+}
+
+/// Request budget of an RPC endpoint: a maximum number of requests in flight, and a token
+/// bucket bounding the requests sent per second. Both are unlimited until configured.
+///
+/// Endpoints answering HTTP 429 are paused for the duration of their `Retry-After` header,
+/// and their rate is halved, before recovering over a few seconds.
+#[derive(Debug)]
+pub struct RpcEndpointLimiter {
+    state: Mutex<RpcEndpointState>,
+}
+
+impl RpcEndpointLimiter {
+    fn new(url: &str) -> Self {
+        Self {
+            state: Mutex::new(RpcEndpointState {
+                limits: RpcEndpointLimits::default(),
+                in_flight: None,
+                tokens: 1.0,
+                refilled_at: Instant::now(),
+                throttled: None,
+                paused_until: None,
+                usage: RpcEndpointUsage { url: url.to_string(), ..Default::default() },
+            }),
+        }
+    }
+
+    pub fn set_limits(&self, limits: RpcEndpointLimits) {
+        let mut state = self.state.lock().unwrap();
+        if state.limits.max_in_flight_requests != limits.max_in_flight_requests {
+            state.in_flight =
+                limits.max_in_flight_requests.map(|max| Arc::new(Semaphore::new(max.max(1))));
+        }
+        state.limits = limits;
+        state.throttled = None;
+    }
+
+    /// Takes a token from the bucket of the endpoint if its rate allows a request at `now`,
+    /// otherwise returns how long to wait before trying again.
+    fn try_acquire_token(&self, now: Instant) -> Result<(), Duration> {
+        let mut state = self.state.lock().unwrap();
+        if let Some(paused_until) = state.paused_until {
+            if now < paused_until {
+                return Err(paused_until - now);
+            }
+            state.paused_until = None;
+        }
+        if let Some(rate) = state.requests_per_second(now) {
+            let elapsed = now.saturating_duration_since(state.refilled_at).as_secs_f64();
+            state.tokens = (state.tokens + elapsed * rate).min(rate.max(1.0));
+            state.refilled_at = now;
+            if state.tokens < 1.0 {
+                return Err(Duration::from_secs_f64((1.0 - state.tokens) / rate));
+            }
+            state.tokens -= 1.0;
+        }
+        Ok(())
+    }
+
+    /// Waits for the budget of the endpoint to allow a request: a request in flight ends before
+    /// the permit is granted if they are bounded, then the token bucket is waited on. The
+    /// request is accounted in flight until the returned permit is dropped.
+    pub async fn acquire(&self) -> RpcPermit {
+        let started_at = Instant::now();
+        let in_flight = self.state.lock().unwrap().in_flight.clone();
+        let in_flight = match in_flight {
+            // the semaphores of the limiters are never closed
+            Some(semaphore) => semaphore.acquire_owned().await.ok(),
+            None => None,
+        };
+        while let Err(wait) = self.try_acquire_token(Instant::now()) {
+            tokio::time::sleep(wait).await;
+        }
+        let mut state = self.state.lock().unwrap();
+        state.usage.requests += 1;
+        state.usage.queued += started_at.elapsed();
+        RpcPermit { _in_flight: in_flight }
+    }
+
+    /// Records a throttled response: requests are paused for `retry_after`, and the rate
+    /// of the endpoint is halved.
+    pub fn throttle(&self, retry_after: Option<Duration>) {
+        let now = Instant::now();
+        let mut state = self.state.lock().unwrap();
+        let paused_until = now + retry_after.unwrap_or(DEFAULT_RETRY_AFTER);
+        state.paused_until = Some(state.paused_until.map_or(paused_until, |p| p.max(paused_until)));
+        if let Some(rate) = state.requests_per_second(now) {
+            state.throttled = Some((rate / 2.0, now));
+            state.tokens = 0.0;
+        }
+        state.usage.throttled_responses += 1;
+    }
+
+    /// Throttles the endpoint if `response` has the HTTP status 429 (Too Many Requests).
+    pub fn record_http_response(&self, response: &reqwest::Response) {
+        if response.status() != StatusCode::TOO_MANY_REQUESTS {
+            return;
+        }
+        let retry_after = response
+            .headers()
+            .get(RETRY_AFTER)
+            .and_then(|value| value.to_str().ok())
+            .and_then(|value| value.trim().parse::<u64>().ok())
+            .map(Duration::from_secs);
+        self.throttle(retry_after);
+    }
+}
+
+/// A request in flight, released when dropped.
+#[derive(Debug)]
+pub struct RpcPermit {
+    _in_flight: Option<OwnedSemaphorePermit>,
+}
+
+#[cfg(test)]
+mod tests {
+    use std::time::{Duration, Instant};
+
+    use futures::FutureExt;
+
+    use super::{RpcEndpointLimiter, RpcEndpointLimits};
+
+    #[test]
+    fn it_bounds_requests_in_flight() {
+        let limiter = RpcEndpointLimiter::new("http://localhost:8545");
+        let permits = (0..8).map(|_| limiter.acquire().now_or_never()).collect::<Vec<_>>();
+        assert!(permits.iter().all(|p| p.is_some()), "endpoints are unlimited by default");
+
+        limiter.set_limits(RpcEndpointLimits {
+            max_in_flight_requests: Some(2),
+            requests_per_second: None,
+        });
+        let first = limiter.acquire().now_or_never().expect("a request is allowed in flight");
+        let _second = limiter.acquire().now_or_never().expect("a request is allowed in flight");
+        assert!(limiter.acquire().now_or_never().is_none(), "requests in flight are bounded");
+        drop(first);
+        assert!(limiter.acquire().now_or_never().is_some(), "released permits are reused");
+        assert_eq!(limiter.state.lock().unwrap().usage.requests, 11);
+    }
+
+    #[test]
+    fn it_bounds_requests_per_second() {
+        let limiter = RpcEndpointLimiter::new("http://localhost:8545");
+        limiter.set_limits(RpcEndpointLimits {
+            max_in_flight_requests: None,
+            requests_per_second: Some(2.0),
+        });
+        let now = Instant::now();
+        assert!(limiter.try_acquire_token(now).is_ok());
+        let wait = limiter.try_acquire_token(now).unwrap_err();
+        assert!(wait <= Duration::from_millis(500), "the bucket refills at 2 requests/s");
+        assert!(limiter.try_acquire_token(now + Duration::from_millis(500)).is_ok());
+
+        limiter.throttle(Some(Duration::from_secs(2)));
+        let later = Instant::now() + Duration::from_millis(1500);
+        assert!(limiter.try_acquire_token(later).is_err(), "throttled endpoints are paused");
+        let state = limiter.state.lock().unwrap();
+        assert_eq!(state.requests_per_second(later).map(|r| r < 2.0), Some(true));
+        assert_eq!(state.usage.throttled_responses, 1);
+    }
+}
@@ -14,7 +14,9 @@ pub use indoc::formatdoc;
 pub use indoc::indoc;
 use types::commands::CommandInputsEvaluationResult;
 use types::commands::CommandInstance;
+use types::cost_estimation::{CostEstimationFuture, CostEstimationRequest, CostEstimationResult};
 use types::diagnostics::Diagnostic;
+use types::signers::SignersState;
 use types::AddonPostProcessingResult;
 use types::ConstructDid;
 pub use uuid;
@@ -124,4 +126,13 @@ pub trait Addon: Debug + Sync + Send {
     ) -> Result<AddonPostProcessingResult, (Diagnostic, ConstructDid)> {
         Ok(AddonPostProcessingResult::new())
     }
+    /// Estimates the costs of the transactions produced by `commands`, and the balances of the
+    /// signers paying them, without signing nor broadcasting anything.
+    fn estimate_transactions_costs(
+        &self,
+        _commands: Vec<CostEstimationRequest>,
+        _signers: SignersState,
+    ) -> CostEstimationFuture {
+        Box::pin(async { CostEstimationResult::new() })
+    }
 }
@@ -4,10 +4,12 @@ use serde::{
     Serialize, Serializer,
 };
 use std::{
+    borrow::Cow,
     collections::HashMap,
     future::{self, Future},
     hash::Hash,
     pin::Pin,
+    sync::Arc,
     thread::sleep,
     time::Duration,
 };
@@ -115,20 +117,38 @@ impl CommandExecutionResult {
     }
 }
 
-#[derive(Clone, Debug)]
-pub struct DependencyExecutionResultCache {
+/// Execution results of the dependencies of a construct, as seen by the evaluation of its inputs.
+///
+/// The cache is layered: a construct evaluation layers a small overlay, holding references to
+/// the results of its dependencies, on top of a base shared by all the evaluations of a pass.
+/// Results are only copied when two results need to be merged under the same construct.
+#[derive(Clone, Debug, Default)]
+pub struct DependencyExecutionResultCache<'a> {
+    base: Option<&'a DependencyExecutionResultCache<'a>>,
+    borrowed: HashMap<ConstructDid, &'a CommandExecutionResult>,
     cache: HashMap<ConstructDid, Result<CommandExecutionResult, Diagnostic>>,
 }
-impl DependencyExecutionResultCache {
+impl<'a> DependencyExecutionResultCache<'a> {
     pub fn new() -> Self {
-        Self { cache: HashMap::new() }
+        Self::default()
+    }
+
+    /// Creates an empty overlay on top of `base`.
+    pub fn layered_on(base: &'a DependencyExecutionResultCache<'a>) -> Self {
+        Self { base: Some(base), ..Self::default() }
     }
 
     pub fn get(
         &self,
         construct_did: &ConstructDid,
-    ) -> Option<&Result<CommandExecutionResult, Diagnostic>> {
-        self.cache.get(construct_did)
+    ) -> Option<Result<&CommandExecutionResult, &Diagnostic>> {
+        if let Some(result) = self.cache.get(construct_did) {
+            return Some(result.as_ref());
+        }
+        if let Some(result) = self.borrowed.get(construct_did) {
+            return Some(Ok(*result));
+        }
+        self.base.and_then(|base| base.get(construct_did))
     }
 
     pub fn insert(
@@ -136,6 +156,7 @@ impl DependencyExecutionResultCache {
         construct_did: ConstructDid,
         result: Result<CommandExecutionResult, Diagnostic>,
     ) {
+        self.borrowed.remove(&construct_did);
         self.cache.insert(construct_did, result);
     }
 
@@ -147,16 +168,42 @@ impl DependencyExecutionResultCache {
         construct_did: &ConstructDid,
         other_result: &CommandExecutionResult,
     ) -> Result<(), Diagnostic> {
-        match self.cache.get_mut(&construct_did) {
+        match self.cache.get_mut(construct_did) {
             Some(Ok(result)) => {
-                result.apply(&other_result);
+                result.apply(other_result);
+                return Ok(());
             }
             Some(Err(e)) => return Err(e.clone()),
+            None => {}
+        }
+        let result = match self.get(construct_did) {
+            Some(Ok(result)) => {
+                let mut result = result.clone();
+                result.apply(other_result);
+                result
+            }
+            Some(Err(e)) => return Err(e.clone()),
+            None => other_result.clone(),
+        };
+        self.insert(construct_did.clone(), Ok(result));
+        Ok(())
+    }
+
+    /// Same as [DependencyExecutionResultCache::merge], without copying `other_result` unless
+    /// a result is already cached for `construct_did`.
+    pub fn merge_borrowed(
+        &mut self,
+        construct_did: &ConstructDid,
+        other_result: &'a CommandExecutionResult,
+    ) -> Result<(), Diagnostic> {
+        match self.get(construct_did) {
             None => {
-                self.cache.insert(construct_did.clone(), Ok(other_result.clone()));
+                self.borrowed.insert(construct_did.clone(), other_result);
+                Ok(())
             }
+            Some(Ok(result)) if std::ptr::eq(result, other_result) => Ok(()),
+            Some(_) => self.merge(construct_did, other_result),
         }
-        Ok(())
     }
 }
 
@@ -233,6 +280,16 @@ impl CommandInputsEvaluationResult {
         }
     }
 
+    /// Names the inputs store after the construct it was evaluated for, so that
+    /// `CommandInstance` can hand it to the specification callbacks without copying it.
+    pub fn scoped_to(mut self, name: &str, construct_did: &ConstructDid) -> Self {
+        if self.inputs.name != name {
+            self.inputs.name = name.to_string();
+        }
+        self.inputs.uuid = construct_did.value();
+        self
+    }
+
     pub fn insert(&mut self, key: &str, value: Value) {
         self.inputs.insert(key, value);
     }
@@ -559,6 +616,7 @@ pub type CommandBackgroundTaskExecutionClosure = Box<
         &Uuid,
         &RunbookSupervisionContext,
         &Option<CloudServiceContext>,
+        &AuthorizationContext,
     ) -> CommandExecutionFutureResult,
 >;
 
@@ -679,11 +737,14 @@ impl CommandInstanceType {
     }
 }
 
+/// Instances are cloned with the execution contexts (backups, simulations, embedded
+/// runbooks): the specification and the block are shared, and the specification is only
+/// copied when an input review is recorded on it.
 #[derive(Debug, Clone)]
 pub struct CommandInstance {
-    pub specification: CommandSpecification,
+    pub specification: Arc<CommandSpecification>,
     pub name: String,
-    pub block: Block,
+    pub block: Arc<Block>,
     pub package_id: PackageId,
     pub namespace: String,
     pub typing: CommandInstanceType,
@@ -699,7 +760,7 @@ impl Serialize for CommandInstance {
         S: Serializer,
     {
         let mut ser = serializer.serialize_struct("CommandInstance", 6)?;
-        ser.serialize_field("specification", &self.specification)?;
+        ser.serialize_field("specification", self.specification.as_ref())?;
         ser.serialize_field("name", &self.name)?;
         ser.serialize_field("packageUuid", &self.package_id.did())?;
         ser.serialize_field("namespace", &self.namespace)?;
@@ -825,6 +886,31 @@ impl CommandInstance {
         group.value.to_string()
     }
 
+    /// Returns the values handed to the specification callbacks. Inputs that were evaluated
+    /// for this construct (see `CommandInputsEvaluationResult::scoped_to`) are borrowed as is;
+    /// a new store is only built when the scope differs or the nested execution adds inputs.
+    fn scoped_values<'a>(
+        &self,
+        construct_did: &ConstructDid,
+        evaluated_inputs: &'a CommandInputsEvaluationResult,
+        nested_evaluation_values: Option<&ValueStore>,
+    ) -> Cow<'a, ValueStore> {
+        let inputs = &evaluated_inputs.inputs;
+        let adds_nested_inputs = nested_evaluation_values.map_or(false, |nested| {
+            nested.inputs.store.keys().any(|key| !inputs.inputs.store.contains_key(key))
+        });
+        if !adds_nested_inputs && inputs.name == self.name && inputs.uuid == construct_did.0 {
+            return Cow::Borrowed(inputs);
+        }
+        let values = ValueStore::new(&self.name, &construct_did.value())
+            .with_defaults(&inputs.defaults)
+            .with_inputs(&inputs.inputs);
+        match nested_evaluation_values {
+            Some(nested) => Cow::Owned(values.append_inputs(&nested.inputs)),
+            None => Cow::Owned(values),
+        }
+    }
+
     pub fn evaluate_pre_conditions(
         &self,
         construct_did: &ConstructDid,
@@ -832,9 +918,7 @@ impl CommandInstance {
         progress_tx: &channel::Sender<BlockEvent>,
         background_tasks_uuid: &Uuid,
     ) -> Result<PreConditionEvaluationResult, Diagnostic> {
-        let values = ValueStore::new(&self.name, &construct_did.value())
-            .with_defaults(&evaluated_inputs.inputs.defaults)
-            .with_inputs(&evaluated_inputs.inputs.inputs);
+        let values = self.scoped_values(construct_did, evaluated_inputs, None);
         let spec = &self.specification;
         (spec.evaluate_pre_conditions)(
             &construct_did,
@@ -873,7 +957,7 @@ impl CommandInstance {
                             value_checked,
                             ..
                         }) => {
-                            for input in self.specification.inputs.iter_mut() {
+                            for input in Arc::make_mut(&mut self.specification).inputs.iter_mut() {
                                 if &input.name == input_name {
                                     input.check_performed = value_checked.clone();
                                     break;
@@ -898,7 +982,7 @@ impl CommandInstance {
                                     .set_status(ActionItemStatus::Success(None));
                             consolidated_actions.push_action_item_update(action_item_update);
 
-                            for input in self.specification.inputs.iter_mut() {
+                            for input in Arc::make_mut(&mut self.specification).inputs.iter_mut() {
                                 if &input.name == input_name {
                                     input.check_performed = true;
                                     break;
@@ -953,10 +1037,8 @@ impl CommandInstance {
         progress_tx: &channel::Sender<BlockEvent>,
         auth_ctx: &AuthorizationContext,
     ) -> Result<CommandExecutionResult, Diagnostic> {
-        let values = ValueStore::new(&self.name, &construct_did.value())
-            .with_defaults(&evaluated_inputs.inputs.defaults)
-            .with_inputs(&evaluated_inputs.inputs.inputs)
-            .append_inputs(&nested_evaluation_values.inputs);
+        let values =
+            self.scoped_values(construct_did, evaluated_inputs, Some(nested_evaluation_values));
 
         let spec = &self.specification;
         let res = (spec.run_execution)(
@@ -1014,9 +1096,7 @@ impl CommandInstance {
         signers: SignersState,
         signer_instances: &HashMap<ConstructDid, SignerInstance>,
     ) -> Result<(SignersState, Vec<(ConstructDid, ValueStore)>), (SignersState, Diagnostic)> {
-        let values = ValueStore::new(&self.name, &construct_did.value())
-            .with_defaults(&evaluated_inputs.inputs.defaults)
-            .with_inputs(&evaluated_inputs.inputs.inputs);
+        let values = self.scoped_values(construct_did, evaluated_inputs, None);
 
         let spec = &self.specification;
         let future = (spec.prepare_signed_nested_execution)(
@@ -1034,9 +1114,7 @@ impl CommandInstance {
         construct_did: &ConstructDid,
         evaluated_inputs: &CommandInputsEvaluationResult,
     ) -> Result<Vec<(ConstructDid, ValueStore)>, Diagnostic> {
-        let values = ValueStore::new(&self.name, &construct_did.value())
-            .with_defaults(&evaluated_inputs.inputs.defaults)
-            .with_inputs(&evaluated_inputs.inputs.inputs);
+        let values = self.scoped_values(construct_did, evaluated_inputs, None);
 
         let spec = &self.specification;
 
@@ -1055,10 +1133,8 @@ impl CommandInstance {
         supervision_context: &RunbookSupervisionContext,
         auth_ctx: &AuthorizationContext,
     ) -> Result<(SignersState, Actions), (SignersState, Diagnostic)> {
-        let values = ValueStore::new(&self.name, &construct_did.value())
-            .with_defaults(&evaluated_inputs.inputs.defaults)
-            .with_inputs(&evaluated_inputs.inputs.inputs)
-            .append_inputs(&nested_evaluation_values.inputs);
+        let values =
+            self.scoped_values(construct_did, evaluated_inputs, Some(nested_evaluation_values));
 
         // TODO
         let mut consolidated_actions = Actions::none();
@@ -1068,7 +1144,7 @@ impl CommandInstance {
                     match payload {
                         ActionItemResponseType::ReviewInput(update) => {
                             // This is a shortcut and should be mutated somewhere else
-                            for input in self.specification.inputs.iter_mut() {
+                            for input in Arc::make_mut(&mut self.specification).inputs.iter_mut() {
                                 if input.name == update.input_name {
                                     input.check_performed = true;
                                     break;
@@ -1143,10 +1219,8 @@ impl CommandInstance {
         progress_tx: &channel::Sender<BlockEvent>,
         auth_context: &AuthorizationContext,
     ) -> Result<(SignersState, CommandExecutionResult), (SignersState, Diagnostic)> {
-        let values = ValueStore::new(&self.name, &construct_did.value())
-            .with_defaults(&evaluated_inputs.inputs.defaults)
-            .with_inputs(&evaluated_inputs.inputs.inputs)
-            .append_inputs(&nested_evaluation_values.inputs);
+        let values =
+            self.scoped_values(construct_did, evaluated_inputs, Some(nested_evaluation_values));
 
         let spec = &self.specification;
         let future = (spec.run_signed_execution)(
@@ -1211,6 +1285,7 @@ impl CommandInstance {
         background_tasks_uuid: &Uuid,
         supervision_context: &RunbookSupervisionContext,
         cloud_svc_context: &CloudServiceContext,
+        auth_context: &AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         let values = ValueStore::new(&self.name, &construct_did.value())
             .with_defaults(&evaluated_inputs.inputs.defaults)
@@ -1230,6 +1305,7 @@ impl CommandInstance {
             background_tasks_uuid,
             supervision_context,
             &if spec.implements_cloud_service { Some(cloud_svc_context.clone()) } else { None },
+            auth_context,
         );
         res
     }
@@ -1267,9 +1343,7 @@ impl CommandInstance {
         progress_tx: &channel::Sender<BlockEvent>,
         background_tasks_uuid: &Uuid,
     ) -> Result<PostConditionEvaluationResult, Diagnostic> {
-        let values = ValueStore::new(&self.name, &construct_did.value())
-            .with_defaults(&evaluated_inputs.inputs.defaults)
-            .with_inputs(&evaluated_inputs.inputs.inputs);
+        let values = self.scoped_values(construct_did, evaluated_inputs, None);
 
         let spec = &self.specification;
         let res = (spec.evaluate_post_conditions)(
@@ -1479,6 +1553,7 @@ pub trait CommandImplementation {
         _background_tasks_uuid: &Uuid,
         _supervision_context: &RunbookSupervisionContext,
         _cloud_service_context: &Option<CloudServiceContext>,
+        _auth_context: &AuthorizationContext,
     ) -> CommandExecutionFutureResult {
         unimplemented!()
     }
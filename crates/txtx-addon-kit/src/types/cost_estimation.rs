@@ -0,0 +1,210 @@
+use std::collections::BTreeMap;
+use std::future::Future;
+use std::pin::Pin;
+
+use super::stores::ValueStore;
+use super::ConstructDid;
+
+pub type CostEstimationFuture = Pin<Box<dyn Future<Output = CostEstimationResult> + Send>>;
+
+/// Transaction-producing command, with the inputs evaluated by a simulation of the runbook.
+#[derive(Clone, Debug)]
+pub struct CostEstimationRequest {
+    pub construct_did: ConstructDid,
+    pub construct_name: String,
+    /// Matcher of the command specification, e.g. `send_eth`
+    pub matcher: String,
+    pub inputs: ValueStore,
+}
+
+/// Cost of a transaction, estimated without signing nor broadcasting it. Amounts are expressed
+/// in the smallest denomination of the network currency (wei, µSTX, lamports, ...).
+#[derive(Clone, Debug)]
+pub struct TransactionCostEstimate {
+    pub construct_did: ConstructDid,
+    pub construct_name: String,
+    /// Network the transaction is sent to, identified by its RPC endpoint
+    pub network: String,
+    pub denomination: String,
+    /// Signer paying the fees, and its address when it was activated without user interaction
+    pub payer: Option<(ConstructDid, Option<String>)>,
+    pub fee: Result<u128, String>,
+    /// Amount transferred by the transaction, on top of its fee
+    pub amount: u128,
+}
+
+#[derive(Clone, Debug)]
+pub struct SignerBalance {
+    pub signer_did: ConstructDid,
+    pub network: String,
+    pub denomination: String,
+    pub address: String,
+    pub balance: Result<u128, String>,
+}
+
+#[derive(Clone, Debug, Default)]
+pub struct CostEstimationResult {
+    pub transactions: Vec<TransactionCostEstimate>,
+    pub balances: Vec<SignerBalance>,
+}
+
+impl CostEstimationResult {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn append(&mut self, other: &mut CostEstimationResult) {
+        self.transactions.append(&mut other.transactions);
+        self.balances.append(&mut other.balances);
+    }
+
+    /// Totals of the transactions, by network and denomination.
+    pub fn totals_per_chain(&self) -> BTreeMap<(String, String), ChainCostTotal> {
+        let mut chains: BTreeMap<(String, String), ChainCostTotal> = BTreeMap::new();
+        for tx in self.transactions.iter() {
+            let chain = chains.entry((tx.network.clone(), tx.denomination.clone())).or_default();
+            match &tx.fee {
+                Ok(fee) => {
+                    chain.fees += fee;
+                    chain.amounts += tx.amount;
+                }
+                Err(_) => chain.unestimated_transactions += 1,
+            }
+        }
+        chains
+    }
+
+    /// Totals of the estimated transactions, fees and amounts transferred, by network,
+    /// denomination and payer, along with the balance of the payer when it was fetched.
+    pub fn totals_per_payer(&self) -> BTreeMap<(String, String, CostPayer), PayerCostTotal> {
+        let mut payers: BTreeMap<(String, String, CostPayer), PayerCostTotal> = BTreeMap::new();
+        for tx in self.transactions.iter() {
+            let (Ok(fee), Some((signer_did, address))) = (&tx.fee, &tx.payer) else {
+                continue;
+            };
+            let payer = match address {
+                Some(address) => CostPayer::Address(address.clone()),
+                None => CostPayer::Signer(signer_did.clone()),
+            };
+            payers
+                .entry((tx.network.clone(), tx.denomination.clone(), payer))
+                .or_insert_with_key(|(network, _, payer)| {
+                    let balance = match payer {
+                        CostPayer::Address(address) => self
+                            .balances
+                            .iter()
+                            .find(|b| &b.network == network && &b.address == address)
+                            .map(|b| b.balance.clone()),
+                        CostPayer::Signer(_) => None,
+                    };
+                    PayerCostTotal { total: 0, balance }
+                })
+                .total += fee + tx.amount;
+        }
+        payers
+    }
+}
+
+#[derive(Clone, Debug, Default, PartialEq)]
+pub struct ChainCostTotal {
+    pub fees: u128,
+    pub amounts: u128,
+    /// Transactions whose fee could not be estimated
+    pub unestimated_transactions: usize,
+}
+
+/// Payer of transactions: its address, or its signer when it requires user interaction.
+#[derive(Clone, Debug, PartialEq, Eq, PartialOrd, Ord)]
+pub enum CostPayer {
+    Address(String),
+    Signer(ConstructDid),
+}
+
+#[derive(Clone, Debug, PartialEq)]
+pub struct PayerCostTotal {
+    pub total: u128,
+    /// Balance of the payer, when its address is known
+    pub balance: Option<Result<u128, String>>,
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{
+        ChainCostTotal, CostEstimationResult, CostPayer, PayerCostTotal, SignerBalance,
+        TransactionCostEstimate,
+    };
+    use crate::types::{ConstructDid, Did};
+
+    fn did(name: &str) -> ConstructDid {
+        ConstructDid(Did::from_components(vec![name.as_bytes()]))
+    }
+
+    fn tx(
+        network: &str,
+        payer: Option<(ConstructDid, Option<String>)>,
+        fee: Result<u128, String>,
+        amount: u128,
+    ) -> TransactionCostEstimate {
+        TransactionCostEstimate {
+            construct_did: did("tx"),
+            construct_name: "tx".into(),
+            network: network.into(),
+            denomination: "wei".into(),
+            payer,
+            fee,
+            amount,
+        }
+    }
+
+    #[test]
+    fn it_aggregates_costs_per_chain_and_payer() {
+        let alice = Some((did("alice"), Some("0xa".to_string())));
+        let bob = Some((did("bob"), None));
+        let result = CostEstimationResult {
+            transactions: vec![
+                tx("mainnet", alice.clone(), Ok(10), 100),
+                tx("mainnet", alice.clone(), Ok(20), 0),
+                tx("mainnet", bob, Ok(5), 0),
+                tx("mainnet", alice.clone(), Err("unavailable".into()), 0),
+                tx("testnet", alice.clone(), Ok(1), 0),
+                tx("testnet", None, Ok(2), 0),
+            ],
+            balances: vec![SignerBalance {
+                signer_did: did("alice"),
+                network: "mainnet".into(),
+                denomination: "wei".into(),
+                address: "0xa".into(),
+                balance: Ok(50),
+            }],
+        };
+
+        let chains = result.totals_per_chain();
+        assert_eq!(
+            chains.get(&("mainnet".into(), "wei".into())),
+            Some(&ChainCostTotal { fees: 35, amounts: 100, unestimated_transactions: 1 })
+        );
+        assert_eq!(
+            chains.get(&("testnet".into(), "wei".into())),
+            Some(&ChainCostTotal { fees: 3, amounts: 0, unestimated_transactions: 0 })
+        );
+
+        let payers = result.totals_per_payer();
+        assert_eq!(payers.len(), 3);
+        let total = |network: &str, payer: CostPayer| {
+            payers.get(&(network.to_string(), "wei".to_string(), payer)).cloned()
+        };
+        assert_eq!(
+            total("mainnet", CostPayer::Address("0xa".into())),
+            Some(PayerCostTotal { total: 130, balance: Some(Ok(50)) })
+        );
+        assert_eq!(
+            total("mainnet", CostPayer::Signer(did("bob"))),
+            Some(PayerCostTotal { total: 5, balance: None })
+        );
+        // balances are matched by network
+        assert_eq!(
+            total("testnet", CostPayer::Address("0xa".into())),
+            Some(PayerCostTotal { total: 1, balance: None })
+        );
+    }
+}
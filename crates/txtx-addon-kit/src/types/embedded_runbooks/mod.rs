@@ -1,4 +1,5 @@
 use std::collections::{HashMap, HashSet};
+use std::sync::Arc;
 
 use hcl_edit::{expr::Expression, structure::Block};
 
@@ -160,8 +161,9 @@ pub struct EmbeddedRunbookInstanceSpecification {
     pub runbook_id: RunbookId,
     pub description: Option<String>,
     pub inputs: Vec<EmbeddedRunbookInputSpecification>,
-    pub static_execution_context: EmbeddedRunbookStaticExecutionContext,
-    pub static_workspace_context: EmbeddedRunbookStaticWorkspaceContext,
+    /// Shared by all the instances of the embedded runbook, which only own their inputs and results
+    pub static_execution_context: Arc<EmbeddedRunbookStaticExecutionContext>,
+    pub static_workspace_context: Arc<EmbeddedRunbookStaticWorkspaceContext>,
 }
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -257,7 +259,7 @@ pub struct EmbeddedRunbookStaticExecutionContext {
     /// Map of embedded runbooks
     pub embedded_runbooks: HashMap<ConstructDid, EmbeddedRunbookInstance>,
     /// Map of executable commands (input, output, action)
-    pub commands_instances: HashMap<ConstructDid, CommandInstance>,
+    pub commands_instances: Arc<HashMap<ConstructDid, CommandInstance>>,
     /// Constructs depending on a given Construct.
     pub commands_dependencies: HashMap<ConstructDid, Vec<ConstructDid>>,
     /// Constructs depending on a given Construct performing signing.
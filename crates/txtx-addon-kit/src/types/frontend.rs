@@ -1,4 +1,13 @@
-use std::{borrow::BorrowMut, collections::BTreeMap, fmt::Display};
+use std::{
+    borrow::BorrowMut,
+    collections::BTreeMap,
+    fmt::Display,
+    sync::{
+        atomic::{AtomicU8, Ordering},
+        Arc, Mutex, Weak,
+    },
+    time::{Duration, Instant},
+};
 
 use crate::{
     constants::ACTION_ITEM_BEGIN_FLOW,
@@ -133,6 +142,15 @@ pub struct StaticLogEvent {
     pub namespace: String,
 }
 
+impl StaticLogEvent {
+    fn is_identical(&self, other: &StaticLogEvent) -> bool {
+        self.level == other.level
+            && self.uuid == other.uuid
+            && self.details.summary == other.details.summary
+            && self.details.message == other.details.message
+    }
+}
+
 #[derive(Debug, Clone, Serialize, Deserialize)]
 #[serde(rename_all = "camelCase")]
 pub struct LogDetails {
@@ -234,24 +252,201 @@ impl TransientLogEvent {
     }
 }
 
+/// Minimum level of the static log events dispatched by addons, see [LogDispatcher::set_level_filter]
+static LOG_LEVEL_FILTER: AtomicU8 = AtomicU8::new(LogLevel::Trace as u8);
+
+/// Pending events, and identical static events, emitted by a dispatcher within a tick are
+/// coalesced into a single event.
+const LOG_COALESCING_TICK: Duration = Duration::from_millis(100);
+
+/// Dispatches the log events of a construct.
+///
+/// Addons report progress at a high frequency (one pending event per chunk written, per
+/// confirmation polled, ...). Static events below the level filter are dropped at the source,
+/// pending events are coalesced within a tick (latest wins, as they replace one another), and
+/// identical static events are counted and emitted once with their number of repetitions.
+/// Events held back are sent once their tick elapsed, even when no other event follows.
 pub struct LogDispatcher {
     uuid: Uuid,
     namespace: String,
+    shared: Arc<SharedLogDispatcher>,
+}
+
+/// Part of the dispatcher reachable from the thread sending the events held back.
+struct SharedLogDispatcher {
     tx: channel::Sender<BlockEvent>,
+    state: Mutex<LogDispatcherState>,
+}
+
+#[derive(Default)]
+struct LogDispatcherState {
+    /// When the last pending event was sent
+    last_pending_sent_at: Option<Instant>,
+    /// Latest pending event received within the tick, sent with the next event
+    deferred_pending: Option<TransientLogEvent>,
+    /// Last static event sent, when, and the number of identical events received since
+    last_static: Option<(StaticLogEvent, Instant, usize)>,
+    /// Whether the events held back are scheduled to be sent at the end of their tick
+    flush_scheduled: bool,
+}
+
+#[cfg(not(feature = "wasm"))]
+lazy_static! {
+    /// Dispatchers holding events back, with the end of their tick. A single background thread
+    /// sends these events when the tick elapses, so that a long wait after a burst of progress
+    /// does not leave a stale event displayed.
+    static ref DEFERRED_LOG_EVENTS: channel::Sender<(Instant, Weak<SharedLogDispatcher>)> = {
+        let (tx, rx) = channel::unbounded();
+        let _ = std::thread::Builder::new()
+            .name("log-dispatcher".into())
+            .spawn(move || send_deferred_log_events(rx));
+        tx
+    };
+}
+
+#[cfg(not(feature = "wasm"))]
+fn send_deferred_log_events(rx: channel::Receiver<(Instant, Weak<SharedLogDispatcher>)>) {
+    let mut scheduled: Vec<(Instant, Weak<SharedLogDispatcher>)> = vec![];
+    loop {
+        let next_deadline = scheduled.iter().map(|(deadline, _)| *deadline).min();
+        let received = match next_deadline {
+            Some(deadline) => rx.recv_deadline(deadline).map_err(|e| e.is_disconnected()),
+            None => rx.recv().map_err(|_| true),
+        };
+        match received {
+            Ok(entry) => scheduled.push(entry),
+            Err(true) => return,
+            Err(false) => {}
+        }
+        let now = Instant::now();
+        scheduled.retain(|(deadline, dispatcher)| {
+            if *deadline > now {
+                return true;
+            }
+            if let Some(dispatcher) = dispatcher.upgrade() {
+                if let Ok(mut state) = dispatcher.state.lock() {
+                    state.flush_scheduled = false;
+                    dispatcher.flush(&mut state);
+                }
+            }
+            false
+        });
+    }
+}
+
+impl SharedLogDispatcher {
+    fn send(&self, event: LogEvent) {
+        let _ = self.tx.try_send(BlockEvent::LogEvent(event));
+    }
+
+    /// Sends the events held back by the coalescing.
+    fn flush(&self, state: &mut LogDispatcherState) {
+        if let Some((event, _, repetitions)) = state.last_static.as_mut() {
+            if *repetitions > 0 {
+                let mut aggregated = event.clone();
+                aggregated.details.message =
+                    format!("{} (repeated {} times)", aggregated.details.message, repetitions);
+                *repetitions = 0;
+                self.send(LogEvent::Static(aggregated));
+            }
+        }
+        if let Some(event) = state.deferred_pending.take() {
+            state.last_pending_sent_at = Some(Instant::now());
+            self.send(LogEvent::Transient(event));
+        }
+    }
+
+    /// Schedules the events held back to be sent once the tick started at `tick_start` elapsed.
+    fn schedule_flush(self: &Arc<Self>, state: &mut LogDispatcherState, tick_start: Instant) {
+        if state.flush_scheduled {
+            return;
+        }
+        #[cfg(not(feature = "wasm"))]
+        {
+            state.flush_scheduled = DEFERRED_LOG_EVENTS
+                .send((tick_start + LOG_COALESCING_TICK, Arc::downgrade(self)))
+                .is_ok();
+        }
+        #[cfg(feature = "wasm")]
+        let _ = tick_start;
+    }
 }
+
 impl LogDispatcher {
     pub fn new(uuid: Uuid, namespace: &str, tx: &channel::Sender<BlockEvent>) -> Self {
-        LogDispatcher { uuid, namespace: format!("txtx::{}", namespace), tx: tx.clone() }
+        LogDispatcher {
+            uuid,
+            namespace: format!("txtx::{}", namespace),
+            shared: Arc::new(SharedLogDispatcher {
+                tx: tx.clone(),
+                state: Mutex::new(LogDispatcherState::default()),
+            }),
+        }
+    }
+
+    /// Sets the minimum level of the static log events dispatched, for the whole process.
+    pub fn set_level_filter(level: &LogLevel) {
+        LOG_LEVEL_FILTER.store(level.clone() as u8, Ordering::Relaxed);
+    }
+
+    fn level_filter() -> LogLevel {
+        match LOG_LEVEL_FILTER.load(Ordering::Relaxed) {
+            0 => LogLevel::Trace,
+            1 => LogLevel::Debug,
+            2 => LogLevel::Info,
+            3 => LogLevel::Warn,
+            _ => LogLevel::Error,
+        }
     }
 
     fn log_static(&self, level: LogLevel, summary: impl ToString, message: impl ToString) {
-        let _ = self.tx.try_send(BlockEvent::static_log(
+        if !Self::level_filter().should_log(&level) {
+            return;
+        }
+        let event = StaticLogEvent {
             level,
-            self.uuid,
-            self.namespace.clone(),
-            summary,
-            message,
-        ));
+            uuid: self.uuid,
+            details: LogDetails { message: message.to_string(), summary: summary.to_string() },
+            namespace: self.namespace.clone(),
+        };
+        let mut state = self.shared.state.lock().unwrap();
+        if let Some((last, sent_at, repetitions)) = state.last_static.as_mut() {
+            if sent_at.elapsed() < LOG_COALESCING_TICK && last.is_identical(&event) {
+                *repetitions += 1;
+                let tick_start = *sent_at;
+                self.shared.schedule_flush(&mut state, tick_start);
+                return;
+            }
+        }
+        self.shared.flush(&mut state);
+        state.last_static = Some((event.clone(), Instant::now(), 0));
+        self.shared.send(LogEvent::Static(event));
+    }
+
+    fn log_transient(&self, event: TransientLogEvent) {
+        let mut state = self.shared.state.lock().unwrap();
+        match event.status {
+            TransientLogEventStatus::Pending(_) => {
+                let tick_start = state
+                    .last_pending_sent_at
+                    .filter(|sent_at| sent_at.elapsed() < LOG_COALESCING_TICK);
+                if let Some(tick_start) = tick_start {
+                    state.deferred_pending = Some(event);
+                    self.shared.schedule_flush(&mut state, tick_start);
+                    return;
+                }
+                state.deferred_pending = None;
+                self.shared.flush(&mut state);
+                state.last_pending_sent_at = Some(Instant::now());
+            }
+            TransientLogEventStatus::Success(_) | TransientLogEventStatus::Failure(_) => {
+                // the pending event held back is superseded
+                state.deferred_pending = None;
+                self.shared.flush(&mut state);
+                state.last_pending_sent_at = None;
+            }
+        }
+        self.shared.send(LogEvent::Transient(event));
     }
 
     pub fn trace(&self, summary: impl ToString, message: impl ToString) {
@@ -275,21 +470,30 @@ impl LogDispatcher {
     }
 
     pub fn pending_info(&self, summary: impl ToString, message: impl ToString) {
-        let _ = self.tx.try_send(BlockEvent::LogEvent(LogEvent::Transient(
-            TransientLogEvent::pending_info(self.uuid, summary, message, &self.namespace),
-        )));
+        self.log_transient(TransientLogEvent::pending_info(
+            self.uuid,
+            summary,
+            message,
+            &self.namespace,
+        ));
     }
 
     pub fn success_info(&self, summary: impl ToString, message: impl ToString) {
-        let _ = self.tx.try_send(BlockEvent::LogEvent(LogEvent::Transient(
-            TransientLogEvent::success_info(self.uuid, summary, message, &self.namespace),
-        )));
+        self.log_transient(TransientLogEvent::success_info(
+            self.uuid,
+            summary,
+            message,
+            &self.namespace,
+        ));
     }
 
     pub fn failure_info(&self, summary: impl ToString, message: impl ToString) {
-        let _ = self.tx.try_send(BlockEvent::LogEvent(LogEvent::Transient(
-            TransientLogEvent::failure_info(self.uuid, summary, message, &self.namespace),
-        )));
+        self.log_transient(TransientLogEvent::failure_info(
+            self.uuid,
+            summary,
+            message,
+            &self.namespace,
+        ));
     }
     pub fn failure_with_diag(
         &self,
@@ -303,6 +507,14 @@ impl LogDispatcher {
     }
 }
 
+impl Drop for LogDispatcher {
+    fn drop(&mut self) {
+        if let Ok(mut state) = self.shared.state.lock() {
+            self.shared.flush(&mut state);
+        }
+    }
+}
+
 impl BlockEvent {
     pub fn static_log(
         level: LogLevel,
@@ -2312,3 +2524,79 @@ impl SupervisorAddonData {
         Self { addon_name: addon_name.to_string(), rpc_api_url }
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use uuid::Uuid;
+
+    use super::{BlockEvent, LogDispatcher, LogEvent, TransientLogEventStatus};
+
+    fn drain(rx: &crate::channel::Receiver<BlockEvent>) -> Vec<LogEvent> {
+        rx.try_iter().map(|event| event.expect_log_event().clone()).collect()
+    }
+
+    #[test]
+    fn it_coalesces_pending_events_within_a_tick() {
+        let (tx, rx) = crate::channel::unbounded();
+        let logger = LogDispatcher::new(Uuid::new_v4(), "test", &tx);
+        for i in 0..100 {
+            logger.pending_info("Pending", format!("Writing chunk {}/100", i + 1));
+        }
+        // the first pending event is sent, the following ones are held back
+        let events = drain(&rx);
+        assert_eq!(events.len(), 1);
+
+        logger.success_info("Complete", "Chunks written");
+        let events = drain(&rx);
+        assert_eq!(events.len(), 1);
+        let LogEvent::Transient(event) = &events[0] else { panic!("transient event expected") };
+        assert!(matches!(event.status, TransientLogEventStatus::Success(_)));
+    }
+
+    #[test]
+    fn it_sends_the_pending_event_held_back_once_the_tick_elapsed() {
+        let (tx, rx) = crate::channel::unbounded();
+        let logger = LogDispatcher::new(Uuid::new_v4(), "test", &tx);
+        logger.pending_info("Pending", "Checking confirmations (0/2)");
+        logger.pending_info("Pending", "Checking confirmations (1/2)");
+        assert_eq!(drain(&rx).len(), 1);
+
+        // no event follows, the latest pending event is still sent
+        let event = rx
+            .recv_timeout(super::LOG_COALESCING_TICK * 10)
+            .expect("pending event held back should be sent");
+        let LogEvent::Transient(event) = event.expect_log_event() else {
+            panic!("transient event expected")
+        };
+        assert_eq!(event.message(), "Checking confirmations (1/2)");
+        drop(logger);
+        assert!(drain(&rx).is_empty());
+    }
+
+    #[test]
+    fn it_aggregates_repeated_static_events() {
+        let (tx, rx) = crate::channel::unbounded();
+        let logger = LogDispatcher::new(Uuid::new_v4(), "test", &tx);
+        for _ in 0..10 {
+            logger.warn("Retrying", "RPC unavailable");
+        }
+        logger.pending_info("Pending", "Checking confirmations");
+        drop(logger);
+
+        let messages = drain(&rx)
+            .into_iter()
+            .map(|event| match event {
+                LogEvent::Static(event) => event.details.message,
+                LogEvent::Transient(event) => event.message(),
+            })
+            .collect::<Vec<_>>();
+        assert_eq!(
+            messages,
+            vec![
+                "RPC unavailable".to_string(),
+                "RPC unavailable (repeated 9 times)".to_string(),
+                "Checking confirmations".to_string(),
+            ]
+        );
+    }
+}
@@ -15,11 +15,14 @@ use types::{ObjectDefinition, ObjectProperty, Type};
 use uuid::Uuid;
 
 use crate::helpers::fs::FileLocation;
+use crate::helpers::hex::PrefixedHex;
+use run_resources::RunResources;
 
 pub mod block_id;
 pub mod cloud_interface;
 pub mod commands;
 pub mod construct_type;
+pub mod cost_estimation;
 pub mod typed_block;
 pub mod diagnostic_types;
 pub mod diagnostics;
@@ -31,6 +34,7 @@ pub mod embedded_runbooks;
 pub mod frontend;
 pub mod functions;
 pub mod package;
+pub mod run_resources;
 pub mod signers;
 pub mod stores;
 pub mod types;
@@ -44,17 +48,20 @@ mod tests;
 pub struct Did(pub [u8; 32]);
 
 impl Did {
-    pub fn from_components(comps: Vec<impl AsRef<[u8]>>) -> Self {
-        let mut hasher = Sha256::new();
+    /// Derives a DID from the SHA-256 of its components. Components can be passed as an array
+    /// (`Did::from_components([a, b])`) to avoid allocating a vector.
+    ///
+    /// DIDs are persisted in state files: the derivation must remain stable across versions.
+    pub fn from_components(comps: impl IntoIterator<Item = impl AsRef<[u8]>>) -> Self {
+        let mut hasher = DidHasher::new();
         for comp in comps {
             hasher.update(comp);
         }
-        let hash = hasher.finalize();
-        Did(hash.into())
+        hasher.finalize()
     }
 
     pub fn from_hex_string(source_bytes_str: &str) -> Self {
-        let bytes = hex::decode(source_bytes_str).expect("invalid hex_string");
+        let bytes = crate::helpers::hex::decode(source_bytes_str).expect("invalid hex_string");
         Self::from_bytes(&bytes)
     }
 
@@ -69,7 +76,7 @@ impl Did {
     }
 
     pub fn to_string(&self) -> String {
-        hex::encode(self.0)
+        crate::helpers::hex::encode(self.0)
     }
 
     pub fn as_bytes(&self) -> &[u8] {
@@ -81,12 +88,49 @@ impl Did {
     }
 }
 
+/// Incremental derivation of a [Did], for components that are not at hand as byte slices.
+/// Values can be serialized straight into the hasher, which implements [std::io::Write].
+pub struct DidHasher(Sha256);
+
+impl DidHasher {
+    pub fn new() -> Self {
+        DidHasher(Sha256::new())
+    }
+
+    pub fn update(&mut self, bytes: impl AsRef<[u8]>) -> &mut Self {
+        self.0.update(bytes);
+        self
+    }
+
+    /// Hashes the JSON serialization of `value`, without building an intermediate string.
+    pub fn update_json(&mut self, value: &impl Serialize) -> &mut Self {
+        // writing to the hasher is infallible
+        let _ = serde_json::to_writer(&mut *self, value);
+        self
+    }
+
+    pub fn finalize(self) -> Did {
+        Did(self.0.finalize().into())
+    }
+}
+
+impl std::io::Write for DidHasher {
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        self.0.update(buf);
+        Ok(buf.len())
+    }
+
+    fn flush(&mut self) -> std::io::Result<()> {
+        Ok(())
+    }
+}
+
 impl Serialize for Did {
     fn serialize<S>(&self, serializer: S) -> Result<S::Ok, S::Error>
     where
         S: Serializer,
     {
-        serializer.serialize_str(&format!("0x{}", self))
+        serializer.collect_str(&PrefixedHex(&self.0))
     }
 }
 
@@ -96,7 +140,8 @@ impl<'de> Deserialize<'de> for Did {
         D: Deserializer<'de>,
     {
         let bytes_hex: String = serde::Deserialize::deserialize(deserializer)?;
-        let bytes = hex::decode(&bytes_hex[2..]).map_err(|e| D::Error::custom(e.to_string()))?;
+        let bytes = crate::helpers::hex::decode(&bytes_hex[2..])
+            .map_err(|e| D::Error::custom(e.to_string()))?;
         Ok(Did::from_bytes(&bytes))
     }
 }
@@ -145,15 +190,12 @@ impl RunbookId {
         RunbookId { org, workspace, name: name.into() }
     }
     pub fn did(&self) -> RunbookDid {
-        let mut comps = vec![];
-        if let Some(ref org) = self.org {
-            comps.push(org.as_bytes());
-        }
-        if let Some(ref workspace) = self.workspace {
-            comps.push(workspace.as_bytes());
-        }
-        comps.push(self.name.as_bytes());
-        let did = Did::from_components(comps);
+        let did = Did::from_components(
+            [self.org.as_ref(), self.workspace.as_ref(), Some(&self.name)]
+                .into_iter()
+                .flatten()
+                .map(|comp| comp.as_bytes()),
+        );
         RunbookDid(did)
     }
 
@@ -202,14 +244,14 @@ pub struct PackageId {
 
 impl PackageId {
     pub fn did(&self) -> PackageDid {
-        let did = Did::from_components(vec![
-            self.runbook_id.did().as_bytes(),
-            self.package_name.to_string().as_bytes(),
+        let mut hasher = DidHasher::new();
+        hasher
+            .update(self.runbook_id.did().as_bytes())
+            .update(self.package_name.as_bytes())
             // todo(lgalabru): This should be done upstream.
             // Serializing is allowing us to get a canonical location.
-            serde_json::json!(self.package_location).to_string().as_bytes(),
-        ]);
-        PackageDid(did)
+            .update_json(&self.package_location);
+        PackageDid(hasher.finalize())
     }
 
     pub fn zero() -> PackageId {
@@ -280,15 +322,15 @@ pub struct ConstructId {
 
 impl ConstructId {
     pub fn did(&self) -> ConstructDid {
-        let did = Did::from_components(vec![
-            self.package_id.did().as_bytes(),
-            self.construct_type.as_ref().as_bytes(),  // Zero-cost conversion via AsRef trait
-            self.construct_name.to_string().as_bytes(),
+        let mut hasher = DidHasher::new();
+        hasher
+            .update(self.package_id.did().as_bytes())
+            .update(self.construct_type.as_ref()) // Zero-cost conversion via AsRef trait
+            .update(self.construct_name.as_bytes())
             // todo(lgalabru): This should be done upstream.
             // Serializing is allowing us to get a canonical location.
-            serde_json::json!(self.construct_location).to_string().as_bytes(),
-        ]);
-        ConstructDid(did)
+            .update_json(&self.construct_location);
+        ConstructDid(hasher.finalize())
     }
 
     /// Get the construct type as a string reference.
@@ -308,15 +350,17 @@ pub struct Construct {
 #[derive(Debug, Clone)]
 pub struct AuthorizationContext {
     pub workspace_location: FileLocation,
+    /// Resources scoped to the run, shared by the copies of this context
+    pub run_resources: RunResources,
 }
 
 impl AuthorizationContext {
     pub fn new(workspace_location: FileLocation) -> Self {
-        Self { workspace_location }
+        Self { workspace_location, run_resources: RunResources::new() }
     }
 
     pub fn empty() -> Self {
-        Self { workspace_location: FileLocation::working_dir() }
+        Self { workspace_location: FileLocation::working_dir(), run_resources: RunResources::new() }
     }
 
     pub fn get_file_location_from_path_buf(&self, input: &PathBuf) -> Result<FileLocation, String> {
@@ -0,0 +1,63 @@
+use std::any::{Any, TypeId};
+use std::collections::HashMap;
+use std::fmt;
+use std::sync::{Arc, Mutex};
+
+/// Resources shared by the commands of a run and dropped with it, such as HTTP clients and
+/// response caches. Connections pooled by a client are bound to the runtime executing the run,
+/// and cached data must not leak from one run to the next. Each addon stores its own resources,
+/// indexed by their type.
+#[derive(Clone, Default)]
+pub struct RunResources {
+    resources: Arc<Mutex<HashMap<TypeId, Arc<dyn Any + Send + Sync>>>>,
+}
+
+impl RunResources {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Returns the resource of type `T` of the run, initializing it on first use.
+    pub fn get_or_init<T, F>(&self, init: F) -> Arc<T>
+    where
+        T: Any + Send + Sync,
+        F: FnOnce() -> T,
+    {
+        let resource = self
+            .resources
+            .lock()
+            .unwrap()
+            .entry(TypeId::of::<T>())
+            .or_insert_with(|| Arc::new(init()))
+            .clone();
+        resource.downcast::<T>().expect("run resources are indexed by their type")
+    }
+}
+
+impl fmt::Debug for RunResources {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let count = self.resources.lock().map(|r| r.len()).unwrap_or(0);
+        f.debug_struct("RunResources").field("resources", &count).finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::sync::atomic::{AtomicUsize, Ordering};
+
+    use super::RunResources;
+
+    #[test]
+    fn it_initializes_resources_once_per_run() {
+        struct Counter(AtomicUsize);
+
+        let run = RunResources::new();
+        run.get_or_init(|| Counter(AtomicUsize::new(0))).0.fetch_add(1, Ordering::Relaxed);
+        let counter = run.clone().get_or_init(|| Counter(AtomicUsize::new(0)));
+        assert_eq!(counter.0.load(Ordering::Relaxed), 1);
+
+        let other_run = RunResources::new();
+        let counter = other_run.get_or_init(|| Counter(AtomicUsize::new(0)));
+        assert_eq!(counter.0.load(Ordering::Relaxed), 0);
+    }
+}
@@ -572,9 +572,9 @@ impl ValueMap {
             Value::Buffer(bytes) => bytes.clone(),
             Value::String(bytes) => {
                 let bytes = if bytes.starts_with("0x") {
-                    crate::hex::decode(&bytes[2..]).unwrap()
+                    crate::helpers::hex::decode(&bytes[2..]).unwrap()
                 } else {
-                    crate::hex::decode(&bytes).unwrap()
+                    crate::helpers::hex::decode(&bytes).unwrap()
                 };
                 bytes
             }
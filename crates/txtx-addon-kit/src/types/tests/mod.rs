@@ -51,6 +51,23 @@ fn it_deserializes_values(val: JsonValue) {
         .unwrap();
 }
 
+#[test_case(Value::string("Test".to_string()))]
+#[test_case(Value::integer(-10))]
+#[test_case(Value::float(1.5))]
+#[test_case(Value::null())]
+#[test_case(Value::array(vec![Value::buffer(BYTES.clone()), Value::integer(1)]))]
+#[test_case({
+    let mut o = indexmap::IndexMap::new();
+     o.insert("key1".to_string(), Value::buffer(BYTES.clone()));
+     o.insert("nested".to_string(), Value::Object(o.clone()));
+     Value::Object(o)
+})]
+#[test_case(Value::addon(BYTES.clone(), "ns::type"))]
+fn it_streams_values_as_json(value: Value) {
+    let streamed = serde_json::to_string(&value.as_json_serializable(None)).unwrap();
+    assert_eq!(streamed, value.to_json(None).to_string());
+}
+
 #[test]
 fn it_rejects_invalid_keys() {
     match serde_json::from_value::<Value>(json!({"type": "strin", "value": "my string"})) {
@@ -72,3 +89,63 @@ fn test_auth_context_get_path_from_str(path_str: &str, expected: &str) {
     let result = auth_context.get_file_location_from_path_buf(&PathBuf::from(path_str)).unwrap();
     assert_eq!(result.to_string(), expected);
 }
+
+#[test]
+fn test_dids_derivation_is_stable() {
+    use super::{construct_type::ConstructType, ConstructId, PackageId, RunbookId};
+
+    // DIDs are persisted in state files, any change to their derivation orphans existing states
+    let runbook_id = RunbookId::new(Some("acme".into()), None, "deploy");
+    let package_id = PackageId {
+        runbook_id: runbook_id.clone(),
+        package_location: FileLocation::from_url_string("https://example.com/runbooks/").unwrap(),
+        package_name: "main".into(),
+    };
+    let construct_id = ConstructId {
+        package_id: package_id.clone(),
+        construct_location: FileLocation::from_url_string("https://example.com/runbooks/deploy.tx")
+            .unwrap(),
+        construct_type: ConstructType::Action,
+        construct_name: "transfer".into(),
+    };
+    assert_eq!(
+        runbook_id.did().to_string(),
+        "17111867ea2407fbb2da7c7d4a92374ebb5fd434a9d8a9e48a20912d05204593"
+    );
+    assert_eq!(
+        package_id.did().to_string(),
+        "bc5ddb7d4f7c3769180308495000731b90ca5cee76ee7f1668bc6e853f49c897"
+    );
+    assert_eq!(
+        construct_id.did().to_string(),
+        "ef3b79dda215e145b9ac6bb60c21e5decff1e8e87794aa34c755b11aaa8db278"
+    );
+}
+
+#[test]
+fn test_layered_dependency_execution_results() {
+    use super::commands::{CommandExecutionResult, DependencyExecutionResultCache};
+    use super::{ConstructDid, Did};
+
+    let a = ConstructDid(Did::from_components([b"a"]));
+    let b = ConstructDid(Did::from_components([b"b"]));
+    let a_result = CommandExecutionResult::from([("value", Value::integer(1))]);
+    let b_result = CommandExecutionResult::from([("value", Value::integer(2))]);
+    let update = CommandExecutionResult::from([("other", Value::integer(3))]);
+
+    let mut base = DependencyExecutionResultCache::new();
+    base.merge_borrowed(&a, &a_result).unwrap();
+
+    let mut layer = DependencyExecutionResultCache::layered_on(&base);
+    layer.merge_borrowed(&b, &b_result).unwrap();
+    // results are borrowed, not copied
+    assert!(std::ptr::eq(layer.get(&a).unwrap().unwrap(), &a_result));
+    assert!(std::ptr::eq(layer.get(&b).unwrap().unwrap(), &b_result));
+
+    // merging onto a result of the base copies it into the layer, leaving the base untouched
+    layer.merge_borrowed(&a, &update).unwrap();
+    let merged = layer.get(&a).unwrap().unwrap();
+    assert_eq!(merged.outputs.get("value").and_then(|v| v.as_integer()), Some(1));
+    assert_eq!(merged.outputs.get("other").and_then(|v| v.as_integer()), Some(3));
+    assert!(base.get(&a).unwrap().unwrap().outputs.get("other").is_none());
+}
@@ -3,7 +3,7 @@ use hcl_edit::structure::Block;
 use indexmap::IndexMap;
 use jaq_interpret::Val;
 use serde::de::{self, MapAccess, Visitor};
-use serde::ser::SerializeMap;
+use serde::ser::{SerializeMap, SerializeSeq};
 use serde::{Deserialize, Deserializer, Serialize, Serializer};
 use serde_json::{Map, Value as JsonValue};
 use std::collections::VecDeque;
@@ -13,6 +13,7 @@ use crate::helpers::hcl::{
     collect_constructs_references_from_block, collect_constructs_references_from_expression,
     visit_optional_untyped_attribute,
 };
+use crate::helpers::hex::{encode_prefixed, PrefixedHex};
 use crate::types::frontend::{LogDetails, LogEvent, StaticLogEvent};
 use crate::types::ConstructDid;
 
@@ -94,8 +95,7 @@ fn hex_serializer<S>(bytes: &Vec<u8>, ser: S) -> Result<S::Ok, S::Error>
 where
     S: Serializer,
 {
-    let value = format!("0x{}", hex::encode(&bytes));
-    ser.serialize_str(&value)
+    PrefixedHex(bytes).serialize(ser)
 }
 
 fn addon_serializer<S>(addon_data: &AddonData, ser: S) -> Result<S::Ok, S::Error>
@@ -104,8 +104,7 @@ where
 {
     let mut map = ser.serialize_map(Some(2))?;
     map.serialize_entry("type", &addon_data.id)?;
-    let value = format!("0x{}", hex::encode(&addon_data.bytes));
-    map.serialize_entry("value", &value)?;
+    map.serialize_entry("value", &PrefixedHex(&addon_data.bytes))?;
     map.end()
 }
 
@@ -117,8 +116,7 @@ impl<'de> Deserialize<'de> for Value {
         struct ValueVisitor;
 
         fn decode_hex_string(value: String) -> Result<Vec<u8>, String> {
-            let value = value.replace("0x", "");
-            hex::decode(&value)
+            crate::helpers::hex::decode_prefixed(&value)
                 .map_err(|e| format!("failed to decode hex string ({}) to bytes: {}", value, e))
         }
         impl<'de> Visitor<'de> for ValueVisitor {
@@ -493,9 +491,9 @@ impl Value {
             Value::Buffer(value) => value.clone(),
             Value::String(bytes) => {
                 let bytes = if bytes.starts_with("0x") {
-                    crate::hex::decode(&bytes[2..]).unwrap()
+                    crate::helpers::hex::decode(&bytes[2..]).unwrap()
                 } else {
-                    crate::hex::decode(&bytes).unwrap()
+                    crate::helpers::hex::decode(&bytes).unwrap()
                 };
                 bytes
             }
@@ -514,7 +512,7 @@ impl Value {
             Value::Buffer(value) => value.clone(),
             Value::String(bytes) => {
                 let stripped = if bytes.starts_with("0x") { &bytes[2..] } else { &bytes[..] };
-                let bytes = crate::hex::decode(stripped).map_err(|e| {
+                let bytes = crate::helpers::hex::decode(stripped).map_err(|e| {
                     format!("string '{}' could not be decoded to hex bytes: {}", bytes, e)
                 })?;
                 bytes
@@ -698,9 +696,9 @@ impl Value {
             }
             Value::String(bytes) => {
                 let bytes = if bytes.starts_with("0x") {
-                    crate::hex::decode(&bytes[2..]).unwrap()
+                    crate::helpers::hex::decode(&bytes[2..]).unwrap()
                 } else {
-                    match crate::hex::decode(&bytes) {
+                    match crate::helpers::hex::decode(&bytes) {
                         Ok(res) => res,
                         Err(_) => bytes.as_bytes().to_vec(),
                     }
@@ -735,9 +733,9 @@ impl Value {
             }
             Value::String(bytes) => {
                 let bytes = if bytes.starts_with("0x") {
-                    crate::hex::decode(&bytes[2..]).unwrap()
+                    crate::helpers::hex::decode(&bytes[2..]).unwrap()
                 } else {
-                    match crate::hex::decode(&bytes) {
+                    match crate::helpers::hex::decode(&bytes) {
                         Ok(res) => res,
                         Err(_) => bytes.as_bytes().to_vec(),
                     }
@@ -782,7 +780,17 @@ impl Value {
 
     pub fn compute_fingerprint(&self) -> Did {
         let bytes = self.to_be_bytes();
-        Did::from_components(vec![bytes])
+        Did::from_components([bytes])
+    }
+
+    /// Borrows this value as a [Serialize] implementor producing the same JSON as [Value::to_json],
+    /// without building an intermediate [JsonValue] tree. Use it with `serde_json::to_writer`
+    /// to stream large values (arrays, program binaries, ...) straight to their destination.
+    pub fn as_json_serializable<'a, 'b>(
+        &'a self,
+        addon_converters: Option<&'a Vec<AddonJsonConverter<'b>>>,
+    ) -> JsonSerializableValue<'a, 'b> {
+        JsonSerializableValue { value: self, addon_converters }
     }
 
     pub fn to_json(&self, addon_converters: Option<&Vec<AddonJsonConverter>>) -> JsonValue {
@@ -801,7 +809,7 @@ impl Value {
                     .map(|(k, v)| (k.clone(), v.to_json(addon_converters)))
                     .collect::<Map<String, JsonValue>>(),
             ),
-            Value::Buffer(vec) => JsonValue::String(format!("0x{}", hex::encode(&vec))),
+            Value::Buffer(vec) => JsonValue::String(encode_prefixed(&vec)),
             Value::Addon(addon_data) => {
                 if let Some(addon_converters) = addon_converters.as_ref() {
                     let parsed_values = addon_converters
@@ -819,6 +827,53 @@ impl Value {
     }
 }
 
+/// See [Value::as_json_serializable].
+pub struct JsonSerializableValue<'a, 'b> {
+    value: &'a Value,
+    addon_converters: Option<&'a Vec<AddonJsonConverter<'b>>>,
+}
+
+impl Serialize for JsonSerializableValue<'_, '_> {
+    fn serialize<S>(&self, ser: S) -> Result<S::Ok, S::Error>
+    where
+        S: Serializer,
+    {
+        match self.value {
+            Value::Bool(b) => ser.serialize_bool(*b),
+            Value::Null => ser.serialize_unit(),
+            Value::Integer(i) => ser.serialize_i64(*i as i64),
+            Value::Float(f) => ser.serialize_f64(*f),
+            Value::String(s) => ser.serialize_str(s),
+            Value::Array(values) => {
+                let mut seq = ser.serialize_seq(Some(values.len()))?;
+                for value in values.iter() {
+                    seq.serialize_element(&value.as_json_serializable(self.addon_converters))?;
+                }
+                seq.end()
+            }
+            Value::Object(index_map) => {
+                let mut map = ser.serialize_map(Some(index_map.len()))?;
+                for (key, value) in index_map.iter() {
+                    map.serialize_entry(key, &value.as_json_serializable(self.addon_converters))?;
+                }
+                map.end()
+            }
+            Value::Buffer(bytes) => PrefixedHex(bytes).serialize(ser),
+            Value::Addon(addon_data) => {
+                if let Some(addon_converters) = self.addon_converters {
+                    let parsed_value = addon_converters
+                        .iter()
+                        .find_map(|converter| converter(self.value).ok().flatten());
+                    if let Some(parsed_value) = parsed_value {
+                        return parsed_value.serialize(ser);
+                    }
+                }
+                PrefixedHex(&addon_data.bytes).serialize(ser)
+            }
+        }
+    }
+}
+
 fn i128_to_u64(i128: i128) -> Result<u64, String> {
     u64::try_from(i128).map_err(|e| format!("invalid uint: {e}"))
 }
@@ -830,9 +885,7 @@ impl Value {
             Value::Integer(val) => val.to_string(),
             Value::Float(val) => val.to_string(),
             Value::Null => "null".to_string(),
-            Value::Buffer(bytes) => {
-                format!("0x{}", hex::encode(&bytes))
-            }
+            Value::Buffer(bytes) => encode_prefixed(&bytes),
             Value::Object(obj) => {
                 let mut res = "{".to_string();
                 let len = obj.len();
@@ -865,7 +918,7 @@ impl Value {
             Value::Float(val) => val.to_string(),
             Value::Null => "null".to_string(),
             Value::Buffer(bytes) => {
-                format!(r#""0x{}""#, hex::encode(&bytes))
+                format!(r#""{}""#, PrefixedHex(&bytes))
             }
             Value::Object(obj) => {
                 let mut res = "{".to_string();
@@ -1007,10 +1060,10 @@ pub struct AddonData {
 }
 impl AddonData {
     pub fn to_string(&self) -> String {
-        format!("0x{}", hex::encode(&self.bytes))
+        encode_prefixed(&self.bytes)
     }
     pub fn encode_to_string(&self) -> String {
-        format!(r#""0x{}""#, hex::encode(&self.bytes))
+        format!(r#""{}""#, PrefixedHex(&self.bytes))
     }
 }
 
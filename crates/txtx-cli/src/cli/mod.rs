@@ -133,6 +133,12 @@ pub struct CheckRunbook {
     /// A set of inputs to use for batch processing
     #[arg(long = "input")]
     pub inputs: Vec<String>,
+    /// Display the execution levels and the critical path of the runbook, estimated from the previous execution's timings
+    #[arg(long = "plan-stats")]
+    pub plan_stats: bool,
+    /// Estimate the fees of the transactions of the runbook, and check the balances of the signers paying them
+    #[arg(long = "estimate")]
+    pub estimate: bool,
 }
 
 #[derive(Parser, PartialEq, Clone, Debug)]
@@ -175,12 +181,18 @@ pub struct ExecuteRunbook {
     /// When running in unsupervised mode, print outputs in JSON format. If a directory is provided, the output will be written a file at the directory.
     #[arg(long = "output-json")]
     pub output_json: Option<Option<String>>,
+    /// When outputs are printed in JSON format, emit one JSON object per output (JSON Lines) instead of a single document
+    #[arg(long = "json-lines", action=ArgAction::SetTrue, requires = "output_json")]
+    pub json_lines: bool,
     /// Pick a specific output to stdout at the end of the execution
     #[arg(long = "output", conflicts_with = "output_json")]
     pub output: Option<String>,
     /// Explain how the runbook will be executed.
     #[arg(long = "explain", action=ArgAction::SetTrue)]
     pub explain: bool,
+    /// Only execute the given constructs (e.g. output.address,action.deploy) and the constructs they depend on
+    #[arg(long = "target", value_delimiter = ',')]
+    pub targets: Vec<String>,
     /// Set the port for hosting the web UI
     #[arg(long = "port", short = 'p', default_value = txtx_supervisor_ui::DEFAULT_BINDING_PORT )]
     #[cfg(feature = "supervisor_ui")]
@@ -202,6 +214,12 @@ pub struct ExecuteRunbook {
     /// The log level to use for the runbook execution. Options are "trace", "debug", "info", "warn", "error".
     #[arg(long = "log-level", short = 'l', default_value = "info")]
     pub log_level: String,
+    /// When running with supervision, number of completed blocks kept in full detail before being compacted into summaries
+    #[arg(long = "block-retention", default_value = "256")]
+    pub block_retention: usize,
+    /// When running with supervision, append the full detail of compacted blocks to this file, as JSON lines
+    #[arg(long = "block-spill")]
+    pub block_spill_path: Option<String>,
 }
 
 impl ExecuteRunbook {
@@ -412,6 +430,8 @@ mod tests {
         assert_eq!(result.network_binding_ip_address, "localhost");
         assert_eq!(result.environment, None);
         assert!(result.inputs.is_empty());
+        assert_eq!(result.block_retention, 256);
+        assert_eq!(result.block_spill_path, None);
     }
 
     #[test]
@@ -441,6 +461,13 @@ mod tests {
         assert_eq!(result.term_console, true);
     }
 
+    #[test]
+    fn test_targets_setting() {
+        let args = vec!["txtx", "runbook", "--target", "output.address,action.deploy"];
+        let result = parse_args(args);
+        assert_eq!(result.targets, vec!["output.address", "action.deploy"]);
+    }
+
     #[test]
     #[cfg(feature = "supervisor_ui")]
     fn test_port_setting() {
@@ -17,6 +17,7 @@ use std::{
 use tokio::sync::RwLock;
 use txtx_cloud::router::TxtxAuthenticatedCloudServiceRouter;
 use txtx_core::{
+    eval::run_signers_evaluation,
     kit::types::{commands::UnevaluatedInputsMap, stores::ValueStore},
     mustache,
     templates::{TXTX_MANIFEST_TEMPLATE, TXTX_README_TEMPLATE},
@@ -25,11 +26,13 @@ use txtx_core::{
 use txtx_core::{
     kit::{
         channel::{self, unbounded},
+        futures::future::join_all,
         hcl::{structure::Block, Ident},
-        helpers::fs::FileLocation,
+        helpers::{fs::FileLocation, rpc_limiter::rpc_endpoints_usage},
         indexmap::IndexMap,
         types::{
             commands::{CommandId, CommandInputsEvaluationResult},
+            cost_estimation::{CostEstimationResult, CostPayer},
             diagnostics::Diagnostic,
             frontend::BlockEvent,
             stores::AddonDefaults,
@@ -43,7 +46,8 @@ use txtx_core::{
         RunbookMetadata, RunbookStateLocation, WorkspaceManifest,
     },
     runbook::{
-        AddonConstructFactory, ConsolidatedChanges, RunbookTopLevelInputsMap, SynthesizedChange,
+        AddonConstructFactory, ConsolidatedChanges, RunbookExecutionSnapshot, RunbookOutputsFormat,
+        RunbookTopLevelInputsMap, SynthesizedChange,
     },
     start_supervised_runbook_runloop, start_unsupervised_runbook_runloop,
     types::{ConstructDid, ConstructType, Runbook, RunbookSnapshotContext, RunbookSources},
@@ -52,10 +56,11 @@ use txtx_core::{
     runbook::DEFAULT_TOP_LEVEL_INPUTS_NAME,
     templates::{build_manifest_data, build_runbook_data},
 };
+use txtx_gql::block_store::BlockStoreManager;
 use txtx_gql::kit::{
     types::{
         cloud_interface::CloudServiceContext,
-        frontend::{LogDetails, LogEvent, LogLevel, TransientLogEventStatus},
+        frontend::{LogDetails, LogDispatcher, LogEvent, LogLevel, TransientLogEventStatus},
         types::AddonJsonConverter,
         RunbookInstanceContext,
     },
@@ -195,6 +200,9 @@ pub async fn handle_check_command(
                 &runbook.runbook_id.name,
                 &runbook.top_level_inputs_map.current_top_level_input_name(),
             )?;
+            if cmd.plan_stats {
+                display_plan_stats(&runbook, Some(&old));
+            }
             for run in runbook.flow_contexts.iter_mut() {
                 let frontier = HashSet::new();
                 let _res = run
@@ -227,11 +235,174 @@ pub async fn handle_check_command(
 
             display_snapshot_diffing(consolidated_changes);
         }
-        None => {}
+        None => {
+            if cmd.plan_stats {
+                display_plan_stats(&runbook, None);
+            }
+        }
+    }
+    if cmd.estimate {
+        display_cost_estimates(&mut runbook).await;
     }
     Ok(())
 }
 
+pub fn display_plan_stats(runbook: &Runbook, previous_snapshot: Option<&RunbookExecutionSnapshot>) {
+    for flow_context in runbook.flow_contexts.iter() {
+        let costs = previous_snapshot
+            .and_then(|snapshot| snapshot.flows.get(&flow_context.name))
+            .map(|flow_snapshot| flow_snapshot.commands_execution_durations())
+            .unwrap_or_default();
+        // without timings from a previous execution, each construct counts as one step
+        let (default_cost, unit) = if costs.is_empty() { (1, "steps") } else { (0, "ms") };
+        let stats = flow_context.graph_context.compute_plan_stats(&costs, default_cost);
+        let construct_name = |construct_did: &ConstructDid| {
+            let construct_id = flow_context.workspace_context.expect_construct_id(construct_did);
+            format!("{}.{}", construct_id.construct_type, construct_id.construct_name)
+        };
+
+        println!("\n{}", yellow!("Plan statistics for flow '{}'", flow_context.name));
+        println!(
+            "{} constructs, executable in {} levels:",
+            stats.estimated_costs.len(),
+            stats.levels.len()
+        );
+        for (i, level) in stats.levels.iter().enumerate() {
+            println!("{}. {}", i + 1, level.iter().map(|c| construct_name(c)).join(", "));
+        }
+        println!("\n{} {} {}", yellow!("Critical path:"), stats.critical_path_cost, unit);
+        for construct_did in stats.critical_path.iter() {
+            println!(
+                "- {} ({} {})",
+                construct_name(construct_did),
+                stats.estimated_costs[construct_did],
+                unit
+            );
+        }
+    }
+}
+
+/// Estimates the costs of the transactions of all the flows, and the balances of the signers
+/// paying them. Signers are activated when they do not require user interaction, and the
+/// runbook is simulated to evaluate the inputs of the transactions. The estimates of all the
+/// flows and addons are then collected concurrently.
+pub async fn display_cost_estimates(runbook: &mut Runbook) {
+    let mut diagnostics = vec![];
+    for flow_context in runbook.flow_contexts.iter_mut() {
+        let (progress_tx, _progress_rx) = unbounded();
+        let signers_pass_result = run_signers_evaluation(
+            &flow_context.workspace_context,
+            &mut flow_context.execution_context,
+            &runbook.runtime_context,
+            &runbook.supervision_context,
+            &mut BTreeMap::new(),
+            &BTreeMap::new(),
+            &progress_tx,
+        )
+        .await;
+        if signers_pass_result.has_diagnostics() {
+            diagnostics.extend(signers_pass_result.with_spans_filled(&runbook.sources));
+            continue;
+        }
+        let simulation_pass_result = flow_context
+            .execution_context
+            .simulate_execution(
+                &runbook.runtime_context,
+                &flow_context.workspace_context,
+                &runbook.supervision_context,
+                &HashSet::new(),
+            )
+            .await;
+        if simulation_pass_result.has_diagnostics() {
+            diagnostics.extend(simulation_pass_result.with_spans_filled(&runbook.sources));
+        }
+    }
+    let estimations = runbook
+        .runtime_context
+        .estimate_transactions_costs(runbook.flow_contexts.iter().map(|f| &f.execution_context));
+    let mut result = CostEstimationResult::new();
+    for mut estimation in join_all(estimations).await {
+        result.append(&mut estimation);
+    }
+
+    if !diagnostics.is_empty() {
+        println!("\n{}", yellow!("Simulation diagnostics"));
+        for diag in diagnostics.iter() {
+            println!("{} {}", red!("x"), diag);
+        }
+    }
+
+    println!("\n{}", yellow!("Transactions cost estimates"));
+    if result.transactions.is_empty() {
+        println!("No transaction to estimate");
+        return;
+    }
+    for tx in result.transactions.iter() {
+        match &tx.fee {
+            Ok(fee) => {
+                let transferred = if tx.amount > 0 {
+                    format!(", {} {} transferred", tx.amount, tx.denomination)
+                } else {
+                    "".into()
+                };
+                println!(
+                    "- {} ({}): {} {} in fees{}",
+                    tx.construct_name, tx.network, fee, tx.denomination, transferred
+                );
+            }
+            Err(e) => {
+                println!("- {} ({}): {} {}", tx.construct_name, tx.network, red!("no estimate"), e);
+            }
+        }
+    }
+
+    println!("\n{}", yellow!("Total cost per chain"));
+    for ((network, denomination), chain) in result.totals_per_chain().iter() {
+        let unestimated = if chain.unestimated_transactions > 0 {
+            format!(" ({} transactions not estimated)", chain.unestimated_transactions)
+        } else {
+            "".into()
+        };
+        println!(
+            "- {}: {} {} in fees, {} {} transferred{}",
+            network, chain.fees, denomination, chain.amounts, denomination, unestimated
+        );
+    }
+
+    println!("\n{}", yellow!("Total cost per signer"));
+    for ((network, denomination, payer), payer_total) in result.totals_per_payer().iter() {
+        let payer = match payer {
+            CostPayer::Address(address) => address.clone(),
+            CostPayer::Signer(signer_did) => {
+                let signer_name = runbook
+                    .flow_contexts
+                    .iter()
+                    .find_map(|flow| flow.execution_context.signers_instances.get(signer_did))
+                    .map(|signer| signer.name.clone())
+                    .unwrap_or_else(|| signer_did.to_string());
+                format!("signer '{}'", signer_name)
+            }
+        };
+        let total = payer_total.total;
+        let status = match &payer_total.balance {
+            Some(Ok(balance)) if *balance >= total => {
+                format!("{} balance {} {}", green!("✓"), balance, denomination)
+            }
+            Some(Ok(balance)) => format!(
+                "{} balance {} {}, {} {} missing",
+                red!("x"),
+                balance,
+                denomination,
+                total - balance,
+                denomination
+            ),
+            Some(Err(e)) => format!("{} {}", red!("balance unavailable:"), e),
+            None => "balance not checked".into(),
+        };
+        println!("- {} ({}): {} {}, {}", payer, network, total, denomination, status);
+    }
+}
+
 pub async fn handle_new_command(cmd: &CreateRunbook, _ctx: &Context) -> Result<(), String> {
     let manifest_location = FileLocation::from_path_string(&cmd.manifest_path)?;
     let manifest_res = WorkspaceManifest::from_location(&manifest_location);
@@ -460,11 +631,7 @@ pub async fn run_action(
     namespace: &str,
     raw_inputs: &Vec<String>,
 ) -> Result<(), Diagnostic> {
-    let factory = AddonConstructFactory {
-        functions: addon.build_function_lookup(),
-        commands: addon.build_command_lookup(),
-        signers: addon.build_signer_lookup(),
-    };
+    let factory = AddonConstructFactory::from_addon(addon.as_ref());
     let block = Block::new(Ident::new(ConstructType::Action.as_ref()));
     let construct_did = Did::zero();
     let command_id = CommandId::Action(command_name.into());
@@ -566,6 +733,10 @@ pub async fn handle_run_command(
 
     runbook.enable_full_execution_mode();
 
+    // targets are resolved before diffing, so that only the targeted changes are reviewed
+    let targets_closures =
+        if cmd.targets.is_empty() { None } else { Some(runbook.resolve_targets(&cmd.targets)?) };
+
     if !cmd.force_execution {
         if let Some(old) = previous_state_opt {
             let ctx = RunbookSnapshotContext::new();
@@ -600,8 +771,11 @@ pub async fn handle_run_command(
                 execution_context_backups,
             );
 
-            let (actions_to_re_execute, actions_to_execute) =
-                runbook.prepared_flows_for_updated_plans(&consolidated_changes.plans_to_update);
+            let (actions_to_re_execute, actions_to_execute) = runbook
+                .prepared_flows_for_updated_plans(
+                    &consolidated_changes.plans_to_update,
+                    targets_closures.as_ref(),
+                );
 
             let has_actions_to_re_execute =
                 actions_to_re_execute.iter().filter(|(_, actions)| !actions.is_empty()).count() > 0;
@@ -662,6 +836,16 @@ pub async fn handle_run_command(
         );
     }
 
+    if let Some(targets_closures) = targets_closures {
+        let constructs_to_execute = runbook.restrict_flows_to_targets(&targets_closures);
+        println!(
+            "{} Restricting execution to {} and its dependencies ({} constructs)",
+            yellow!("→"),
+            cmd.targets.join(", "),
+            constructs_to_execute
+        );
+    }
+
     if cmd.explain {
         for (location, _) in runbook.sources.tree.iter() {
             println!("Loading {}", location);
@@ -683,6 +867,9 @@ pub async fn handle_run_command(
 
     setup_logger(runbook.to_instance_context(), &cmd.log_level).unwrap();
     let log_filter: LogLevel = cmd.log_level.as_str().into();
+    LogDispatcher::set_level_filter(&log_filter);
+    let outputs_format =
+        if cmd.json_lines { RunbookOutputsFormat::JsonLines } else { RunbookOutputsFormat::Json };
 
     // should not be generating actions
     if is_execution_unsupervised {
@@ -716,6 +903,7 @@ pub async fn handle_run_command(
             runbook_state_location,
             &cmd.output_json,
             &cmd.output,
+            &outputs_format,
         );
 
         return Ok(());
@@ -725,6 +913,8 @@ pub async fn handle_run_command(
     let (block_broadcaster, _) = tokio::sync::broadcast::channel(5);
     let (log_broadcaster, _) = tokio::sync::broadcast::channel(5);
     let block_store = Arc::new(RwLock::new(BTreeMap::new()));
+    let mut block_store_manager =
+        BlockStoreManager::new(cmd.block_retention, cmd.block_spill_path.as_ref())?;
     let log_store = Arc::new(RwLock::new(Vec::new()));
     let (kill_loops_tx, kill_loops_rx) = channel::bounded(1);
     let (action_item_events_tx, action_item_events_rx) = tokio::sync::broadcast::channel(32);
@@ -754,6 +944,7 @@ pub async fn handle_run_command(
     let moved_runbook_state = runbook_state_location.clone();
     let output_json = cmd.output_json.clone();
     let output_filter = cmd.output.clone();
+    let moved_outputs_format = outputs_format.clone();
     let _ = hiro_system_kit::thread_named("Runbook Runloop").spawn(move || {
         let runloop_future =
             start_supervised_runbook_runloop(&mut runbook, moved_block_tx, action_item_events_rx);
@@ -764,6 +955,7 @@ pub async fn handle_run_command(
             moved_runbook_state,
             &output_json,
             &output_filter,
+            &moved_outputs_format,
         );
 
         if let Err(_e) = moved_kill_loops_tx.send(true) {
@@ -829,30 +1021,20 @@ pub async fn handle_run_command(
                 let mut do_propagate_event = true;
                 match block_event.clone() {
                     BlockEvent::Action(new_block) => {
-                        let len = block_store.len();
-                        block_store.insert(len, new_block.clone());
+                        block_store_manager.insert(&mut block_store, new_block);
                     }
                     BlockEvent::Clear => {
-                        *block_store = BTreeMap::new();
+                        block_store_manager.clear(&mut block_store);
                     }
                     BlockEvent::UpdateActionItems(updates) => {
                         // for action item updates, track if we actually changed anything before propagating the event
-                        do_propagate_event = false;
-                        let mut filtered_updates = vec![];
-                        for update in updates.iter() {
-                            for (_, block) in block_store.iter_mut() {
-                                let did_update = block.apply_action_item_updates(update.clone());
-                                if did_update {
-                                    do_propagate_event = true;
-                                    filtered_updates.push(update.clone());
-                                }
-                            }
-                        }
+                        let filtered_updates = block_store_manager
+                            .apply_action_item_updates(&mut block_store, &updates);
+                        do_propagate_event = !filtered_updates.is_empty();
                         block_event = BlockEvent::UpdateActionItems(filtered_updates);
                     }
                     BlockEvent::Modal(new_block) => {
-                        let len = block_store.len();
-                        block_store.insert(len, new_block.clone());
+                        block_store_manager.insert(&mut block_store, new_block);
                     }
                     BlockEvent::RunbookCompleted(additional_info) => {
                         for info in additional_info.into_iter() {
@@ -869,8 +1051,7 @@ pub async fn handle_run_command(
                         println!("\n{}", green!("Runbook complete!"));
                     }
                     BlockEvent::Error(new_block) => {
-                        let len = block_store.len();
-                        block_store.insert(len, new_block.clone());
+                        block_store_manager.insert(&mut block_store, new_block);
                     }
                     BlockEvent::LogEvent(log_event) => {
                         handle_log_event(
@@ -1047,7 +1228,22 @@ fn process_runbook_execution_output(
     runbook_state_location: Option<RunbookStateLocation>,
     output_json: &Option<Option<String>>,
     output_filter: &Option<String>,
+    outputs_format: &RunbookOutputsFormat,
 ) {
+    for usage in rpc_endpoints_usage() {
+        if usage.queued.is_zero() && usage.throttled_responses == 0 {
+            continue;
+        }
+        println!(
+            "{} RPC endpoint {}: {} requests, queued for {}ms, {} rate limited responses",
+            yellow!("!"),
+            usage.url,
+            usage.requests,
+            usage.queued.as_millis(),
+            usage.throttled_responses
+        );
+    }
+
     if let Err(diags) = execution_result {
         for diag in diags.iter() {
             println!("{} {}", red!("x"), diag);
@@ -1084,6 +1280,7 @@ fn process_runbook_execution_output(
                         &runbook.runbook_id.name,
                         &runbook.top_level_inputs_map.current_top_level_input_name(),
                         &converters,
+                        outputs_format,
                     ) {
                         Ok(output_location) => {
                             println!(
@@ -1097,11 +1294,10 @@ fn process_runbook_execution_output(
                         }
                     }
                 } else {
-                    println!(
-                        "{}",
-                        serde_json::to_string_pretty(&runbook_outputs.to_json(&converters))
-                            .unwrap()
-                    );
+                    let stdout = std::io::stdout().lock();
+                    if let Err(e) = runbook_outputs.write_to(stdout, &converters, outputs_format) {
+                        println!("{} failed to print runbook outputs: {}", red!("x"), e);
+                    }
                 }
             } else {
                 for (flow_name, data) in runbook_outputs.get_output_row_data(&output_filter) {
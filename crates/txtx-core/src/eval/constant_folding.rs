@@ -0,0 +1,250 @@
+use std::collections::{HashMap, HashSet};
+
+use txtx_addon_kit::hcl::expr::{Expression, ObjectKey};
+use txtx_addon_kit::hcl::template::Element;
+use txtx_addon_kit::types::commands::{CommandExecutionResult, DependencyExecutionResultCache};
+use txtx_addon_kit::types::types::Value;
+use txtx_addon_kit::types::{ConstructDid, PackageId};
+use txtx_addon_kit::types::{EvaluatableInput, WithEvaluatableInputs};
+
+use crate::runbook::{RunbookWorkspaceContext, RuntimeContext};
+use crate::types::RunbookExecutionContext;
+
+use super::{eval_expression, ExpressionEvaluationStatus};
+
+/// Evaluates, once, the command inputs that do not depend on any execution: literals, `std`
+/// functions and operators applied to constants, and references to non-editable variables
+/// whose value is itself constant. The folded values are keyed by construct and input name,
+/// and are picked up by `perform_inputs_evaluation` instead of re-evaluating the expression
+/// on every pass and simulation.
+///
+/// Inputs that fail to evaluate are left untouched, so that the regular evaluation reports
+/// the error with its usual context.
+pub fn fold_constant_inputs(
+    runbook_workspace_context: &RunbookWorkspaceContext,
+    runbook_execution_context: &RunbookExecutionContext,
+    runtime_context: &RuntimeContext,
+) -> HashMap<ConstructDid, HashMap<String, Value>> {
+    let mut folder =
+        ConstantFolder::new(runbook_workspace_context, runbook_execution_context, runtime_context);
+
+    let mut constant_inputs = HashMap::new();
+    for (construct_did, command_instance) in runbook_execution_context.commands_instances.iter() {
+        let package_id = &command_instance.package_id;
+        let mut folded_inputs = HashMap::new();
+        for input in command_instance.spec_inputs() {
+            // maps and objects are evaluated block by block, keep their dedicated path
+            if input.as_map().is_some() || input.as_object().is_some() {
+                continue;
+            }
+            let input_name = input.name();
+            let Some(expr) = command_instance.get_expression_from_input(&input_name) else {
+                continue;
+            };
+            if let Some(value) = folder.fold_expression(&expr, package_id) {
+                folded_inputs.insert(input_name, value);
+            }
+        }
+        if !folded_inputs.is_empty() {
+            constant_inputs.insert(construct_did.clone(), folded_inputs);
+        }
+    }
+    constant_inputs
+}
+
+struct ConstantFolder<'a> {
+    runbook_workspace_context: &'a RunbookWorkspaceContext,
+    runbook_execution_context: &'a RunbookExecutionContext,
+    runtime_context: &'a RuntimeContext,
+    /// Variables of the flow, the only constructs whose outputs can be folded
+    variables: HashSet<ConstructDid>,
+    /// Folded variables, exposed as execution results to the expressions referencing them
+    folded_variables: DependencyExecutionResultCache<'a>,
+    /// Variables already looked at; guards against cycles, which are reported by the graph
+    visited_variables: HashSet<ConstructDid>,
+}
+
+impl<'a> ConstantFolder<'a> {
+    fn new(
+        runbook_workspace_context: &'a RunbookWorkspaceContext,
+        runbook_execution_context: &'a RunbookExecutionContext,
+        runtime_context: &'a RuntimeContext,
+    ) -> Self {
+        let variables = runbook_workspace_context
+            .packages
+            .values()
+            .flat_map(|package| package.variables_dids.iter().cloned())
+            .collect();
+        Self {
+            runbook_workspace_context,
+            runbook_execution_context,
+            runtime_context,
+            variables,
+            folded_variables: DependencyExecutionResultCache::new(),
+            visited_variables: HashSet::new(),
+        }
+    }
+
+    fn fold_expression(&mut self, expr: &Expression, package_id: &PackageId) -> Option<Value> {
+        if !self.is_constant(expr, package_id) {
+            return None;
+        }
+        match eval_expression(
+            expr,
+            &self.folded_variables,
+            package_id,
+            self.runbook_workspace_context,
+            self.runbook_execution_context,
+            self.runtime_context,
+        ) {
+            Ok(ExpressionEvaluationStatus::CompleteOk(value)) => Some(value),
+            _ => None,
+        }
+    }
+
+    /// Returns true if `expr` can be evaluated without any execution result, folding the
+    /// variables it references along the way.
+    fn is_constant(&mut self, expr: &Expression, package_id: &PackageId) -> bool {
+        match expr {
+            Expression::Null(_)
+            | Expression::Bool(_)
+            | Expression::Number(_)
+            | Expression::String(_) => true,
+            Expression::Array(entries) => {
+                entries.iter().all(|entry| self.is_constant(entry, package_id))
+            }
+            Expression::Object(object) => object.iter().all(|(key, value)| {
+                let constant_key = match key {
+                    ObjectKey::Ident(_) => true,
+                    ObjectKey::Expression(key_expr) => self.is_constant(key_expr, package_id),
+                };
+                constant_key && self.is_constant(value.expr(), package_id)
+            }),
+            Expression::StringTemplate(string_template) => {
+                string_template.iter().all(|element| match element {
+                    Element::Literal(_) => true,
+                    Element::Interpolation(interpolation) => {
+                        self.is_constant(&interpolation.expr, package_id)
+                    }
+                    Element::Directive(_) => false,
+                })
+            }
+            Expression::FuncCall(function_call) => {
+                // std functions are pure, addon functions may reach out to the network or disk
+                let is_std = match function_call.name.namespace.first() {
+                    None => true,
+                    Some(namespace) => namespace.to_string() == "std",
+                };
+                is_std && function_call.args.iter().all(|arg| self.is_constant(arg, package_id))
+            }
+            Expression::BinaryOp(binary_op) => {
+                self.is_constant(&binary_op.lhs_expr, package_id)
+                    && self.is_constant(&binary_op.rhs_expr, package_id)
+            }
+            Expression::Traversal(_) => {
+                match self
+                    .runbook_workspace_context
+                    .try_resolve_construct_reference_in_expression(package_id, expr)
+                {
+                    Ok(Some((construct_did, _, _))) => self.fold_variable(&construct_did),
+                    _ => false,
+                }
+            }
+            _ => false,
+        }
+    }
+
+    /// Folds the `value` of a variable, returns false if the variable can change at runtime.
+    fn fold_variable(&mut self, construct_did: &ConstructDid) -> bool {
+        if self.folded_variables.get(construct_did).is_some() {
+            return true;
+        }
+        if !self.variables.contains(construct_did)
+            || !self.visited_variables.insert(construct_did.clone())
+        {
+            return false;
+        }
+        let runbook_execution_context = self.runbook_execution_context;
+        let Some(command_instance) =
+            runbook_execution_context.commands_instances.get(construct_did)
+        else {
+            return false;
+        };
+        // editable variables can be updated from the supervisor
+        match command_instance.get_expression_from_input("editable") {
+            None => {}
+            Some(Expression::Bool(editable)) if !*editable.value() => {}
+            Some(_) => return false,
+        }
+        let Some(expr) = command_instance.get_expression_from_input("value") else {
+            return false;
+        };
+        let Some(value) = self.fold_expression(&expr, &command_instance.package_id) else {
+            return false;
+        };
+        self.folded_variables
+            .insert(construct_did.clone(), Ok(CommandExecutionResult::from([("value", value)])));
+        true
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use txtx_addon_kit::types::types::Value;
+    use txtx_test_utils::test_harness::build_runbook_from_fixture;
+
+    use crate::tests::get_addon_by_namespace;
+
+    async fn folded_values(fixture: &str) -> Vec<(String, Option<Value>)> {
+        let runbook =
+            build_runbook_from_fixture("test.tx", fixture, get_addon_by_namespace).await.unwrap();
+        let execution_context = &runbook.flow_contexts[0].execution_context;
+        let mut folded_values = execution_context
+            .commands_instances
+            .iter()
+            .map(|(construct_did, command_instance)| {
+                let value = execution_context
+                    .constant_inputs
+                    .get(construct_did)
+                    .and_then(|inputs| inputs.get("value"))
+                    .cloned();
+                (command_instance.name.clone(), value)
+            })
+            .collect::<Vec<_>>();
+        folded_values.sort_by(|(a, _), (b, _)| a.cmp(b));
+        folded_values
+    }
+
+    #[tokio::test]
+    async fn it_folds_variables_chains() {
+        let folded_values = folded_values(include_str!("../tests/fixtures/sorting/4.tx")).await;
+        let expected = ('a'..='j')
+            .enumerate()
+            .map(|(i, name)| (name.to_string(), Some(Value::integer(i as i128 + 1))))
+            .collect::<Vec<_>>();
+        assert_eq!(folded_values, expected);
+    }
+
+    #[tokio::test]
+    async fn it_does_not_fold_references_to_editable_variables() {
+        let folded_values = folded_values(include_str!("../tests/fixtures/ab_c.tx")).await;
+        assert_eq!(
+            folded_values,
+            vec![
+                ("a".to_string(), Some(Value::integer(1))),
+                ("b".to_string(), Some(Value::integer(1))),
+                ("c".to_string(), None),
+            ]
+        );
+    }
+
+    #[tokio::test]
+    async fn it_does_not_fold_references_to_actions() {
+        let folded_values = folded_values(include_str!("../tests/fixtures/sorting/6.tx")).await;
+        let folded = folded_values
+            .into_iter()
+            .filter_map(|(name, value)| value.map(|_| name))
+            .collect::<Vec<_>>();
+        assert_eq!(folded, vec!["url".to_string()]);
+    }
+}
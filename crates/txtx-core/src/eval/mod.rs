@@ -11,6 +11,8 @@ use kit::types::commands::{
 use kit::types::types::ObjectDefinition;
 use std::collections::{BTreeMap, HashMap, HashSet};
 use std::fmt::Display;
+use std::sync::Arc;
+use std::time::Instant;
 use txtx_addon_kit::constants::{
     SIGNATURE_APPROVED, SIGNATURE_SKIPPABLE, SIGNED_MESSAGE_BYTES, SIGNED_TRANSACTION_BYTES,
     TX_HASH,
@@ -28,7 +30,7 @@ use txtx_addon_kit::types::frontend::{
     BlockEvent, ErrorPanelData, Panel,
 };
 use txtx_addon_kit::types::signers::SignersState;
-use txtx_addon_kit::types::stores::AddonDefaults;
+use txtx_addon_kit::types::stores::{AddonDefaults, ValueStore};
 use txtx_addon_kit::types::types::{ObjectProperty, RunbookSupervisionContext, Type};
 use txtx_addon_kit::types::{ConstructId, PackageId};
 use txtx_addon_kit::types::{EvaluatableInput, WithEvaluatableInputs};
@@ -48,6 +50,8 @@ use txtx_addon_kit::{
     uuid::Uuid,
 };
 
+pub mod constant_folding;
+
 // The flow for signer evaluation should be drastically different
 // Instead of activating all the signers detected in a graph, we should instead traverse the graph and collecting the signers
 // being used.
@@ -96,7 +100,8 @@ pub async fn run_signers_evaluation(
                 if let Some(evaluation_result) =
                     runbook_execution_context.commands_execution_results.get(&dependency)
                 {
-                    match cached_dependency_execution_results.merge(&dependency, &evaluation_result)
+                    match cached_dependency_execution_results
+                        .merge_borrowed(&dependency, evaluation_result)
                     {
                         Ok(_) => {}
                         Err(diag) => {
@@ -320,7 +325,7 @@ impl Display for EvaluationPassResult {
     }
 }
 
-fn should_skip_construct_evaluation(execution_result: &CommandExecutionResult) -> bool {
+pub(crate) fn should_skip_construct_evaluation(execution_result: &CommandExecutionResult) -> bool {
     // Check if the execution result indicates that the construct should be skipped
     let has_re_execute_command =
         execution_result.outputs.get(RE_EXECUTE_COMMAND).and_then(|v| v.as_bool()).unwrap_or(false);
@@ -403,8 +408,7 @@ pub async fn run_constructs_evaluation(
 
     for (signer_construct_did, _) in runbook_execution_context.signers_instances.iter() {
         let results = signers_results.get(signer_construct_did).unwrap();
-        genesis_dependency_execution_results
-            .insert(signer_construct_did.clone(), Ok(results.clone()));
+        genesis_dependency_execution_results.merge_borrowed(signer_construct_did, results).unwrap();
     }
 
     let ordered_constructs = runbook_execution_context.order_for_commands_execution.clone();
@@ -419,12 +423,9 @@ pub async fn run_constructs_evaluation(
         }
 
         if let Some(_) = unexecutable_nodes.get(&construct_did) {
-            if let Some(deps) = runbook_execution_context.commands_dependencies.get(&construct_did)
-            {
-                for dep in deps.iter() {
-                    unexecutable_nodes.insert(dep.clone());
-                }
-            }
+            runbook_execution_context
+                .commands_dependencies
+                .taint_dependents(&construct_did, &mut unexecutable_nodes);
             continue;
         }
 
@@ -433,7 +434,7 @@ pub async fn run_constructs_evaluation(
                 &construct_did,
                 &mut pass_result,
                 &mut unexecutable_nodes,
-                &mut genesis_dependency_execution_results,
+                &genesis_dependency_execution_results,
                 runbook_workspace_context,
                 runbook_execution_context,
                 runtime_context,
@@ -457,7 +458,7 @@ pub async fn run_constructs_evaluation(
                 &construct_did,
                 &mut pass_result,
                 &mut unexecutable_nodes,
-                &mut genesis_dependency_execution_results,
+                &genesis_dependency_execution_results,
                 runbook_workspace_context,
                 runbook_execution_context,
                 runtime_context,
@@ -478,6 +479,31 @@ pub async fn run_constructs_evaluation(
     pass_result
 }
 
+/// Layers, on top of `genesis`, the execution results of the constructs referenced by
+/// `references_expressions`. Results are borrowed from `commands_execution_results`.
+fn layer_dependencies_execution_results<'a>(
+    genesis: &'a DependencyExecutionResultCache<'a>,
+    references_expressions: &Vec<(Option<Box<dyn EvaluatableInput>>, Expression)>,
+    package_id: &PackageId,
+    runbook_workspace_context: &RunbookWorkspaceContext,
+    commands_execution_results: &'a HashMap<ConstructDid, CommandExecutionResult>,
+) -> DependencyExecutionResultCache<'a> {
+    let mut cached_dependency_execution_results =
+        DependencyExecutionResultCache::layered_on(genesis);
+    for (_input, expr) in references_expressions.iter() {
+        if let Some((dependency, _, _)) = runbook_workspace_context
+            .try_resolve_construct_reference_in_expression(package_id, expr)
+            .unwrap()
+        {
+            if let Some(evaluation_result) = commands_execution_results.get(&dependency) {
+                let _ = cached_dependency_execution_results
+                    .merge_borrowed(&dependency, evaluation_result);
+            }
+        }
+    }
+    cached_dependency_execution_results
+}
+
 pub enum LoopEvaluationResult {
     Continue,
     Bail,
@@ -487,7 +513,7 @@ pub async fn evaluate_command_instance(
     construct_did: &ConstructDid,
     pass_result: &mut EvaluationPassResult,
     unexecutable_nodes: &mut HashSet<ConstructDid>,
-    genesis_dependency_execution_results: &mut DependencyExecutionResultCache,
+    genesis_dependency_execution_results: &DependencyExecutionResultCache,
     runbook_workspace_context: &RunbookWorkspaceContext,
     runbook_execution_context: &mut RunbookExecutionContext,
     runtime_context: &RuntimeContext,
@@ -520,30 +546,21 @@ pub async fn evaluate_command_instance(
         .get(&construct_did.clone())
         .cloned();
 
-    let mut cached_dependency_execution_results = genesis_dependency_execution_results.clone();
-
     // Retrieve the construct_did of the inputs
     // Collect the outputs
     let references_expressions =
         command_instance.get_expressions_referencing_commands_from_inputs();
 
-    for (_input, expr) in references_expressions.into_iter() {
-        if let Some((dependency, _, _)) = runbook_workspace_context
-            .try_resolve_construct_reference_in_expression(&package_id, &expr)
-            .unwrap()
-        {
-            if let Some(evaluation_result) =
-                runbook_execution_context.commands_execution_results.get(&dependency)
-            {
-                match cached_dependency_execution_results.merge(&dependency, evaluation_result) {
-                    Ok(_) => {}
-                    Err(_) => continue,
-                }
-            }
-        }
-    }
+    let cached_dependency_execution_results = layer_dependencies_execution_results(
+        genesis_dependency_execution_results,
+        &references_expressions,
+        &package_id,
+        runbook_workspace_context,
+        &runbook_execution_context.commands_execution_results,
+    );
 
     let evaluated_inputs_res = perform_inputs_evaluation(
+        construct_did,
         command_instance,
         &cached_dependency_execution_results,
         &input_evaluation_results.as_ref(),
@@ -559,7 +576,9 @@ pub async fn evaluate_command_instance(
 
     let mut evaluated_inputs = match evaluated_inputs_res {
         Ok(result) => match result {
-            CommandInputEvaluationStatus::Complete(result) => result,
+            CommandInputEvaluationStatus::Complete(result) => {
+                result.scoped_to(&command_instance.name, construct_did)
+            }
             CommandInputEvaluationStatus::NeedsUserInteraction(_) => {
                 return LoopEvaluationResult::Continue;
             }
@@ -576,7 +595,8 @@ pub async fn evaluate_command_instance(
 
     let command_execution_result = {
         let Some(command_instance) =
-            runbook_execution_context.commands_instances.get_mut(&construct_did)
+            Arc::make_mut(&mut runbook_execution_context.commands_instances)
+                .get_mut(&construct_did)
         else {
             // runtime_context.addons.index_command_instance(namespace, package_did, block)
             return LoopEvaluationResult::Continue;
@@ -595,13 +615,9 @@ pub async fn evaluate_command_instance(
                     return LoopEvaluationResult::Bail;
                 }
                 PreConditionEvaluationResult::SkipDownstream => {
-                    if let Some(deps) =
-                        runbook_execution_context.commands_dependencies.get(&construct_did)
-                    {
-                        for dep in deps.iter() {
-                            unexecutable_nodes.insert(dep.clone());
-                        }
-                    }
+                    runbook_execution_context
+                        .commands_dependencies
+                        .taint_dependents(&construct_did, unexecutable_nodes);
                     return LoopEvaluationResult::Continue;
                 }
             },
@@ -701,13 +717,9 @@ pub async fn evaluate_command_instance(
                         if new_actions.has_pending_actions() {
                             pass_result.actions.append(&mut new_actions);
                             runbook_execution_context.signers_state = Some(updated_signers);
-                            if let Some(deps) =
-                                runbook_execution_context.commands_dependencies.get(&construct_did)
-                            {
-                                for dep in deps.iter() {
-                                    unexecutable_nodes.insert(dep.clone());
-                                }
-                            }
+                            runbook_execution_context
+                                .commands_dependencies
+                                .taint_dependents(&construct_did, unexecutable_nodes);
                             if force_sequential_signing {
                                 return LoopEvaluationResult::Bail;
                             } else {
@@ -756,13 +768,9 @@ pub async fn evaluate_command_instance(
                     }
                     Err((updated_signers, diag)) => {
                         runbook_execution_context.signers_state = Some(updated_signers);
-                        if let Some(deps) =
-                            runbook_execution_context.commands_dependencies.get(&construct_did)
-                        {
-                            for dep in deps.iter() {
-                                unexecutable_nodes.insert(dep.clone());
-                            }
-                        }
+                        runbook_execution_context
+                            .commands_dependencies
+                            .taint_dependents(&construct_did, unexecutable_nodes);
                         Err(diag)
                     }
                 };
@@ -781,13 +789,9 @@ pub async fn evaluate_command_instance(
                     Ok(mut new_actions) => {
                         if new_actions.has_pending_actions() {
                             pass_result.actions.append(&mut new_actions);
-                            if let Some(deps) =
-                                runbook_execution_context.commands_dependencies.get(&construct_did)
-                            {
-                                for dep in deps.iter() {
-                                    unexecutable_nodes.insert(dep.clone());
-                                }
-                            }
+                            runbook_execution_context
+                                .commands_dependencies
+                                .taint_dependents(&construct_did, unexecutable_nodes);
                             return LoopEvaluationResult::Continue;
                         }
                         pass_result.actions.append(&mut new_actions);
@@ -807,6 +811,7 @@ pub async fn evaluate_command_instance(
                     action_item_requests.get_mut(&construct_did).unwrap_or(&mut empty_vec);
                 let action_items_response = action_item_responses.get(&nested_construct_did);
 
+                let started_at = Instant::now();
                 let execution_result = {
                     command_instance
                         .perform_execution(
@@ -820,17 +825,15 @@ pub async fn evaluate_command_instance(
                         )
                         .await
                 };
+                runbook_execution_context
+                    .record_command_execution_duration(&construct_did, started_at.elapsed());
 
                 let execution_result = match execution_result {
                     Ok(result) => Ok(result),
                     Err(e) => {
-                        if let Some(deps) =
-                            runbook_execution_context.commands_dependencies.get(&construct_did)
-                        {
-                            for dep in deps.iter() {
-                                unexecutable_nodes.insert(dep.clone());
-                            }
-                        }
+                        runbook_execution_context
+                            .commands_dependencies
+                            .taint_dependents(&construct_did, unexecutable_nodes);
                         Err(e)
                     }
                 };
@@ -861,6 +864,7 @@ pub async fn evaluate_command_instance(
                     &pass_result.background_tasks_uuid,
                     supervision_context,
                     &runtime_context.cloud_service_context,
+                    &runtime_context.authorization_context,
                 );
                 let future = match future_res {
                     Ok(future) => future,
@@ -869,13 +873,9 @@ pub async fn evaluate_command_instance(
                         return LoopEvaluationResult::Bail;
                     }
                 };
-                if let Some(deps) =
-                    runbook_execution_context.commands_dependencies.get(&construct_did)
-                {
-                    for dep in deps.iter() {
-                        unexecutable_nodes.insert(dep.clone());
-                    }
-                }
+                runbook_execution_context
+                    .commands_dependencies
+                    .taint_dependents(&construct_did, unexecutable_nodes);
                 // if this construct has no execution results stored, and the construct is re-evaluated
                 // before this bg future we're pushing is awaited, we'll end up pushing this future twice.
                 // so we need to push some execution results, which will cue this loop to fix future evaluations
@@ -926,9 +926,20 @@ pub async fn evaluate_command_instance(
     let command_instance =
         runbook_execution_context.commands_instances.get(&construct_did).unwrap();
 
-    cached_dependency_execution_results.merge(construct_did, &command_execution_result).unwrap();
+    // the execution results were updated by the execution, the dependencies are layered again
+    let mut cached_dependency_execution_results = layer_dependencies_execution_results(
+        genesis_dependency_execution_results,
+        &references_expressions,
+        &package_id,
+        runbook_workspace_context,
+        &runbook_execution_context.commands_execution_results,
+    );
+    cached_dependency_execution_results
+        .merge_borrowed(construct_did, &command_execution_result)
+        .unwrap();
 
     let self_referencing_inputs = perform_inputs_evaluation(
+        construct_did,
         command_instance,
         &cached_dependency_execution_results,
         &input_evaluation_results.as_ref(),
@@ -944,7 +955,9 @@ pub async fn evaluate_command_instance(
 
     let mut self_referencing_inputs = match self_referencing_inputs {
         Ok(result) => match result {
-            CommandInputEvaluationStatus::Complete(result) => result,
+            CommandInputEvaluationStatus::Complete(result) => {
+                result.scoped_to(&command_instance.name, construct_did)
+            }
             CommandInputEvaluationStatus::NeedsUserInteraction(_) => {
                 return LoopEvaluationResult::Continue;
             }
@@ -980,26 +993,18 @@ pub async fn evaluate_command_instance(
                     return LoopEvaluationResult::Bail;
                 }
                 PostConditionEvaluationResult::SkipDownstream => {
-                    if let Some(deps) =
-                        runbook_execution_context.commands_dependencies.get(&construct_did)
-                    {
-                        for dep in deps.iter() {
-                            unexecutable_nodes.insert(dep.clone());
-                        }
-                    }
+                    runbook_execution_context
+                        .commands_dependencies
+                        .taint_dependents(&construct_did, unexecutable_nodes);
                     return LoopEvaluationResult::Continue;
                 }
                 PostConditionEvaluationResult::Retry(_) => {
                     // If the post condition requires a retry, we will not continue the execution of this command.
                     // We will return a Continue result to ensure that the next nested evaluation is not executed.
                     // Once the retry is completed, it will mark _this_ nested construct as completed and move to the next one.
-                    if let Some(deps) =
-                        runbook_execution_context.commands_dependencies.get(&construct_did)
-                    {
-                        for dep in deps.iter() {
-                            unexecutable_nodes.insert(dep.clone());
-                        }
-                    }
+                    runbook_execution_context
+                        .commands_dependencies
+                        .taint_dependents(&construct_did, unexecutable_nodes);
                     pass_result.nodes_to_re_execute.push(construct_did.clone());
                     return LoopEvaluationResult::Continue;
                 }
@@ -1014,6 +1019,7 @@ pub async fn evaluate_command_instance(
     runbook_execution_context
         .commands_execution_results
         .insert(construct_did.clone(), command_execution_result);
+    runbook_execution_context.record_command_snapshot(runbook_workspace_context, construct_did);
 
     if let RunbookExecutionMode::Partial(ref mut executed_constructs) =
         runbook_execution_context.execution_mode
@@ -1029,7 +1035,7 @@ pub async fn evaluate_embedded_runbook_instance(
     construct_did: &ConstructDid,
     pass_result: &mut EvaluationPassResult,
     unexecutable_nodes: &mut HashSet<ConstructDid>,
-    genesis_dependency_execution_results: &mut DependencyExecutionResultCache,
+    genesis_dependency_execution_results: &DependencyExecutionResultCache,
     runbook_workspace_context: &RunbookWorkspaceContext,
     runbook_execution_context: &mut RunbookExecutionContext,
     runtime_context: &RuntimeContext,
@@ -1051,30 +1057,21 @@ pub async fn evaluate_embedded_runbook_instance(
     let input_evaluation_results =
         runbook_execution_context.commands_inputs_evaluation_results.get(&construct_did.clone());
 
-    let mut cached_dependency_execution_results = genesis_dependency_execution_results.clone();
-
     // Retrieve the construct_did of the inputs
     // Collect the outputs
     let references_expressions =
         embedded_runbook.get_expressions_referencing_commands_from_inputs();
 
-    for (_input, expr) in references_expressions.into_iter() {
-        if let Some((dependency, _, _)) = runbook_workspace_context
-            .try_resolve_construct_reference_in_expression(&package_id, &expr)
-            .unwrap()
-        {
-            if let Some(evaluation_result) =
-                runbook_execution_context.commands_execution_results.get(&dependency)
-            {
-                match cached_dependency_execution_results.merge(&dependency, evaluation_result) {
-                    Ok(_) => {}
-                    Err(_) => continue,
-                }
-            }
-        }
-    }
+    let cached_dependency_execution_results = layer_dependencies_execution_results(
+        genesis_dependency_execution_results,
+        &references_expressions,
+        &package_id,
+        runbook_workspace_context,
+        &runbook_execution_context.commands_execution_results,
+    );
 
     let evaluated_inputs_res = perform_inputs_evaluation(
+        construct_did,
         embedded_runbook,
         &cached_dependency_execution_results,
         &input_evaluation_results,
@@ -1164,11 +1161,9 @@ pub async fn evaluate_embedded_runbook_instance(
     let has_pending_background_tasks = !pass_result.pending_background_tasks_futures.is_empty();
 
     if has_diags || has_pending_actions || has_pending_background_tasks {
-        if let Some(deps) = runbook_execution_context.commands_dependencies.get(&construct_did) {
-            for dep in deps.iter() {
-                unexecutable_nodes.insert(dep.clone());
-            }
-        }
+        runbook_execution_context
+            .commands_dependencies
+            .taint_dependents(&construct_did, unexecutable_nodes);
         return LoopEvaluationResult::Continue;
     } else {
         // loop over all of the results of executing this embedded runbook and merge them into the current runbook's context
@@ -1408,13 +1403,11 @@ pub fn eval_expression(
             };
 
             let res = match dependencies_execution_results.get(&dependency) {
-                Some(res) => match res.clone() {
-                    Ok(res) => res,
-                    Err(e) => return Ok(ExpressionEvaluationStatus::CompleteErr(e.clone())),
-                },
+                Some(Ok(res)) => res,
+                Some(Err(e)) => return Ok(ExpressionEvaluationStatus::CompleteErr(e.clone())),
                 None => match runbook_execution_context.commands_execution_results.get(&dependency)
                 {
-                    Some(res) => res.clone(),
+                    Some(res) => res,
                     None => return Ok(ExpressionEvaluationStatus::DependencyNotComputed),
                 },
             };
@@ -1653,6 +1646,7 @@ pub enum CommandInputEvaluationStatus {
 }
 
 pub fn perform_inputs_evaluation(
+    construct_did: &ConstructDid,
     with_evaluatable_inputs: &impl WithEvaluatableInputs,
     dependencies_execution_results: &DependencyExecutionResultCache,
     input_evaluation_results: &Option<&CommandInputsEvaluationResult>,
@@ -1668,9 +1662,14 @@ pub fn perform_inputs_evaluation(
     let mut has_existing_evaluation_results = true;
     let mut results = match *input_evaluation_results {
         Some(evaluated_inputs) => {
-            let mut inputs = evaluated_inputs.clone();
-            inputs.inputs = inputs.inputs.with_defaults(&addon_defaults.store);
-            inputs
+            // the previous defaults are replaced, only copy the inputs over
+            let previous = &evaluated_inputs.inputs;
+            CommandInputsEvaluationResult {
+                inputs: ValueStore::new(&previous.name, &previous.uuid)
+                    .with_defaults(&addon_defaults.store)
+                    .with_inputs(&previous.inputs),
+                unevaluated_inputs: evaluated_inputs.unevaluated_inputs.clone(),
+            }
         }
         None => {
             has_existing_evaluation_results = false;
@@ -1691,6 +1690,12 @@ pub fn perform_inputs_evaluation(
 
     let mut fatal_error = false;
 
+    // inputs folded when the runbook was built don't need to be evaluated again
+    let constant_inputs = match self_referencing_inputs {
+        true => None,
+        false => runbook_execution_context.constant_inputs.get(construct_did),
+    };
+
     match action_item_response {
         Some(responses) => {
             responses.into_iter().for_each(|ActionItemResponse { action_item_id: _, payload }| {
@@ -1725,6 +1730,10 @@ pub fn perform_inputs_evaluation(
                 continue;
             }
         }
+        if let Some(value) = constant_inputs.and_then(|inputs| inputs.get(&input_name)) {
+            results.insert(&input_name, value.clone());
+            continue;
+        }
         if let Some(object_def) = input.as_object() {
             // get this object expression to check if it's a traversal. if the expected
             // object type is a traversal, we should parse it as a regular field rather than
@@ -1987,7 +1996,7 @@ pub fn perform_inputs_evaluation(
             results.insert(&input_name, value);
         } else if let Some(_) = input.as_map() {
             match evaluate_map_input(
-                results.clone(),
+                &mut results,
                 &input,
                 with_evaluatable_inputs,
                 dependencies_execution_results,
@@ -2003,7 +2012,6 @@ pub fn perform_inputs_evaluation(
                     if res.require_user_interaction {
                         require_user_interaction = true;
                     }
-                    results = res.result;
                     diags.extend(res.diags);
                 }
                 Ok(None) => continue,
@@ -2279,7 +2287,6 @@ pub fn perform_signer_inputs_evaluation(
 
 #[derive(Clone, Debug)]
 struct EvaluateMapInputResult {
-    result: CommandInputsEvaluationResult,
     require_user_interaction: bool,
     diags: Vec<Diagnostic>,
     fatal_error: bool,
@@ -2288,7 +2295,7 @@ struct EvaluateMapInputResult {
 /// For other types, once we have an input block and an identifier in the block, we can expect that identifier to point to an "attribute".
 /// For a map, it could point to another block, so we need to recursively look inside maps.
 fn evaluate_map_input(
-    mut result: CommandInputsEvaluationResult,
+    result: &mut CommandInputsEvaluationResult,
     input_spec: &Box<dyn EvaluatableInput>,
     with_evaluatable_inputs: &impl WithEvaluatableInputs,
     dependencies_execution_results: &DependencyExecutionResultCache,
@@ -2341,7 +2348,6 @@ fn evaluate_map_input(
     result.insert(&input_name, Value::array(res.entries));
     result.unevaluated_inputs.merge(&res.unevaluated_inputs);
     Ok(Some(EvaluateMapInputResult {
-        result,
         require_user_interaction: res.require_user_interaction,
         diags: res.diags,
         fatal_error: res.fatal_error,
@@ -22,10 +22,12 @@ mod tests;
 pub mod utils;
 
 use ::std::collections::BTreeMap;
+use ::std::collections::VecDeque;
 use ::std::future::Future;
 use ::std::pin::Pin;
 use ::std::thread::sleep;
 use ::std::time::Duration;
+use ::std::time::Instant;
 
 use crate::runbook::flow_context::FlowContext;
 use constants::ACTION_ITEM_ENV;
@@ -40,6 +42,7 @@ use txtx_addon_kit::channel::Sender;
 use txtx_addon_kit::constants::ACTION_ITEM_CHECK_ADDRESS;
 use txtx_addon_kit::hcl::Span;
 use txtx_addon_kit::types::block_id::BlockId;
+use txtx_addon_kit::types::commands::CommandExecutionFuture;
 use txtx_addon_kit::types::commands::CommandExecutionResult;
 use txtx_addon_kit::types::diagnostics::Diagnostic;
 use txtx_addon_kit::types::frontend::ActionItemRequest;
@@ -205,12 +208,19 @@ pub async fn start_supervised_runbook_runloop(
     let mut validated_blocks = 0;
     let total_flows_count = runbook.flow_contexts.len();
     let mut current_flow_index: usize = 0;
+    // responses received but not processed yet: responses submitted in a burst are drained
+    // together, and applied with a single evaluation pass
+    let mut queued_responses: VecDeque<ActionItemResponse> = VecDeque::new();
+    let mut responses_channel_closed = false;
     loop {
-        let event_opt = match action_item_responses_rx.try_recv() {
-            Ok(action) => Some(action),
-            Err(TryRecvError::Empty) | Err(TryRecvError::Lagged(_)) => None,
-            Err(TryRecvError::Closed) => return Ok(()),
-        };
+        while !responses_channel_closed {
+            match action_item_responses_rx.try_recv() {
+                Ok(action) => queued_responses.push_back(action),
+                Err(TryRecvError::Empty) => break,
+                Err(TryRecvError::Lagged(_)) => continue,
+                Err(TryRecvError::Closed) => responses_channel_closed = true,
+            }
+        }
 
         if intialized_flow_index != current_flow_index as i16 {
             intialized_flow_index = current_flow_index as i16;
@@ -243,12 +253,41 @@ pub async fn start_supervised_runbook_runloop(
             flow_action_item_requests.get_mut(&current_flow_index).unwrap();
 
         // Cooldown
-        let Some(action_item_response) = event_opt else {
+        let Some(action_item_response) = queued_responses.pop_front() else {
+            if responses_channel_closed {
+                return Ok(());
+            }
             sleep(Duration::from_millis(50));
             continue;
         };
         let ActionItemResponse { action_item_id, payload } = action_item_response.clone();
 
+        // environment changes and block validations are processed on their own, the other
+        // responses queued before the next of these are applied together
+        let is_batchable = |response: &ActionItemResponse| {
+            response.action_item_id != SET_ENV_ACTION.id
+                && !matches!(response.payload, ActionItemResponseType::ValidateBlock)
+        };
+        if is_batchable(&action_item_response) {
+            let mut batch = vec![action_item_response];
+            while queued_responses.front().map(is_batchable).unwrap_or(false) {
+                batch.push(queued_responses.pop_front().unwrap());
+            }
+            process_action_item_responses_batch(
+                runbook,
+                &block_tx,
+                batch,
+                &mut action_item_requests,
+                action_item_responses,
+                current_flow_index,
+                &background_tasks_handle_uuid,
+                &mut background_tasks_futures,
+                &mut background_tasks_contructs_dids,
+            )
+            .await?;
+            continue;
+        }
+
         if action_item_id == SET_ENV_ACTION.id {
             if let Err(diags) = reset_runbook_execution(
                 runbook,
@@ -283,7 +322,6 @@ pub async fn start_supervised_runbook_runloop(
         }
 
         match &payload {
-            ActionItemResponseType::ValidateModal => {}
             ActionItemResponseType::ValidateBlock => {
                 // Keep track of whether we've initialized this bg uuid to avoid sending more updates
                 // for this action item than necessary
@@ -430,8 +468,44 @@ pub async fn start_supervised_runbook_runloop(
                     }
                 }
             }
-            ActionItemResponseType::PickInputOption(_) => {}
-            ActionItemResponseType::ProvideInput(_) => {}
+            _ => unreachable!("batchable responses are processed in batches"),
+        };
+    }
+}
+
+/// Applies a batch of action item responses: the statuses of the reviewed inputs are updated,
+/// then the signers and the constructs awaiting these responses are evaluated once for the
+/// whole batch, instead of once per response.
+async fn process_action_item_responses_batch(
+    runbook: &mut Runbook,
+    block_tx: &Sender<BlockEvent>,
+    batch: Vec<ActionItemResponse>,
+    action_item_requests: &mut BTreeMap<BlockId, ActionItemRequest>,
+    action_item_responses: &mut BTreeMap<ConstructDid, Vec<ActionItemResponse>>,
+    current_flow_index: usize,
+    background_tasks_handle_uuid: &Uuid,
+    background_tasks_futures: &mut Vec<CommandExecutionFuture>,
+    background_tasks_contructs_dids: &mut Vec<(ConstructDid, ConstructDid)>,
+) -> Result<(), Vec<Diagnostic>> {
+    let mut signers_action_item_ids = vec![];
+    let mut signing_action_item_ids = vec![];
+    let mut force_execution_requested = false;
+    let mut status_updates = vec![];
+
+    for action_item_response in batch.into_iter() {
+        let ActionItemResponse { action_item_id, payload } = action_item_response.clone();
+
+        if let Some(action_item) = action_item_requests.get(&action_item_id) {
+            if let Some(construct_did) = action_item.construct_did.clone() {
+                action_item_responses.entry(construct_did).or_default().push(action_item_response);
+            }
+        }
+
+        match &payload {
+            ActionItemResponseType::ValidateModal
+            | ActionItemResponseType::ValidateBlock
+            | ActionItemResponseType::PickInputOption(_)
+            | ActionItemResponseType::ProvideInput(_) => {}
             ActionItemResponseType::ReviewInput(ReviewedInputResponse {
                 value_checked,
                 force_execution,
@@ -445,7 +519,7 @@ pub async fn start_supervised_runbook_runloop(
                     .set_status(new_status)
                     .normalize(&action_item_requests)
                 {
-                    let _ = block_tx.send(BlockEvent::UpdateActionItems(vec![update]));
+                    status_updates.push(update);
                 }
                 // Some signers do not actually need the user to provide the address/pubkey,
                 // but they need to confirm it in the supervisor. when it is confirmed, we need to
@@ -454,125 +528,80 @@ pub async fn start_supervised_runbook_runloop(
                     if request.internal_key == ACTION_ITEM_CHECK_ADDRESS
                         || request.internal_key == ACTION_ITEM_CHECK_BALANCE
                     {
-                        process_signers_action_item_response(
-                            runbook,
-                            &block_tx,
-                            &action_item_id,
-                            &mut action_item_requests,
-                            &action_item_responses,
-                            current_flow_index,
-                        )
-                        .await;
-                    }
-                }
-
-                if *force_execution {
-                    let running_context =
-                        runbook.flow_contexts.get_mut(current_flow_index).unwrap();
-                    let mut pass_results = run_constructs_evaluation(
-                        &background_tasks_handle_uuid,
-                        &running_context.workspace_context,
-                        &mut running_context.execution_context,
-                        &mut runbook.runtime_context,
-                        &runbook.supervision_context,
-                        &mut BTreeMap::new(),
-                        &action_item_responses,
-                        &block_tx.clone(),
-                    )
-                    .await;
-                    let mut updated_actions = vec![];
-                    for action in pass_results
-                        .actions
-                        .compile_actions_to_item_updates(&action_item_requests)
-                        .into_iter()
-                    {
-                        updated_actions.push(action.normalize(&action_item_requests).unwrap())
-                    }
-                    let _ = block_tx.send(BlockEvent::UpdateActionItems(updated_actions));
-
-                    if !pass_results.pending_background_tasks_constructs_uuids.is_empty() {
-                        background_tasks_futures
-                            .append(&mut pass_results.pending_background_tasks_futures);
-                        background_tasks_contructs_dids
-                            .append(&mut pass_results.pending_background_tasks_constructs_uuids);
-                    }
-
-                    if pass_results.has_diagnostics() {
-                        pass_results.fill_diagnostic_span(&runbook.sources);
-                    }
-                    if let Some(error_event) = pass_results.compile_diagnostics_to_block() {
-                        let _ = block_tx.send(BlockEvent::Error(error_event));
-                        return Err(pass_results.with_spans_filled(&runbook.sources));
+                        signers_action_item_ids.push(action_item_id.clone());
                     }
                 }
+                force_execution_requested |= *force_execution;
             }
             ActionItemResponseType::ProvidePublicKey(_response) => {
-                process_signers_action_item_response(
-                    runbook,
-                    &block_tx,
-                    &action_item_id,
-                    &mut action_item_requests,
-                    &action_item_responses,
-                    current_flow_index,
-                )
-                .await;
+                signers_action_item_ids.push(action_item_id.clone());
             }
             ActionItemResponseType::VerifyThirdPartySignature(_)
             | ActionItemResponseType::ProvideSignedTransaction(_)
             | ActionItemResponseType::SendTransaction(_)
             | ActionItemResponseType::ProvideSignedMessage(_) => {
-                // Retrieve the previous requests sent and update their statuses.
-                let Some((signing_action_construct_did, scoped_requests)) =
-                    retrieve_related_action_items_requests(
-                        &action_item_id,
-                        &mut action_item_requests,
-                    )
-                else {
-                    continue;
-                };
-                let mut map: BTreeMap<ConstructDid, _> = BTreeMap::new();
-                map.insert(signing_action_construct_did, scoped_requests);
-
-                let running_context = runbook.flow_contexts.get_mut(current_flow_index).unwrap();
-                let mut pass_results = run_constructs_evaluation(
-                    &background_tasks_handle_uuid,
-                    &running_context.workspace_context,
-                    &mut running_context.execution_context,
-                    &mut runbook.runtime_context,
-                    &runbook.supervision_context,
-                    &mut map,
-                    &action_item_responses,
-                    &block_tx.clone(),
-                )
-                .await;
+                signing_action_item_ids.push(action_item_id.clone());
+            }
+        }
+    }
 
-                let mut updated_actions = vec![];
-                for action in pass_results
-                    .actions
-                    .compile_actions_to_item_updates(&action_item_requests)
-                    .into_iter()
-                {
-                    updated_actions.push(action.normalize(&action_item_requests).unwrap())
-                }
+    if !status_updates.is_empty() {
+        let _ = block_tx.send(BlockEvent::UpdateActionItems(status_updates));
+    }
 
-                let _ = block_tx.send(BlockEvent::UpdateActionItems(updated_actions));
+    if !signers_action_item_ids.is_empty() {
+        process_signers_action_item_response(
+            runbook,
+            &block_tx,
+            &signers_action_item_ids,
+            action_item_requests,
+            &action_item_responses,
+            current_flow_index,
+        )
+        .await;
+    }
 
-                if !pass_results.pending_background_tasks_constructs_uuids.is_empty() {
-                    background_tasks_futures
-                        .append(&mut pass_results.pending_background_tasks_futures);
-                    background_tasks_contructs_dids
-                        .append(&mut pass_results.pending_background_tasks_constructs_uuids);
-                }
-                if pass_results.has_diagnostics() {
-                    pass_results.fill_diagnostic_span(&runbook.sources);
-                }
-                if let Some(error_event) = pass_results.compile_diagnostics_to_block() {
-                    let _ = block_tx.send(BlockEvent::Error(error_event));
-                    return Err(pass_results.with_spans_filled(&runbook.sources));
-                }
-            }
-        };
+    // Retrieve the previous requests sent and update their statuses.
+    let mut map =
+        retrieve_related_action_items_requests(&signing_action_item_ids, action_item_requests);
+    if map.is_empty() && !force_execution_requested {
+        return Ok(());
     }
+
+    let running_context = runbook.flow_contexts.get_mut(current_flow_index).unwrap();
+    let mut pass_results = run_constructs_evaluation(
+        background_tasks_handle_uuid,
+        &running_context.workspace_context,
+        &mut running_context.execution_context,
+        &mut runbook.runtime_context,
+        &runbook.supervision_context,
+        &mut map,
+        &action_item_responses,
+        &block_tx.clone(),
+    )
+    .await;
+
+    let mut updated_actions = vec![];
+    for action in
+        pass_results.actions.compile_actions_to_item_updates(&action_item_requests).into_iter()
+    {
+        updated_actions.push(action.normalize(&action_item_requests).unwrap())
+    }
+    let _ = block_tx.send(BlockEvent::UpdateActionItems(updated_actions));
+
+    if !pass_results.pending_background_tasks_constructs_uuids.is_empty() {
+        background_tasks_futures.append(&mut pass_results.pending_background_tasks_futures);
+        background_tasks_contructs_dids
+            .append(&mut pass_results.pending_background_tasks_constructs_uuids);
+    }
+    if pass_results.has_diagnostics() {
+        pass_results.fill_diagnostic_span(&runbook.sources);
+    }
+    if let Some(error_event) = pass_results.compile_diagnostics_to_block() {
+        let _ = block_tx.send(BlockEvent::Error(error_event));
+        return Err(pass_results.with_spans_filled(&runbook.sources));
+    }
+    Ok(())
 }
 
 pub fn register_action_items_from_actions(
@@ -584,29 +613,36 @@ pub fn register_action_items_from_actions(
     }
 }
 
+/// Retrieves the requests of the constructs related to the action items, so that their
+/// statuses can be updated.
 pub fn retrieve_related_action_items_requests<'a>(
-    action_item_id: &BlockId,
+    action_item_ids: &[BlockId],
     action_item_requests: &'a mut BTreeMap<BlockId, ActionItemRequest>,
-) -> Option<(ConstructDid, Vec<&'a mut ActionItemRequest>)> {
-    let Some(signer_construct_did) =
-        action_item_requests.get(&action_item_id).and_then(|a| a.construct_did.clone())
-    else {
-        eprintln!("unable to retrieve {}", action_item_id);
-        // todo: log error
-        return None;
-    };
-    // // Retrieve the previous requests sent
-    // // and update their statuses.
-    let mut scoped_requests = vec![];
+) -> BTreeMap<ConstructDid, Vec<&'a mut ActionItemRequest>> {
+    let mut construct_dids = vec![];
+    for action_item_id in action_item_ids.iter() {
+        match action_item_requests.get(action_item_id).and_then(|a| a.construct_did.clone()) {
+            Some(construct_did) => construct_dids.push(construct_did),
+            None => {
+                eprintln!("unable to retrieve {}", action_item_id);
+                // todo: log error
+            }
+        }
+    }
+    let mut scoped_requests: BTreeMap<ConstructDid, Vec<&'a mut ActionItemRequest>> =
+        BTreeMap::new();
+    if construct_dids.is_empty() {
+        return scoped_requests;
+    }
     for (_, request) in action_item_requests.iter_mut() {
         let Some(ref construct_did) = request.construct_did else {
             continue;
         };
-        if construct_did.eq(&signer_construct_did) {
-            scoped_requests.push(request);
+        if construct_dids.contains(construct_did) {
+            scoped_requests.entry(construct_did.clone()).or_default().push(request);
         }
     }
-    Some((signer_construct_did, scoped_requests))
+    scoped_requests
 }
 
 pub async fn reset_runbook_execution(
@@ -776,23 +812,38 @@ pub async fn process_background_tasks(
             }]));
     }
 
-    let results: Vec<Result<CommandExecutionResult, Diagnostic>> =
-        txtx_addon_kit::futures::future::join_all(background_tasks_futures).await;
-    for ((nested_construct_did, construct_did), result) in
+    let results: Vec<(Result<CommandExecutionResult, Diagnostic>, Duration)> =
+        txtx_addon_kit::futures::future::join_all(background_tasks_futures.into_iter().map(
+            |future| async move {
+                let started_at = Instant::now();
+                let result = future.await;
+                (result, started_at.elapsed())
+            },
+        ))
+        .await;
+    for ((nested_construct_did, construct_did), (result, duration)) in
         background_tasks_contructs_dids.into_iter().zip(results)
     {
+        flow_context.execution_context.record_command_execution_duration(&construct_did, duration);
         match result {
             Ok(result) => {
                 flow_context
                     .execution_context
                     .append_commands_execution_result(&nested_construct_did, &result);
+                // commands with nested executions are evaluated again once their last background
+                // task completed, and snapshotted then; the other ones are skipped from now on
+                if nested_construct_did == construct_did {
+                    flow_context
+                        .execution_context
+                        .record_command_snapshot(&flow_context.workspace_context, &construct_did);
+                }
             }
             Err(mut diag) => {
                 let construct_id =
                     flow_context.workspace_context.expect_construct_id(&construct_did);
                 diag = diag.location(&construct_id.construct_location);
                 if let Some(command_instance) =
-                    flow_context.execution_context.commands_instances.get_mut(&construct_did)
+                    flow_context.execution_context.commands_instances.get(&construct_did)
                 {
                     diag = diag.set_span_range(command_instance.block.span());
                 };
@@ -815,23 +866,20 @@ pub async fn process_background_tasks(
     Ok(())
 }
 
+/// Evaluates the signers related to the action items, once for all of them.
 pub async fn process_signers_action_item_response(
     runbook: &mut Runbook,
     block_tx: &Sender<BlockEvent>,
-    action_item_id: &BlockId,
+    action_item_ids: &[BlockId],
     action_item_requests: &mut BTreeMap<BlockId, ActionItemRequest>,
     action_item_responses: &BTreeMap<ConstructDid, Vec<ActionItemResponse>>,
     current_flow_index: usize,
 ) {
     // Retrieve the previous requests sent and update their statuses.
-    let Some((signer_construct_did, scoped_requests)) =
-        retrieve_related_action_items_requests(&action_item_id, action_item_requests)
-    else {
+    let mut map = retrieve_related_action_items_requests(action_item_ids, action_item_requests);
+    if map.is_empty() {
         return;
-    };
-
-    let mut map = BTreeMap::new();
-    map.insert(signer_construct_did, scoped_requests);
+    }
 
     let flow_context = runbook.flow_contexts.get_mut(current_flow_index).unwrap();
     let mut pass_result = run_signers_evaluation(
@@ -0,0 +1,206 @@
+use std::collections::{HashMap, HashSet};
+
+use txtx_addon_kit::types::ConstructDid;
+
+const WORD_BITS: usize = u64::BITS as usize;
+
+/// Transitive dependents of the executable constructs (commands and embedded runbooks).
+///
+/// Constructs are given dense indices, and the dependents of each executable construct are
+/// kept as a bitset over these indices: the index takes `V²/8` bytes where a list of
+/// dependents per construct takes up to `32·V²` bytes, and is computed in a single reverse
+/// pass over the topological order instead of one graph traversal per construct.
+#[derive(Debug, Clone, Default)]
+pub struct ConstructsDependencies {
+    /// Constructs, by dense index
+    constructs: Vec<ConstructDid>,
+    /// Row of the executable constructs in `dependents`
+    rows: HashMap<ConstructDid, usize>,
+    /// One bitset of `words` words per executable construct
+    dependents: Vec<u64>,
+    words: usize,
+}
+
+impl ConstructsDependencies {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Computes the transitive closure of a graph.
+    ///
+    /// `constructs` are indexed by their position, `children[i]` holds the indices of the
+    /// constructs directly depending on `constructs[i]`, and `topological_order` lists every
+    /// index, dependencies first. Only the rows of the `executable` constructs are retained.
+    pub fn from_graph<'a>(
+        constructs: Vec<ConstructDid>,
+        children: &Vec<Vec<usize>>,
+        topological_order: &Vec<usize>,
+        executable: impl Iterator<Item = &'a ConstructDid>,
+    ) -> Self {
+        let words = constructs.len().div_ceil(WORD_BITS);
+        let mut closure = vec![0u64; constructs.len() * words];
+        for &node in topological_order.iter().rev() {
+            for &child in children[node].iter() {
+                closure[node * words + child / WORD_BITS] |= 1 << (child % WORD_BITS);
+                for word in 0..words {
+                    closure[node * words + word] |= closure[child * words + word];
+                }
+            }
+        }
+
+        let indices = constructs
+            .iter()
+            .enumerate()
+            .map(|(index, construct_did)| (construct_did, index))
+            .collect::<HashMap<_, _>>();
+        let mut rows = HashMap::new();
+        let mut dependents = vec![];
+        for construct_did in executable {
+            let Some(&index) = indices.get(construct_did) else {
+                continue;
+            };
+            if rows.contains_key(construct_did) {
+                continue;
+            }
+            rows.insert(construct_did.clone(), rows.len());
+            dependents.extend_from_slice(&closure[index * words..(index + 1) * words]);
+        }
+        Self { constructs, rows, dependents, words }
+    }
+
+    /// Builds the index from lists of dependents, as published with embedded runbooks.
+    pub fn from_map(dependencies: &HashMap<ConstructDid, Vec<ConstructDid>>) -> Self {
+        let mut indices = HashMap::new();
+        let mut constructs = vec![];
+        for construct_did in
+            dependencies.iter().flat_map(|(c, deps)| Some(c).into_iter().chain(deps))
+        {
+            if !indices.contains_key(construct_did) {
+                indices.insert(construct_did.clone(), constructs.len());
+                constructs.push(construct_did.clone());
+            }
+        }
+        let words = constructs.len().div_ceil(WORD_BITS);
+        let mut rows = HashMap::new();
+        let mut dependents = vec![0u64; dependencies.len() * words];
+        for (row, (construct_did, deps)) in dependencies.iter().enumerate() {
+            rows.insert(construct_did.clone(), row);
+            for dep in deps.iter() {
+                let index = indices[dep];
+                dependents[row * words + index / WORD_BITS] |= 1 << (index % WORD_BITS);
+            }
+        }
+        Self { constructs, rows, dependents, words }
+    }
+
+    /// Returns the lists of dependents, as published with embedded runbooks.
+    pub fn to_map(&self) -> HashMap<ConstructDid, Vec<ConstructDid>> {
+        self.rows
+            .keys()
+            .map(|construct_did| {
+                (
+                    construct_did.clone(),
+                    self.dependents_of(construct_did).unwrap().cloned().collect(),
+                )
+            })
+            .collect()
+    }
+
+    /// Returns the constructs depending, directly or not, on `construct_did`, or `None` if
+    /// `construct_did` is not an executable construct.
+    pub fn dependents_of(
+        &self,
+        construct_did: &ConstructDid,
+    ) -> Option<impl Iterator<Item = &ConstructDid> + '_> {
+        let row = *self.rows.get(construct_did)?;
+        let bitset = &self.dependents[row * self.words..(row + 1) * self.words];
+        Some(bitset.iter().enumerate().flat_map(move |(word_index, word)| {
+            let mut word = *word;
+            std::iter::from_fn(move || {
+                if word == 0 {
+                    return None;
+                }
+                let bit = word.trailing_zeros() as usize;
+                word &= word - 1;
+                Some(&self.constructs[word_index * WORD_BITS + bit])
+            })
+        }))
+    }
+
+    /// Marks the dependents of `construct_did` as unexecutable.
+    pub fn taint_dependents(
+        &self,
+        construct_did: &ConstructDid,
+        unexecutable_nodes: &mut HashSet<ConstructDid>,
+    ) {
+        if let Some(dependents) = self.dependents_of(construct_did) {
+            for dependent in dependents {
+                unexecutable_nodes.insert(dependent.clone());
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::collections::HashSet;
+
+    use txtx_addon_kit::types::{ConstructDid, Did};
+
+    use super::ConstructsDependencies;
+
+    fn did(i: u8) -> ConstructDid {
+        ConstructDid(Did::from_hex_string(&format!("{:064x}", i)))
+    }
+
+    fn sorted(dependents: Option<impl Iterator<Item = ConstructDid>>) -> Vec<ConstructDid> {
+        let mut dependents = dependents.unwrap().collect::<Vec<_>>();
+        dependents.sort();
+        dependents
+    }
+
+    #[test]
+    fn it_computes_transitive_dependents() {
+        // 0 -> 1 -> 2 -> 3, 0 -> 4, and 70 constructs depending on 4 to span several words
+        let constructs = (0..75).map(did).collect::<Vec<_>>();
+        let mut children = vec![vec![]; 75];
+        children[0] = vec![1, 4];
+        children[1] = vec![2];
+        children[2] = vec![3];
+        children[4] = (5..75).collect();
+        let topological_order = (0..75).collect::<Vec<_>>();
+        let executable = vec![did(0), did(1), did(4)];
+        let dependencies = ConstructsDependencies::from_graph(
+            constructs,
+            &children,
+            &topological_order,
+            executable.iter(),
+        );
+
+        assert_eq!(sorted(dependencies.dependents_of(&did(0)).map(|d| d.cloned())).len(), 74);
+        assert_eq!(
+            sorted(dependencies.dependents_of(&did(1)).map(|d| d.cloned())),
+            vec![did(2), did(3)]
+        );
+        assert_eq!(
+            sorted(dependencies.dependents_of(&did(4)).map(|d| d.cloned())),
+            (5..75).map(did).collect::<Vec<_>>()
+        );
+        // only executable constructs are indexed
+        assert!(dependencies.dependents_of(&did(2)).is_none());
+
+        let mut unexecutable_nodes = HashSet::new();
+        dependencies.taint_dependents(&did(1), &mut unexecutable_nodes);
+        assert_eq!(unexecutable_nodes, HashSet::from([did(2), did(3)]));
+
+        let map = dependencies.to_map();
+        let from_map = ConstructsDependencies::from_map(&map);
+        for construct_did in map.keys() {
+            assert_eq!(
+                sorted(from_map.dependents_of(construct_did).map(|d| d.cloned())),
+                sorted(Some(map[construct_did].iter().cloned()))
+            );
+        }
+        assert_eq!(from_map.to_map().len(), 3);
+    }
+}
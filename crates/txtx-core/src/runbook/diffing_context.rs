@@ -1,18 +1,21 @@
-use super::{FlowContext, RunbookExecutionMode, RunbookTopLevelInputsMap};
+use super::{
+    FlowContext, RunbookExecutionContext, RunbookExecutionMode, RunbookTopLevelInputsMap,
+    RunbookWorkspaceContext,
+};
 use kit::types::types::ObjectDefinition;
 use serde::{Deserialize, Serialize};
 use serde_json::json;
 use similar::{capture_diff_slices, Algorithm, ChangeTag, DiffOp, TextDiff};
 use std::{
-    collections::HashSet,
+    collections::{HashMap, HashSet},
     time::{SystemTime, UNIX_EPOCH},
 };
 use txtx_addon_kit::{
     helpers::fs::FileLocation,
     indexmap::IndexMap,
     types::{
-        diagnostics::Diagnostic, types::Value, ConstructDid, Did, PackageDid, RunbookId,
-        WithEvaluatableInputs,
+        commands::CommandInputsEvaluationResult, diagnostics::Diagnostic, types::Value,
+        ConstructDid, Did, PackageDid, RunbookId, WithEvaluatableInputs,
     },
 };
 
@@ -48,6 +51,18 @@ pub struct RunbookFlowSnapshot {
     pub commands: IndexMap<ConstructDid, CommandSnapshot>,
 }
 
+impl RunbookFlowSnapshot {
+    /// Returns the recorded execution durations of the commands, in milliseconds.
+    pub fn commands_execution_durations(&self) -> HashMap<ConstructDid, u64> {
+        self.commands
+            .iter()
+            .filter_map(|(construct_did, command)| {
+                command.execution_duration_ms.map(|duration| (construct_did.clone(), duration))
+            })
+            .collect()
+    }
+}
+
 impl RunbookExecutionSnapshot {
     pub fn new(runbook_id: &RunbookId, top_level_inputs_map: &RunbookTopLevelInputsMap) -> Self {
         let ended_at = now_as_string();
@@ -96,6 +111,219 @@ pub struct CommandSnapshot {
     pub inputs: IndexMap<String, CommandInputSnapshot>,
     pub outputs: IndexMap<String, CommandOutputSnapshot>,
     executed: bool,
+    /// Time spent executing the command, in milliseconds
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub execution_duration_ms: Option<u64>,
+}
+
+impl CommandSnapshot {
+    /// Builds the snapshot of a command from the current state of the execution context.
+    pub fn from_execution_context(
+        construct_did: &ConstructDid,
+        workspace_context: &RunbookWorkspaceContext,
+        execution_context: &RunbookExecutionContext,
+    ) -> Result<Option<Self>, Diagnostic> {
+        let inputs_evaluations =
+            execution_context.commands_inputs_evaluation_results.get(construct_did);
+        Self::build(construct_did, workspace_context, execution_context, |input_name| {
+            inputs_evaluations.and_then(|r| r.inputs.get_value(input_name)).cloned()
+        })
+    }
+
+    /// Builds the snapshot of a command whose evaluated inputs are being released, moving the
+    /// input values into the snapshot instead of cloning them.
+    pub fn from_released_inputs(
+        construct_did: &ConstructDid,
+        workspace_context: &RunbookWorkspaceContext,
+        execution_context: &RunbookExecutionContext,
+        mut inputs_evaluations: CommandInputsEvaluationResult,
+    ) -> Result<Option<Self>, Diagnostic> {
+        Self::build(construct_did, workspace_context, execution_context, |input_name| {
+            inputs_evaluations
+                .inputs
+                .inputs
+                .store
+                .swap_remove(input_name)
+                .or_else(|| inputs_evaluations.inputs.defaults.get_value(input_name).cloned())
+        })
+    }
+
+    /// Arrays are snapshotted as maps, and can't hold anything but objects.
+    pub fn can_snapshot_input_value(value: &Value) -> bool {
+        match value {
+            Value::Array(entries) => entries.iter().all(|entry| entry.as_object().is_some()),
+            _ => true,
+        }
+    }
+
+    fn build<F>(
+        construct_did: &ConstructDid,
+        workspace_context: &RunbookWorkspaceContext,
+        execution_context: &RunbookExecutionContext,
+        mut take_input_value: F,
+    ) -> Result<Option<Self>, Diagnostic>
+    where
+        F: FnMut(&str) -> Option<Value>,
+    {
+        let Some(command_instance) = execution_context.commands_instances.get(construct_did) else {
+            return Ok(None);
+        };
+
+        let construct_id = workspace_context.constructs.get(construct_did).unwrap();
+
+        let mut upstream_constructs_dids = vec![];
+        if let Some(deps) =
+            execution_context.signed_commands_upstream_dependencies.get(construct_did)
+        {
+            for construct_did in deps.iter() {
+                if workspace_context.constructs.get(construct_did).is_some() {
+                    upstream_constructs_dids.push(construct_did.clone());
+                }
+            }
+        }
+
+        let executed = execution_context.commands_execution_results.get(construct_did).is_some();
+
+        let mut command = CommandSnapshot {
+            package_did: command_instance.package_id.did(),
+            construct_type: construct_id.construct_type.clone(),
+            construct_name: construct_id.construct_name.clone(),
+            construct_location: construct_id.construct_location.clone(),
+            construct_addon: None,
+            upstream_constructs_dids,
+            inputs: IndexMap::new(),
+            outputs: IndexMap::new(),
+            executed,
+            execution_duration_ms: None,
+        };
+        let command_to_update = &mut command;
+
+        if let Some(duration) = execution_context.commands_execution_durations.get(construct_did) {
+            command_to_update.execution_duration_ms = Some(duration.as_millis() as u64);
+        }
+
+        let mut sorted_inputs = command_instance.specification.inputs.clone();
+        sorted_inputs.sort_by(|a, b| a.name.cmp(&b.name));
+        for input in sorted_inputs.iter() {
+            if input.sensitive {
+                continue;
+            }
+            let Some(value) = take_input_value(&input.name) else {
+                continue;
+            };
+            let critical = execution_context
+                .construct_did_is_signed_or_signed_upstream(construct_did)
+                && input.tainting;
+
+            let value_pre_evaluation = command_instance
+                .get_expression_from_input(&input.name)
+                .map(|expr| expr.to_string().trim().to_string());
+
+            // an object property is critical if the input is critical and the property is tainting
+            let property_critical = |property: &str| match input.as_object() {
+                Some(ObjectDefinition::Strict(props)) => props
+                    .iter()
+                    .find(|p| p.name.eq(property))
+                    .map(|p| critical && p.tainting)
+                    .unwrap_or(false),
+                Some(ObjectDefinition::Arbitrary(_)) => false,
+                Some(ObjectDefinition::Tuple(_)) | Some(ObjectDefinition::Enum(_)) => {
+                    unimplemented!("ObjectDefinition::Tuple and ObjectDefinition::Enum are not supported for runbook types");
+                }
+                None => critical,
+            };
+
+            // If the value is an object, we need to keep track of the criticality of each property
+            let value_post_evaluation = match value {
+                Value::Object(map) => ValuePostEvaluation::ObjectValue(
+                    map.into_iter()
+                        .map(|(k, v)| {
+                            let critical = property_critical(&k);
+                            (k, (v, critical))
+                        })
+                        .collect(),
+                ),
+                Value::Array(entries) => {
+                    let mut map_value = Vec::new();
+                    for entry in (*entries).into_iter() {
+                        let Value::Object(map) = entry else {
+                            return Err("found map entry that is not an object".into());
+                        };
+                        map_value.push(
+                            map.into_iter()
+                                .map(|(k, v)| {
+                                    let critical = property_critical(&k);
+                                    (k, (v, critical))
+                                })
+                                .collect(),
+                        );
+                    }
+                    ValuePostEvaluation::MapValue(map_value)
+                }
+                value => ValuePostEvaluation::Value(value),
+            };
+
+            command_to_update.inputs.insert(
+                input.name.clone(),
+                CommandInputSnapshot { value_pre_evaluation, value_post_evaluation, critical },
+            );
+        }
+
+        if let Some(ref critical_output) = command_instance.specification.create_critical_output {
+            if let Some(outputs_results) =
+                execution_context.commands_execution_results.get(construct_did)
+            {
+                let mut sorted_outputs = command_instance.specification.outputs.clone();
+                sorted_outputs.sort_by(|a, b| a.name.cmp(&b.name));
+                command_to_update.executed = true;
+
+                for output in sorted_outputs {
+                    let Some(value) = outputs_results.outputs.get(&output.name) else {
+                        continue;
+                    };
+                    // This is a major shortcut, we should revisit this approach
+                    let value = match value.as_object().map(|o| o.get(critical_output)) {
+                        Some(Some(value)) => value.clone(),
+                        Some(None) => Value::null(),
+                        None => value.clone(),
+                    };
+                    let output_name = &output.name;
+                    match command_to_update.outputs.get_mut(output_name) {
+                        Some(output_to_update) => {
+                            output_to_update.value = value.clone();
+                            output_to_update.signed = false;
+                        }
+                        None => {
+                            command_to_update.outputs.insert(
+                                output_name.clone(),
+                                CommandOutputSnapshot { value: value.clone(), signed: false },
+                            );
+                        }
+                    }
+                }
+            } else {
+                command_to_update.executed = false;
+            }
+        }
+
+        Ok(Some(command))
+    }
+
+    /// Updates the snapshot of a command from a previous execution with a new snapshot.
+    fn update_with(&mut self, command_snapshot: CommandSnapshot, update_execution_status: bool) {
+        for (input_name, input) in command_snapshot.inputs.into_iter() {
+            self.inputs.insert(input_name, input);
+        }
+        for (output_name, output) in command_snapshot.outputs.into_iter() {
+            self.outputs.insert(output_name, output);
+        }
+        if update_execution_status {
+            self.executed = command_snapshot.executed;
+        }
+        if command_snapshot.execution_duration_ms.is_some() {
+            self.execution_duration_ms = command_snapshot.execution_duration_ms;
+        }
+    }
 }
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -161,7 +389,7 @@ impl RunbookSnapshotContext {
 
         let mut snapshot = RunbookExecutionSnapshot::new(&runbook_id, top_level_inputs_map);
 
-        let mut flow_contexts = flow_contexts.clone();
+        let mut flow_contexts = flow_contexts.iter().collect::<Vec<_>>();
         flow_contexts.sort_by(|a, b| a.name.cmp(&b.name));
 
         for flow_context in flow_contexts.iter() {
@@ -295,6 +523,8 @@ impl RunbookSnapshotContext {
                 }
             }
 
+            let constructs_ids_to_consider =
+                constructs_ids_to_consider.into_iter().collect::<HashSet<_>>();
             for construct_did in flow_context.execution_context.order_for_commands_execution.iter()
             {
                 if !constructs_ids_to_consider.is_empty()
@@ -302,208 +532,42 @@ impl RunbookSnapshotContext {
                 {
                     continue;
                 }
-
-                let command_instance =
-                    match flow_context.execution_context.commands_instances.get(&construct_did) {
-                        Some(entry) => entry,
-                        None => {
-                            continue;
-                        }
-                    };
-
-                let construct_id =
-                    flow_context.workspace_context.constructs.get(construct_did).unwrap();
-
-                let mut upstream_constructs_dids = vec![];
-                if let Some(deps) = flow_context
-                    .execution_context
-                    .signed_commands_upstream_dependencies
-                    .get(construct_did)
-                {
-                    for construct_did in deps.iter() {
-                        if flow_context.workspace_context.constructs.get(construct_did).is_some() {
-                            upstream_constructs_dids.push(construct_did.clone());
-                        }
-                    }
-                }
-
-                let executed = flow_context
-                    .execution_context
-                    .commands_execution_results
-                    .get(construct_did)
-                    .is_some();
-
-                let command_to_update = match flow_snapshot.commands.get_mut(construct_did) {
-                    Some(snapshot) => snapshot,
-                    None => {
-                        let new_command = CommandSnapshot {
-                            package_did: command_instance.package_id.did(),
-                            construct_type: construct_id.construct_type.clone(),
-                            construct_name: construct_id.construct_name.clone(),
-                            construct_location: construct_id.construct_location.clone(),
-                            construct_addon: None,
-                            upstream_constructs_dids,
-                            inputs: IndexMap::new(),
-                            outputs: IndexMap::new(),
-                            executed,
-                        };
-                        flow_snapshot.commands.insert(construct_did.clone(), new_command);
-                        flow_snapshot.commands.get_mut(construct_did).unwrap()
-                    }
+                let Some(command_instance) =
+                    flow_context.execution_context.commands_instances.get(construct_did)
+                else {
+                    continue;
                 };
 
-                if let Some(inputs_evaluations) = flow_context
+                // commands still holding the results they were snapshotted with on completion
+                // are reused as is
+                let recorded_snapshot = if flow_context
                     .execution_context
-                    .commands_inputs_evaluation_results
-                    .get(construct_did)
+                    .commands_execution_results
+                    .contains_key(construct_did)
                 {
-                    let mut sorted_inputs = command_instance.specification.inputs.clone();
-                    sorted_inputs.sort_by(|a, b| a.name.cmp(&b.name));
-                    for input in sorted_inputs.iter() {
-                        let Some(value) = inputs_evaluations.inputs.get_value(&input.name) else {
-                            continue;
-                        };
-                        if input.sensitive {
-                            continue;
-                        }
-                        let critical = flow_context
-                            .execution_context
-                            .construct_did_is_signed_or_signed_upstream(construct_did)
-                            && input.tainting;
-
-                        let value_pre_evaluation = command_instance
-                            .get_expression_from_input(&input.name)
-                            .map(|expr| expr.to_string().trim().to_string());
-                        let input_name = &input.name;
-
-                        // If the value is an object, we need to keep track of the criticality of each property
-                        let value_post_evaluation = match value.as_object() {
-                            Some(map) => {
-                                let mut object = IndexMap::new();
-                                for (k, v) in map.iter() {
-                                    // an object property is critical if the input is critical
-                                    // and the property is tainting
-                                    let object_prop_critical = match input.as_object() {
-                                        Some(object_def) => match object_def {
-                                            ObjectDefinition::Strict(props) => props
-                                                .iter()
-                                                .find(|p| p.name.eq(k))
-                                                .map(|p| critical && p.tainting)
-                                                .unwrap_or(false),
-                                            ObjectDefinition::Arbitrary(_) => false,
-                                            ObjectDefinition::Tuple(_)
-                                            | ObjectDefinition::Enum(_) => {
-                                                unimplemented!("ObjectDefinition::Tuple and ObjectDefinition::Enum are not supported for runbook types");
-                                            }
-                                        },
-
-                                        None => critical,
-                                    };
-                                    object.insert(k.clone(), (v.clone(), object_prop_critical));
-                                }
-                                ValuePostEvaluation::ObjectValue(object)
-                            }
-                            None => {
-                                match value.as_map() {
-                                    Some(entries) => {
-                                        let mut map_value = Vec::new();
-                                        for entry in entries.iter() {
-                                            let map = entry
-                                                .as_object()
-                                                .ok_or("found map entry that is not an object")?;
-                                            let mut object = IndexMap::new();
-                                            for (k, v) in map.iter() {
-                                                // an object property is critical if the input is critical
-                                                // and the property is tainting
-                                                let object_prop_critical = match input.as_object() {
-                                                    Some(object_def) => match object_def {
-                                                        ObjectDefinition::Strict(props) => props
-                                                            .iter()
-                                                            .find(|p| p.name.eq(k))
-                                                            .map(|p| critical && p.tainting)
-                                                            .unwrap_or(false),
-                                                        ObjectDefinition::Arbitrary(_) => false,
-                                                        ObjectDefinition::Tuple(_)
-                                                        | ObjectDefinition::Enum(_) => {
-                                                            unimplemented!("ObjectDefinition::Tuple and ObjectDefinition::Enum are not supported for runbook types");
-                                                        }
-                                                    },
-
-                                                    None => critical,
-                                                };
-                                                object.insert(
-                                                    k.clone(),
-                                                    (v.clone(), object_prop_critical),
-                                                );
-                                            }
-                                            map_value.push(object);
-                                        }
-                                        ValuePostEvaluation::MapValue(map_value)
-                                    }
-                                    None => ValuePostEvaluation::Value(value.clone()),
-                                }
-                            }
-                        };
-
-                        match command_to_update.inputs.get_mut(input_name) {
-                            Some(input) => {
-                                input.value_pre_evaluation = value_pre_evaluation;
-                                input.value_post_evaluation = value_post_evaluation.clone();
-                                input.critical = critical;
-                            }
-                            None => {
-                                command_to_update.inputs.insert(
-                                    input_name.clone(),
-                                    CommandInputSnapshot {
-                                        value_pre_evaluation,
-                                        value_post_evaluation: value_post_evaluation.clone(),
-                                        critical,
-                                    },
-                                );
-                            }
-                        }
-                    }
-                }
+                    flow_context.execution_context.get_recorded_command_snapshot(construct_did)?
+                } else {
+                    None
+                };
+                let command_snapshot = match recorded_snapshot {
+                    Some(command_snapshot) => command_snapshot,
+                    None => match CommandSnapshot::from_execution_context(
+                        construct_did,
+                        &flow_context.workspace_context,
+                        &flow_context.execution_context,
+                    )? {
+                        Some(command_snapshot) => command_snapshot,
+                        None => continue,
+                    },
+                };
 
-                if let Some(ref critical_output) =
-                    command_instance.specification.create_critical_output
-                {
-                    if let Some(outputs_results) =
-                        flow_context.execution_context.commands_execution_results.get(construct_did)
-                    {
-                        let mut sorted_outputs = command_instance.specification.outputs.clone();
-                        sorted_outputs.sort_by(|a, b| a.name.cmp(&b.name));
-                        command_to_update.executed = true;
-
-                        for output in sorted_outputs {
-                            let Some(value) = outputs_results.outputs.get(&output.name) else {
-                                continue;
-                            };
-                            // This is a major shortcut, we should revisit this approach
-                            let value = match value.as_object().map(|o| o.get(critical_output)) {
-                                Some(Some(value)) => value.clone(),
-                                Some(None) => Value::null(),
-                                None => value.clone(),
-                            };
-                            let output_name = &output.name;
-                            match command_to_update.outputs.get_mut(output_name) {
-                                Some(output_to_update) => {
-                                    output_to_update.value = value.clone();
-                                    output_to_update.signed = false;
-                                }
-                                None => {
-                                    command_to_update.outputs.insert(
-                                        output_name.clone(),
-                                        CommandOutputSnapshot {
-                                            value: value.clone(),
-                                            signed: false,
-                                        },
-                                    );
-                                }
-                            }
-                        }
-                    } else {
-                        command_to_update.executed = false;
+                match flow_snapshot.commands.get_mut(construct_did) {
+                    Some(previous_snapshot) => previous_snapshot.update_with(
+                        command_snapshot,
+                        command_instance.specification.create_critical_output.is_some(),
+                    ),
+                    None => {
+                        flow_snapshot.commands.insert(construct_did.clone(), command_snapshot);
                     }
                 }
             }
@@ -3,20 +3,22 @@ pub mod publishable;
 use publishable::PublishableEmbeddedRunbookSpecification;
 use std::collections::HashMap;
 use std::str::FromStr;
+use std::sync::Arc;
 use txtx_addon_kit::hcl::structure::Block;
 use txtx_addon_kit::helpers::fs::FileLocation;
 use txtx_addon_kit::types::commands::DependencyExecutionResultCache;
 use txtx_addon_kit::types::diagnostics::Diagnostic;
 use txtx_addon_kit::types::embedded_runbooks::EmbeddedRunbookStatefulExecutionContext;
 use txtx_addon_kit::types::stores::ValueStore;
-use txtx_addon_kit::types::PackageId;
 use txtx_addon_kit::types::{
     commands::CommandExecutionResult, embedded_runbooks::EmbeddedRunbookInstance,
 };
+use txtx_addon_kit::types::{Did, PackageId};
 
 use super::runtime_context::AddonsContext;
 use super::{
-    RunbookExecutionContext, RunbookExecutionMode, RunbookWorkspaceContext, RuntimeContext,
+    ConstructsDependencies, InputsRetentionPolicy, RunbookExecutionContext, RunbookExecutionMode,
+    RunbookWorkspaceContext, RuntimeContext, SpilledSnapshotsValues,
 };
 
 /// Combines the [EmbeddedRunbookInstance] with the [EmbeddingRunbookContext] to create an executable runbook instance
@@ -95,11 +97,15 @@ impl EmbeddingRunbookContext {
             signers_state: signers_context.signers_state.clone(),
             commands_execution_results: HashMap::new(),
             commands_inputs_evaluation_results: HashMap::new(),
-            commands_dependencies: runbook_instance
-                .specification
-                .static_execution_context
-                .commands_dependencies
-                .clone(),
+            // the evaluated inputs are merged into the embedding runbook once executed
+            inputs_retention_policy: InputsRetentionPolicy::RetainAll,
+            commands_snapshots: HashMap::new(),
+            spilled_snapshots_values: SpilledSnapshotsValues::new(),
+            commands_execution_durations: HashMap::new(),
+            constant_inputs: Arc::new(HashMap::new()),
+            commands_dependencies: Arc::new(ConstructsDependencies::from_map(
+                &runbook_instance.specification.static_execution_context.commands_dependencies,
+            )),
             signers_downstream_dependencies,
             signed_commands_upstream_dependencies: runbook_instance
                 .specification
@@ -228,18 +234,26 @@ impl EmbeddedRunbookInstanceBuilder {
             Diagnostic::error_from_string(format!("error reading embedded runbook content: {}", e))
         })?;
 
-        let publishable_runbook_instance_specification = serde_json::from_slice::<
-            PublishableEmbeddedRunbookSpecification,
-        >(&bytes)
-        .map_err(|e| {
-            Diagnostic::error_from_string(format!(
-                "error deserializing embedded runbook instance: {}",
-                e
-            ))
-        })?;
+        // runbooks instantiating the same embedded runbook many times parse it once
+        let content_hash = Did::from_components([&bytes]);
+        if let Some(spec) = addons_context.embedded_runbooks_specifications.get(&content_hash) {
+            let spec = spec.as_ref().clone();
+            return Ok(EmbeddedRunbookInstance::new(
+                embedded_runbook_name,
+                block,
+                package_id,
+                spec,
+            ));
+        }
+
+        let publishable_runbook_instance_specification =
+            PublishableEmbeddedRunbookSpecification::from_slice(&bytes)?;
 
         let spec = publishable_runbook_instance_specification
             .into_embedded_runbook_instance_specification(addons_context)?;
+        addons_context
+            .embedded_runbooks_specifications
+            .insert(content_hash, Arc::new(spec.clone()));
 
         Ok(EmbeddedRunbookInstance::new(embedded_runbook_name, block, package_id, spec))
     }
@@ -280,8 +294,8 @@ mod tests {
         "#;
         let my_var_name = "my_var";
         let my_output_name = "my_output";
-        let my_var_id = ConstructDid(Did::from_components(vec![my_var_name.as_bytes()]));
-        let my_output_id = ConstructDid(Did::from_components(vec![my_output_name.as_bytes()]));
+        let my_var_id = ConstructDid(Did::from_components([my_var_name.as_bytes()]));
+        let my_output_id = ConstructDid(Did::from_components([my_output_name.as_bytes()]));
 
         let package_id = PackageId {
             runbook_id: RunbookId::zero(),
@@ -326,6 +340,7 @@ mod tests {
         };
 
         let inst = PublishableEmbeddedRunbookSpecification {
+            format_version: PUBLISHABLE_FORMAT_VERSION,
             runbook_id: RunbookId::zero(),
             description: None,
             inputs: vec![EmbeddedRunbookInputSpecification::Value(
@@ -364,4 +379,26 @@ mod tests {
         let str = serde_json::to_string_pretty(&inst).unwrap();
         println!("{}", str);
     }
+
+    #[test]
+    fn newer_format_versions_are_rejected_before_deserialization() {
+        // layout of a future version, that this version can't deserialize
+        let published = serde_json::json!({
+            "format_version": PUBLISHABLE_FORMAT_VERSION + 1,
+            "runbook_id": { "name": "future" },
+        });
+        let bytes = serde_json::to_vec(&published).unwrap();
+        let diag = PublishableEmbeddedRunbookSpecification::from_slice(&bytes).unwrap_err();
+        assert!(diag.message.contains(&format!(
+            "format version {}, this version of txtx supports up to version {}",
+            PUBLISHABLE_FORMAT_VERSION + 1,
+            PUBLISHABLE_FORMAT_VERSION
+        )));
+
+        // specifications published before the format was versioned reach deserialization
+        let published = serde_json::json!({ "runbook_id": { "name": "unversioned" } });
+        let bytes = serde_json::to_vec(&published).unwrap();
+        let diag = PublishableEmbeddedRunbookSpecification::from_slice(&bytes).unwrap_err();
+        assert!(diag.message.starts_with("error deserializing embedded runbook instance"));
+    }
 }
@@ -1,6 +1,7 @@
 use serde::{Deserialize, Serialize};
 use serde_with::serde_as;
 use std::collections::{HashMap, HashSet};
+use std::sync::Arc;
 use txtx_addon_kit::helpers::hcl::RawHclContent;
 use txtx_addon_kit::types::commands::{CommandInstance, CommandInstanceType};
 use txtx_addon_kit::types::diagnostics::Diagnostic;
@@ -18,8 +19,29 @@ use crate::std::commands;
 use crate::types::Runbook;
 use txtx_addon_kit::types::package::Package;
 
+/// Version of the publishable format, bumped on changes that previous versions of txtx can't
+/// read. Specifications published before the format was versioned are version 1. Unknown fields
+/// are ignored when deserializing, so adding a field does not require a bump.
+pub const PUBLISHABLE_FORMAT_VERSION: u32 = 1;
+
+fn unversioned_format() -> u32 {
+    1
+}
+
+fn check_format_version(format_version: u32) -> Result<(), Diagnostic> {
+    if format_version > PUBLISHABLE_FORMAT_VERSION {
+        return Err(Diagnostic::error_from_string(format!(
+            "embedded runbook published with format version {}, this version of txtx supports up to version {}: upgrade txtx to use it",
+            format_version, PUBLISHABLE_FORMAT_VERSION
+        )));
+    }
+    Ok(())
+}
+
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct PublishableEmbeddedRunbookSpecification {
+    #[serde(default = "unversioned_format")]
+    pub format_version: u32,
     pub runbook_id: RunbookId,
     pub description: Option<String>,
     pub inputs: Vec<EmbeddedRunbookInputSpecification>,
@@ -28,18 +50,49 @@ pub struct PublishableEmbeddedRunbookSpecification {
 }
 
 impl PublishableEmbeddedRunbookSpecification {
+    /// Deserializes a published specification, checking its format version first: a layout from
+    /// a newer version would otherwise fail deserialization with an unrelated error. The bytes are
+    /// parsed once, the version is read from the parsed document.
+    pub fn from_slice(bytes: &[u8]) -> Result<Self, Diagnostic> {
+        let document: serde_json::Value = serde_json::from_slice(bytes).map_err(|e| {
+            Diagnostic::error_from_string(format!(
+                "error deserializing embedded runbook instance: {}",
+                e
+            ))
+        })?;
+        let format_version = match document.get("format_version") {
+            None => unversioned_format(),
+            Some(value) => value.as_u64().and_then(|v| u32::try_from(v).ok()).ok_or_else(|| {
+                Diagnostic::error_from_string(format!(
+                    "error deserializing embedded runbook instance: invalid format version {}",
+                    value
+                ))
+            })?,
+        };
+        check_format_version(format_version)?;
+        serde_json::from_value(document).map_err(|e| {
+            Diagnostic::error_from_string(format!(
+                "error deserializing embedded runbook instance: {}",
+                e
+            ))
+        })
+    }
+
     pub fn into_embedded_runbook_instance_specification(
         self,
         addons_context: &mut AddonsContext,
     ) -> Result<EmbeddedRunbookInstanceSpecification, Diagnostic> {
+        check_format_version(self.format_version)?;
         Ok(EmbeddedRunbookInstanceSpecification {
             runbook_id: self.runbook_id,
             description: self.description,
             inputs: self.inputs,
-            static_execution_context: self
-                .static_execution_context
-                .into_static_execution_context(addons_context)?,
-            static_workspace_context: self.static_workspace_context.into_workspace_context(),
+            static_execution_context: Arc::new(
+                self.static_execution_context.into_static_execution_context(addons_context)?,
+            ),
+            static_workspace_context: Arc::new(
+                self.static_workspace_context.into_workspace_context(),
+            ),
         })
     }
 
@@ -47,6 +100,7 @@ impl PublishableEmbeddedRunbookSpecification {
         specification: &EmbeddedRunbookInstanceSpecification,
     ) -> Self {
         Self {
+            format_version: PUBLISHABLE_FORMAT_VERSION,
             runbook_id: specification.runbook_id.clone(),
             description: specification.description.clone(),
             inputs: specification.inputs.clone(),
@@ -147,6 +201,7 @@ impl PublishableEmbeddedRunbookSpecification {
         embedded_runbook_input_specifications.append(&mut signer_inputs);
 
         Ok(Self {
+            format_version: PUBLISHABLE_FORMAT_VERSION,
             runbook_id: runbook.runbook_id.clone(),
             description: runbook.description.clone(),
             inputs: embedded_runbook_input_specifications,
@@ -161,7 +216,10 @@ impl PublishableEmbeddedRunbookSpecification {
                     .collect(),
                 embedded_runbooks: publishable_embedded_runbook_instances,
                 commands_instances: publishable_commands_instances,
-                commands_dependencies: flow_context.execution_context.commands_dependencies.clone(),
+                commands_dependencies: flow_context
+                    .execution_context
+                    .commands_dependencies
+                    .to_map(),
                 signers_downstream_dependencies: publishable_signers_downstream_dependencies,
                 signed_commands_upstream_dependencies: flow_context
                     .execution_context
@@ -230,7 +288,7 @@ impl PublishableExecutionContext {
         Ok(EmbeddedRunbookStaticExecutionContext {
             addon_instances,
             embedded_runbooks,
-            commands_instances,
+            commands_instances: Arc::new(commands_instances),
             commands_dependencies: self.commands_dependencies,
             signers_downstream_dependencies: self.signers_downstream_dependencies,
             signed_commands_upstream_dependencies: self.signed_commands_upstream_dependencies,
@@ -405,17 +463,17 @@ impl PublishableCommandInstance {
         })?;
         let command_instance = match self.typing {
             CommandInstanceType::Variable => CommandInstance {
-                specification: commands::new_variable_specification(),
+                specification: Arc::new(commands::new_variable_specification()),
                 name: self.name.clone(),
-                block: block.clone(),
+                block: Arc::new(block.clone()),
                 package_id: self.package_id.clone(),
                 namespace: self.namespace.clone(),
                 typing: CommandInstanceType::Variable,
             },
             CommandInstanceType::Output => CommandInstance {
-                specification: commands::new_output_specification(),
+                specification: Arc::new(commands::new_output_specification()),
                 name: self.name.clone(),
-                block: block.clone(),
+                block: Arc::new(block.clone()),
                 package_id: self.package_id.clone(),
                 namespace: self.namespace.clone(),
                 typing: CommandInstanceType::Output,
@@ -448,9 +506,9 @@ impl PublishableCommandInstance {
             }
             CommandInstanceType::Prompt => todo!(),
             CommandInstanceType::Module => CommandInstance {
-                specification: commands::new_module_specification(),
+                specification: Arc::new(commands::new_module_specification()),
                 name: self.name.clone(),
-                block: block.clone(),
+                block: Arc::new(block.clone()),
                 package_id: self.package_id.clone(),
                 namespace: self.namespace.clone(),
                 typing: CommandInstanceType::Module,
@@ -4,6 +4,8 @@ use kit::types::frontend::DisplayErrorLogRequest;
 use kit::types::AuthorizationContext;
 use std::collections::HashMap;
 use std::collections::HashSet;
+use std::sync::Arc;
+use std::time::Duration;
 use txtx_addon_kit::channel::unbounded;
 use txtx_addon_kit::channel::Sender;
 use txtx_addon_kit::hcl::Span;
@@ -31,12 +33,16 @@ use txtx_addon_kit::types::EvaluatableInput;
 use txtx_addon_kit::uuid::Uuid;
 
 use crate::eval::perform_inputs_evaluation;
+use crate::eval::should_skip_construct_evaluation;
 use crate::eval::CommandInputEvaluationStatus;
 use crate::eval::EvaluationPassResult;
 use crate::eval::LoopEvaluationResult;
 
+use super::diffing_context::CommandSnapshot;
 use super::diffing_context::RunbookFlowSnapshot;
 use super::diffing_context::ValuePostEvaluation;
+use super::snapshot_spill::SpilledSnapshotsValues;
+use super::ConstructsDependencies;
 use super::RunbookWorkspaceContext;
 use super::RuntimeContext;
 
@@ -47,7 +53,7 @@ pub struct RunbookExecutionContext {
     /// Map of embedded runbooks
     pub embedded_runbooks: HashMap<ConstructDid, EmbeddedRunbookInstance>,
     /// Map of executable commands (input, output, action)
-    pub commands_instances: HashMap<ConstructDid, CommandInstance>,
+    pub commands_instances: Arc<HashMap<ConstructDid, CommandInstance>>,
     /// Map of signing commands (signer)
     pub signers_instances: HashMap<ConstructDid, SignerInstance>,
     /// State of the signing commands states (stateful)
@@ -56,8 +62,18 @@ pub struct RunbookExecutionContext {
     pub commands_execution_results: HashMap<ConstructDid, CommandExecutionResult>,
     /// Results of commands inputs evaluation
     pub commands_inputs_evaluation_results: HashMap<ConstructDid, CommandInputsEvaluationResult>,
+    /// What is kept of the evaluated inputs of the commands once they completed
+    pub inputs_retention_policy: InputsRetentionPolicy,
+    /// Snapshots of the commands, taken as they complete
+    pub commands_snapshots: HashMap<ConstructDid, CommandSnapshot>,
+    /// Large inputs of the commands snapshots, spilled to disk once their evaluation was released
+    pub spilled_snapshots_values: SpilledSnapshotsValues,
+    /// Time spent executing commands, background tasks included
+    pub commands_execution_durations: HashMap<ConstructDid, Duration>,
+    /// Commands inputs folded to a constant value when the runbook was built
+    pub constant_inputs: Arc<HashMap<ConstructDid, HashMap<String, Value>>>,
     /// Constructs depending on a given Construct.
-    pub commands_dependencies: HashMap<ConstructDid, Vec<ConstructDid>>,
+    pub commands_dependencies: Arc<ConstructsDependencies>,
     /// Constructs depending on a given Construct performing signing.
     pub signers_downstream_dependencies: Vec<(ConstructDid, Vec<ConstructDid>)>,
     /// Constructs depending on a given Construct being signed.
@@ -72,6 +88,18 @@ pub struct RunbookExecutionContext {
     pub execution_mode: RunbookExecutionMode,
 }
 
+/// Evaluated inputs can hold large values (program binaries, init code, ...) that are moved into
+/// the snapshot of the command once it completed, and are not read afterwards.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum InputsRetentionPolicy {
+    /// Evaluated inputs are kept for the whole run
+    RetainAll,
+    /// Evaluated inputs of completed commands are moved into their snapshot, the largest ones being
+    /// spilled to disk
+    #[default]
+    ReleaseCompleted,
+}
+
 #[derive(Clone, Debug, PartialEq, Eq)]
 pub enum RunbookExecutionMode {
     Ignored,
@@ -85,12 +113,17 @@ impl RunbookExecutionContext {
         Self {
             addon_instances: HashMap::new(),
             embedded_runbooks: HashMap::new(),
-            commands_instances: HashMap::new(),
+            commands_instances: Arc::new(HashMap::new()),
             signers_instances: HashMap::new(),
             signers_state: Some(SignersState::new()),
             commands_execution_results: HashMap::new(),
             commands_inputs_evaluation_results: HashMap::new(),
-            commands_dependencies: HashMap::new(),
+            inputs_retention_policy: InputsRetentionPolicy::default(),
+            commands_snapshots: HashMap::new(),
+            spilled_snapshots_values: SpilledSnapshotsValues::new(),
+            commands_execution_durations: HashMap::new(),
+            constant_inputs: Arc::new(HashMap::new()),
+            commands_dependencies: Arc::new(ConstructsDependencies::new()),
             signers_downstream_dependencies: vec![],
             signed_commands_upstream_dependencies: HashMap::new(),
             signed_commands: HashSet::new(),
@@ -322,7 +355,8 @@ impl RunbookExecutionContext {
                 continue;
             };
 
-            match cached_dependency_execution_results.merge(&dependency, evaluation_result) {
+            match cached_dependency_execution_results.merge_borrowed(&dependency, evaluation_result)
+            {
                 Ok(_) => (),
                 Err(_) => {
                     continue;
@@ -332,6 +366,7 @@ impl RunbookExecutionContext {
 
         // After this evaluation, commands should be able to tweak / override
         let evaluated_inputs_res = perform_inputs_evaluation(
+            construct_did,
             command_instance,
             &cached_dependency_execution_results,
             &input_evaluation_results,
@@ -363,11 +398,7 @@ impl RunbookExecutionContext {
 
         // Did we reach the frontier?
         if constructs_dids_frontier.contains(&construct_did) {
-            if let Some(deps) = self.commands_dependencies.get(&construct_did) {
-                for dep in deps.iter() {
-                    unexecutable_nodes.insert(dep.clone());
-                }
-            }
+            self.commands_dependencies.taint_dependents(&construct_did, unexecutable_nodes);
             return LoopEvaluationResult::Continue;
         }
 
@@ -385,7 +416,9 @@ impl RunbookExecutionContext {
             };
 
         // This time, we borrow a mutable reference
-        let Some(command_instance) = self.commands_instances.get_mut(&construct_did) else {
+        let Some(command_instance) =
+            Arc::make_mut(&mut self.commands_instances).get_mut(&construct_did)
+        else {
             return LoopEvaluationResult::Continue;
         };
 
@@ -405,11 +438,8 @@ impl RunbookExecutionContext {
             ) {
                 Ok(new_actions) => {
                     if new_actions.has_pending_actions() {
-                        if let Some(deps) = self.commands_dependencies.get(&construct_did) {
-                            for dep in deps.iter() {
-                                unexecutable_nodes.insert(dep.clone());
-                            }
-                        }
+                        self.commands_dependencies
+                            .taint_dependents(&construct_did, unexecutable_nodes);
                         return LoopEvaluationResult::Continue;
                     }
                 }
@@ -438,11 +468,7 @@ impl RunbookExecutionContext {
             let execution_result = match execution_result {
                 Ok(result) => Ok(result),
                 Err(e) => {
-                    if let Some(deps) = self.commands_dependencies.get(&construct_did) {
-                        for dep in deps.iter() {
-                            unexecutable_nodes.insert(dep.clone());
-                        }
-                    }
+                    self.commands_dependencies.taint_dependents(&construct_did, unexecutable_nodes);
                     Err(e)
                 }
             };
@@ -526,7 +552,8 @@ impl RunbookExecutionContext {
                 continue;
             };
 
-            match cached_dependency_execution_results.merge(&dependency, evaluation_result) {
+            match cached_dependency_execution_results.merge_borrowed(&dependency, evaluation_result)
+            {
                 Ok(_) => (),
                 Err(_) => continue,
             };
@@ -534,6 +561,7 @@ impl RunbookExecutionContext {
 
         // After this evaluation, commands should be able to tweak / override
         let evaluated_inputs_res = perform_inputs_evaluation(
+            construct_did,
             embedded_runbook,
             &cached_dependency_execution_results,
             &input_evaluation_results,
@@ -612,6 +640,7 @@ impl RunbookExecutionContext {
         let addon_defaults = workspace_context.get_addon_defaults(&addon_context_key);
 
         let evaluated_inputs_res = perform_inputs_evaluation(
+            construct_did,
             command_instance,
             &cached_dependency_execution_results,
             &inputs_simulation_results,
@@ -679,6 +708,7 @@ impl RunbookExecutionContext {
         let addon_defaults = &AddonDefaults::new("tmp");
 
         let evaluated_inputs_res = perform_inputs_evaluation(
+            construct_did,
             embedded_runbook,
             &cached_dependency_execution_results,
             &inputs_simulation_results,
@@ -727,7 +757,9 @@ impl RunbookExecutionContext {
         workspace_context: &RunbookWorkspaceContext,
     ) -> Result<(), Diagnostic> {
         for (construct_did, command_snapshot) in snapshot.commands.iter() {
-            let Some(command_instance) = self.commands_instances.get_mut(&construct_did) else {
+            let Some(command_instance) =
+                Arc::make_mut(&mut self.commands_instances).get_mut(&construct_did)
+            else {
                 continue;
             };
 
@@ -824,6 +856,114 @@ impl RunbookExecutionContext {
         }
     }
 
+    /// Snapshots a completed command, the runbook snapshot is then assembled from these entries
+    /// instead of being rebuilt from the whole execution context.
+    ///
+    /// Unless all inputs are retained, the evaluated inputs of the command are then moved into its
+    /// snapshot, and the largest ones are spilled to disk until the runbook snapshot is assembled.
+    /// Inputs are kept for outputs, displayed at the end of the run, and for commands that will be
+    /// evaluated again (re-executions, signatures pending on a third party).
+    pub fn record_command_snapshot(
+        &mut self,
+        workspace_context: &RunbookWorkspaceContext,
+        construct_did: &ConstructDid,
+    ) {
+        if self.can_release_command_inputs_evaluation_result(construct_did) {
+            if let Some(inputs_evaluations) =
+                self.commands_inputs_evaluation_results.remove(construct_did)
+            {
+                if let Ok(Some(mut command_snapshot)) = CommandSnapshot::from_released_inputs(
+                    construct_did,
+                    workspace_context,
+                    self,
+                    inputs_evaluations,
+                ) {
+                    self.spilled_snapshots_values.spill(construct_did, &mut command_snapshot);
+                    self.commands_snapshots.insert(construct_did.clone(), command_snapshot);
+                }
+                return;
+            }
+        }
+        // on failure, the snapshot is rebuilt and the error reported when assembling
+        if let Ok(Some(command_snapshot)) =
+            CommandSnapshot::from_execution_context(construct_did, workspace_context, self)
+        {
+            self.spilled_snapshots_values.discard(construct_did);
+            self.commands_snapshots.insert(construct_did.clone(), command_snapshot);
+        }
+    }
+
+    fn can_release_command_inputs_evaluation_result(&self, construct_did: &ConstructDid) -> bool {
+        if self.inputs_retention_policy == InputsRetentionPolicy::RetainAll {
+            return false;
+        }
+        let Some(command_instance) = self.commands_instances.get(construct_did) else {
+            return false;
+        };
+        if command_instance.specification.name.to_lowercase().eq("output") {
+            return false;
+        }
+        let Some(execution_result) = self.commands_execution_results.get(construct_did) else {
+            return false;
+        };
+        if !should_skip_construct_evaluation(execution_result) {
+            return false;
+        }
+        // inputs that can't be snapshotted are kept, for the error to be reported when the
+        // runbook snapshot is assembled
+        let Some(inputs_evaluations) = self.commands_inputs_evaluation_results.get(construct_did)
+        else {
+            return false;
+        };
+        command_instance.specification.inputs.iter().all(|input| {
+            input.sensitive
+                || inputs_evaluations
+                    .inputs
+                    .get_value(&input.name)
+                    .map(CommandSnapshot::can_snapshot_input_value)
+                    .unwrap_or(true)
+        })
+    }
+
+    /// Returns the snapshot recorded when the command completed, with its spilled inputs read
+    /// back from disk.
+    pub fn get_recorded_command_snapshot(
+        &self,
+        construct_did: &ConstructDid,
+    ) -> Result<Option<CommandSnapshot>, Diagnostic> {
+        let Some(command_snapshot) = self.commands_snapshots.get(construct_did) else {
+            return Ok(None);
+        };
+        let mut command_snapshot = command_snapshot.clone();
+        self.spilled_snapshots_values.restore(construct_did, &mut command_snapshot)?;
+        Ok(Some(command_snapshot))
+    }
+
+    /// Returns the description of a command, from its evaluated inputs or, once these were
+    /// released, from its recorded snapshot.
+    pub fn get_command_description(&self, construct_did: &ConstructDid) -> Option<String> {
+        if let Some(inputs_evaluations) = self.commands_inputs_evaluation_results.get(construct_did)
+        {
+            return inputs_evaluations.inputs.get_string(DESCRIPTION).map(|d| d.to_string());
+        }
+        self.commands_snapshots
+            .get(construct_did)?
+            .inputs
+            .get(DESCRIPTION)?
+            .value_post_evaluation
+            .as_value()?
+            .as_string()
+            .map(|d| d.to_string())
+    }
+
+    pub fn record_command_execution_duration(
+        &mut self,
+        construct_did: &ConstructDid,
+        duration: Duration,
+    ) {
+        *self.commands_execution_durations.entry(construct_did.clone()).or_default() += duration;
+    }
+
     /// Takes a [HashMap<ConstructDid, CommandExecutionResult>] and iterates over it, calling [self].append_command_execution_result for each entry.
     pub fn append_commands_execution_results(
         &mut self,
@@ -1,18 +1,20 @@
 use daggy::Walker;
 use daggy::{Dag, NodeIndex};
 use kit::types::commands::ConstructInstance;
+use petgraph::graph::DiGraph;
 use std::cmp::Reverse;
 use std::collections::{BinaryHeap, VecDeque};
 use std::collections::{HashMap, HashSet};
+use std::sync::Arc;
 use txtx_addon_kit::hcl::Span;
-use txtx_addon_kit::indexmap::IndexSet;
+use txtx_addon_kit::indexmap::{IndexMap, IndexSet};
 use txtx_addon_kit::types::diagnostics::Diagnostic;
 use txtx_addon_kit::types::ConstructDid;
 use txtx_addon_kit::types::Did;
 use txtx_addon_kit::types::PackageDid;
 use txtx_addon_kit::types::PackageId;
 
-use super::{RunbookExecutionContext, RunbookWorkspaceContext};
+use super::{ConstructsDependencies, RunbookExecutionContext, RunbookWorkspaceContext};
 
 #[derive(Debug, Clone)]
 pub struct RunbookGraphContext {
@@ -298,25 +300,8 @@ impl RunbookGraphContext {
             self.instantiated_signers = signers;
         }
 
-        for (src, dst) in constructs_edges.iter() {
-            let constructs_graph_nodes = self.constructs_dag_node_lookup.clone();
-
-            let src_node_index = constructs_graph_nodes.get(&src).unwrap();
-            let dst_node_index = constructs_graph_nodes.get(&dst).unwrap();
-
-            if let Some(edge_to_root) =
-                self.constructs_dag.find_edge(self.graph_root, src_node_index.clone())
-            {
-                self.constructs_dag.remove_edge(edge_to_root);
-            }
-            if dst_node_index == src_node_index {
-                continue;
-            }
-            if let Err(_e) =
-                self.constructs_dag.add_edge(dst_node_index.clone(), src_node_index.clone(), 1)
-            {
-                diags.push(diagnosed_error!("Cycling dependency"));
-            }
+        if let Err(cycles_diags) = self.add_constructs_edges(&constructs_edges, workspace_context) {
+            diags.extend(cycles_diags);
         }
 
         if !diags.is_empty() {
@@ -374,22 +359,116 @@ impl RunbookGraphContext {
             }
         }
 
-        for construct_did in self.get_sorted_constructs() {
+        let sorted_nodes = stable_kahn_toposort(&self.constructs_dag);
+        for construct_did in self.resolve_constructs_dids(sorted_nodes.clone()) {
             execution_context.order_for_commands_execution.push(construct_did.clone());
             if self.instantiated_signers.iter().any(|(did, _)| did.eq(&construct_did)) {
                 execution_context.order_for_signers_initialization.push(construct_did);
             }
         }
 
-        for construct_did in execution_context
-            .commands_instances
-            .keys()
-            .chain(execution_context.embedded_runbooks.keys())
-        {
-            let dependencies =
-                self.get_downstream_dependencies_for_construct_did(construct_did, true);
-            execution_context.commands_dependencies.insert(construct_did.clone(), dependencies);
+        execution_context.commands_dependencies = Arc::new(
+            self.index_constructs_dependencies(
+                &sorted_nodes,
+                execution_context
+                    .commands_instances
+                    .keys()
+                    .chain(execution_context.embedded_runbooks.keys()),
+            ),
+        );
+        Ok(())
+    }
+
+    /// Computes the transitive dependents of the `executable` constructs in one reverse pass
+    /// over the topological order, instead of one graph traversal per construct.
+    pub fn index_constructs_dependencies<'a>(
+        &self,
+        sorted_nodes: &IndexSet<NodeIndex>,
+        executable: impl Iterator<Item = &'a ConstructDid>,
+    ) -> ConstructsDependencies {
+        let graph = self.constructs_dag.graph();
+        let constructs = graph.node_weights().cloned().collect::<Vec<_>>();
+        let children = graph
+            .node_indices()
+            .map(|node| {
+                graph.neighbors_directed(node, petgraph::Outgoing).map(|c| c.index()).collect()
+            })
+            .collect::<Vec<Vec<usize>>>();
+        let topological_order = sorted_nodes.iter().map(|node| node.index()).collect::<Vec<_>>();
+        ConstructsDependencies::from_graph(constructs, &children, &topological_order, executable)
+    }
+
+    /// Adds the dependencies between constructs to `constructs_dag`, in a single pass.
+    ///
+    /// Each `(src, dst)` pair means that `src` depends on `dst`. Constructs depending on another
+    /// construct are detached from the synthetic root. Edges are inserted in bulk, and the graph
+    /// is checked for cycles once, with Tarjan's algorithm, so that every cycle is reported
+    /// along with the constructs involved.
+    fn add_constructs_edges(
+        &mut self,
+        constructs_edges: &Vec<(ConstructDid, ConstructDid)>,
+        workspace_context: &RunbookWorkspaceContext,
+    ) -> Result<(), Vec<Diagnostic>> {
+        let graph = self.constructs_dag.graph();
+        let mut has_dependencies = vec![false; graph.node_count()];
+        let mut dependency_edges = Vec::with_capacity(constructs_edges.len());
+        for (src, dst) in constructs_edges.iter() {
+            let src_node_index = self.constructs_dag_node_lookup.get(&src).unwrap();
+            let dst_node_index = self.constructs_dag_node_lookup.get(&dst).unwrap();
+            has_dependencies[src_node_index.index()] = true;
+            if dst_node_index == src_node_index {
+                continue;
+            }
+            dependency_edges.push((dst_node_index.clone(), src_node_index.clone(), 1));
+        }
+
+        let cycles = petgraph::algo::tarjan_scc(&DiGraph::<(), (), u32>::from_edges(
+            dependency_edges.iter().map(|(dst, src, _)| (dst.index() as u32, src.index() as u32)),
+        ))
+        .into_iter()
+        .filter(|component| component.len() > 1)
+        .collect::<Vec<_>>();
+        if !cycles.is_empty() {
+            return Err(cycles
+                .into_iter()
+                .map(|component| {
+                    let mut constructs = component
+                        .into_iter()
+                        .map(|node| {
+                            let construct_did = graph
+                                .node_weight(NodeIndex::new(node.index()))
+                                .expect("construct_did not indexed in graph");
+                            let construct_id = workspace_context.expect_construct_id(construct_did);
+                            format!(
+                                "{}.{}",
+                                construct_id.construct_type, construct_id.construct_name
+                            )
+                        })
+                        .collect::<Vec<_>>();
+                    constructs.sort();
+                    diagnosed_error!("Cycling dependency between {}", constructs.join(", "))
+                })
+                .collect());
+        }
+
+        // Rebuild the graph rather than removing the root edges one by one: removing an edge
+        // walks the adjacency list of the root, which holds every construct.
+        let mut constructs_dag = Dag::new();
+        for node in graph.node_indices() {
+            constructs_dag.add_node(graph[node].clone());
         }
+        let existing_edges = graph
+            .raw_edges()
+            .iter()
+            .filter(|edge| {
+                edge.source() != self.graph_root || !has_dependencies[edge.target().index()]
+            })
+            .map(|edge| (edge.source(), edge.target(), edge.weight))
+            .collect::<Vec<_>>();
+        constructs_dag
+            .add_edges(existing_edges.into_iter().chain(dependency_edges))
+            .map_err(|_| vec![diagnosed_error!("Cycling dependency")])?;
+        self.constructs_dag = constructs_dag;
         Ok(())
     }
 
@@ -478,6 +557,71 @@ impl RunbookGraphContext {
         self.resolve_constructs_dids(nodes)
     }
 
+    /// Computes the execution levels of the constructs, their estimated costs and the critical
+    /// path of the graph.
+    ///
+    /// Constructs with no recorded cost in `costs` are given `default_cost`.
+    pub fn compute_plan_stats(
+        &self,
+        costs: &HashMap<ConstructDid, u64>,
+        default_cost: u64,
+    ) -> RunbookPlanStats {
+        let graph = self.constructs_dag.graph();
+        let sorted_nodes = stable_kahn_toposort(&self.constructs_dag);
+
+        let mut levels: Vec<Vec<ConstructDid>> = vec![];
+        let mut node_levels = vec![0usize; graph.node_count()];
+        // cost of the most expensive chain ending with each node, and the node preceding it
+        let mut chain_costs = vec![0u64; graph.node_count()];
+        let mut predecessors = vec![None; graph.node_count()];
+        let mut estimated_costs = IndexMap::new();
+        for node in sorted_nodes.iter() {
+            if *node == self.graph_root {
+                continue;
+            }
+            let construct_did = &graph[*node];
+            let cost = costs.get(construct_did).cloned().unwrap_or(default_cost);
+            let mut level = 0;
+            let mut chain_cost = 0;
+            for parent in graph.neighbors_directed(*node, petgraph::Incoming) {
+                if parent == self.graph_root {
+                    continue;
+                }
+                level = level.max(node_levels[parent.index()] + 1);
+                if predecessors[node.index()].is_none() || chain_costs[parent.index()] > chain_cost
+                {
+                    chain_cost = chain_costs[parent.index()];
+                    predecessors[node.index()] = Some(parent);
+                }
+            }
+            node_levels[node.index()] = level;
+            chain_costs[node.index()] = chain_cost + cost;
+            if levels.len() == level {
+                levels.push(vec![]);
+            }
+            levels[level].push(construct_did.clone());
+            estimated_costs.insert(construct_did.clone(), cost);
+        }
+
+        let mut critical_path = vec![];
+        let mut critical_path_cost = 0;
+        let last_node = sorted_nodes
+            .iter()
+            .filter(|node| **node != self.graph_root)
+            .max_by_key(|node| (chain_costs[node.index()], Reverse(node.index())));
+        if let Some(last_node) = last_node {
+            critical_path_cost = chain_costs[last_node.index()];
+            let mut node = Some(*last_node);
+            while let Some(current) = node {
+                critical_path.push(graph[current].clone());
+                node = predecessors[current.index()];
+            }
+            critical_path.reverse();
+        }
+
+        RunbookPlanStats { levels, estimated_costs, critical_path, critical_path_cost }
+    }
+
     pub fn resolve_constructs_dids(&self, nodes: IndexSet<NodeIndex>) -> Vec<ConstructDid> {
         let mut construct_dids = vec![];
         for node in nodes {
@@ -490,6 +634,20 @@ impl RunbookGraphContext {
     }
 }
 
+/// Scheduling view of a runbook's constructs graph.
+#[derive(Debug, Clone)]
+pub struct RunbookPlanStats {
+    /// Constructs grouped by level: the constructs of a level only depend on constructs of
+    /// previous levels, and could be executed together.
+    pub levels: Vec<Vec<ConstructDid>>,
+    /// Estimated cost of each construct, in topological order
+    pub estimated_costs: IndexMap<ConstructDid, u64>,
+    /// Most expensive chain of dependent constructs, bounding the duration of an execution
+    pub critical_path: Vec<ConstructDid>,
+    /// Cumulated estimated cost of the critical path
+    pub critical_path_cost: u64,
+}
+
 /// Stable topological sort using Kahn's algorithm
 /// This implementation prioritizes the original order of nodes in the graph
 fn stable_kahn_toposort(dag: &Dag<ConstructDid, u32>) -> IndexSet<NodeIndex> {
@@ -540,7 +698,9 @@ fn stable_kahn_toposort(dag: &Dag<ConstructDid, u32>) -> IndexSet<NodeIndex> {
 
 #[cfg(test)]
 mod tests {
+    use std::collections::HashMap;
 
+    use txtx_addon_kit::types::ConstructDid;
     use txtx_test_utils::test_harness::build_runbook_from_fixture;
 
     use test_case::test_case;
@@ -555,7 +715,114 @@ mod tests {
         else {
             panic!("Missing expected error on circular dependency");
         };
-        assert_eq!(e.get(0).unwrap().message, format!("Cycling dependency"));
+        assert_eq!(e.len(), 1);
+        assert_eq!(e[0].message, format!("Cycling dependency between variable.a, variable.b"));
+    }
+
+    #[tokio::test]
+    async fn it_reports_every_cycle() {
+        let fixture = r#"
+variable "a" {
+    value = variable.c
+}
+variable "b" {
+    value = variable.a
+}
+variable "c" {
+    value = variable.b
+}
+variable "d" {
+    value = variable.e
+}
+variable "e" {
+    value = variable.d
+}
+variable "f" {
+    value = variable.a
+}
+"#;
+        let Err(e) = build_runbook_from_fixture("cycles.tx", fixture, get_addon_by_namespace).await
+        else {
+            panic!("Missing expected error on circular dependency");
+        };
+        let mut messages = e.iter().map(|diag| diag.message.clone()).collect::<Vec<_>>();
+        messages.sort();
+        assert_eq!(
+            messages,
+            vec![
+                "Cycling dependency between variable.a, variable.b, variable.c".to_string(),
+                "Cycling dependency between variable.d, variable.e".to_string(),
+            ]
+        );
+    }
+
+    #[tokio::test]
+    #[ignore = "graph build benchmark, run with `cargo test -p txtx-core -- --ignored --nocapture`"]
+    async fn bench_graph_build_scaling() {
+        for constructs in [1_000, 2_000, 4_000, 8_000] {
+            // a few long chains, each construct depending on the previous one of its chain
+            let mut fixture = String::new();
+            for i in 0..constructs {
+                if i < 4 {
+                    fixture.push_str(&format!("variable \"v{i}\" {{\n    value = 1\n}}\n"));
+                } else {
+                    fixture.push_str(&format!(
+                        "variable \"v{i}\" {{\n    value = variable.v{} + 1\n}}\n",
+                        i - 4
+                    ));
+                }
+            }
+            let start = std::time::Instant::now();
+            build_runbook_from_fixture("bench.tx", &fixture, get_addon_by_namespace).await.unwrap();
+            let elapsed = start.elapsed();
+            println!(
+                "{constructs} constructs: {:?} ({:?} per construct)",
+                elapsed,
+                elapsed / constructs
+            );
+        }
+    }
+
+    #[tokio::test]
+    async fn it_computes_levels_and_critical_path() {
+        let fixture = include_str!("../tests/fixtures/sorting/6.tx");
+        let runbook =
+            build_runbook_from_fixture("test.tx", fixture, get_addon_by_namespace).await.unwrap();
+        let flow_context = &runbook.flow_contexts[0];
+        let name = |construct_did: &ConstructDid| {
+            flow_context
+                .execution_context
+                .commands_instances
+                .get(construct_did)
+                .unwrap()
+                .name
+                .clone()
+        };
+        let names = |construct_dids: &Vec<ConstructDid>| {
+            construct_dids.iter().map(|c| name(c)).collect::<Vec<_>>()
+        };
+
+        let stats = flow_context.graph_context.compute_plan_stats(&HashMap::new(), 1);
+        let levels = stats.levels.iter().map(|level| names(level)).collect::<Vec<_>>();
+        assert_eq!(
+            levels,
+            vec![
+                vec!["url"],
+                vec!["get", "post"],
+                vec!["get_status", "post_status"],
+                vec!["get_status_out", "post_status_out"],
+            ]
+        );
+        assert_eq!(stats.critical_path_cost, 4);
+        assert_eq!(names(&stats.critical_path), vec!["url", "get", "get_status", "get_status_out"]);
+
+        let post = stats.estimated_costs.keys().find(|c| name(c) == "post").unwrap().clone();
+        let stats = flow_context.graph_context.compute_plan_stats(&HashMap::from([(post, 100)]), 1);
+        assert_eq!(stats.critical_path_cost, 103);
+        assert_eq!(
+            names(&stats.critical_path),
+            vec!["url", "post", "post_status", "post_status_out"]
+        );
     }
 
     #[test_case(include_str!("../tests/fixtures/ab_c.tx"), vec!["a", "b", "c"])]
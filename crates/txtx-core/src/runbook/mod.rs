@@ -3,10 +3,14 @@ use flow_context::FlowContext;
 use kit::indexmap::IndexMap;
 use kit::types::cloud_interface::CloudServiceContext;
 use kit::types::frontend::ActionItemRequestType;
-use kit::types::types::AddonJsonConverter;
+use kit::types::types::{AddonJsonConverter, JsonSerializableValue};
 use kit::types::{ConstructDid, RunbookInstanceContext};
-use serde_json::{json, Value as JsonValue};
+use serde::ser::SerializeMap;
+use serde::{Serialize, Serializer};
+use serde_json::Value as JsonValue;
 use std::collections::{HashMap, HashSet, VecDeque};
+use std::io::Write;
+use std::sync::Arc;
 use txtx_addon_kit::hcl::structure::BlockLabel;
 use txtx_addon_kit::hcl::Span;
 use txtx_addon_kit::helpers::fs::FileLocation;
@@ -20,6 +24,7 @@ use txtx_addon_kit::types::{AuthorizationContext, Did, PackageId, RunbookId};
 use txtx_addon_kit::Addon;
 
 pub mod collector;
+mod dependencies;
 mod diffing_context;
 pub mod embedded_runbook;
 mod execution_context;
@@ -27,16 +32,20 @@ pub mod flow_context;
 mod graph_context;
 pub mod location;
 mod runtime_context;
+pub(crate) mod snapshot_spill;
 pub mod variables;
 mod workspace_context;
 
-pub use diffing_context::ConsolidatedChanges;
+pub use dependencies::ConstructsDependencies;
+pub use diffing_context::{ConsolidatedChanges, ConsolidatedPlanChanges};
 pub use diffing_context::{RunbookExecutionSnapshot, RunbookSnapshotContext, SynthesizedChange};
-pub use execution_context::{RunbookExecutionContext, RunbookExecutionMode};
-pub use graph_context::RunbookGraphContext;
+pub use execution_context::{InputsRetentionPolicy, RunbookExecutionContext, RunbookExecutionMode};
+pub use graph_context::{RunbookGraphContext, RunbookPlanStats};
 pub use runtime_context::{AddonConstructFactory, RuntimeContext};
+pub use snapshot_spill::SpilledSnapshotsValues;
 pub use workspace_context::RunbookWorkspaceContext;
 
+use crate::eval::constant_folding::fold_constant_inputs;
 use crate::manifest::{RunbookStateLocation, RunbookTransientStateLocation};
 
 #[derive(Debug)]
@@ -233,7 +242,13 @@ impl Runbook {
                 )
                 .await?;
 
-            // Step 3: simulate inputs evaluation - some more edges could be hidden in there
+            // Step 3: fold the inputs that don't depend on any execution, then simulate inputs
+            // evaluation - some more edges could be hidden in there
+            flow_context.execution_context.constant_inputs = Arc::new(fold_constant_inputs(
+                &flow_context.workspace_context,
+                &flow_context.execution_context,
+                &runtime_context,
+            ));
             flow_context
                 .execution_context
                 .simulate_inputs_execution(&runtime_context, &flow_context.workspace_context)
@@ -343,6 +358,8 @@ impl Runbook {
         self.top_level_inputs_map.current_environment.clone()
     }
 
+    /// Backs up the execution context of each flow. The instances and dependencies built with
+    /// the runbook are shared with the backups, and only copied when modified.
     pub fn backup_execution_contexts(&self) -> HashMap<String, RunbookExecutionContext> {
         let mut execution_context_backups = HashMap::new();
         for flow_context in self.flow_contexts.iter() {
@@ -410,6 +427,7 @@ impl Runbook {
     pub fn prepared_flows_for_updated_plans(
         &mut self,
         plans_to_update: &IndexMap<String, ConsolidatedPlanChanges>,
+        targets_closures: Option<&HashMap<String, HashSet<ConstructDid>>>,
     ) -> (
         IndexMap<String, Vec<(String, Option<String>)>>,
         IndexMap<String, Vec<(String, Option<String>)>>,
@@ -430,6 +448,21 @@ impl Runbook {
 
             let flow_context = self.find_expected_flow_context_mut(&flow_context_key);
 
+            // constructs out of the targets are left as they are
+            let closure = targets_closures.and_then(|closures| closures.get(flow_context_key));
+            let is_targeted = |construct_did: &ConstructDid| {
+                closure.map(|closure| closure.contains(construct_did)).unwrap_or(true)
+            };
+            let critical_edits = critical_edits
+                .into_iter()
+                .filter(|c| c.construct_did.as_ref().map(is_targeted).unwrap_or(true))
+                .collect::<Vec<_>>();
+            let additions = additions
+                .into_iter()
+                .filter(|(construct_did, _)| is_targeted(construct_did))
+                .collect::<Vec<_>>();
+            unexecuted.retain(|construct_did| is_targeted(construct_did));
+
             if critical_edits.is_empty() && additions.is_empty() && unexecuted.is_empty() {
                 flow_context.execution_context.execution_mode = RunbookExecutionMode::Ignored;
                 continue;
@@ -444,17 +477,29 @@ impl Runbook {
                     if let Some(construct_did) = &c.construct_did {
                         let mut segment = vec![];
                         segment.push(construct_did.clone());
-                        let mut deps = flow_context
-                            .graph_context
-                            .get_downstream_dependencies_for_construct_did(&construct_did, true);
-                        segment.append(&mut deps);
+                        // signers are not indexed, their dependents are walked in the graph
+                        match flow_context
+                            .execution_context
+                            .commands_dependencies
+                            .dependents_of(&construct_did)
+                        {
+                            Some(deps) => segment.extend(deps.cloned()),
+                            None => segment.append(
+                                &mut flow_context
+                                    .graph_context
+                                    .get_downstream_dependencies_for_construct_did(
+                                        &construct_did,
+                                        true,
+                                    ),
+                            ),
+                        }
                         Some(segment)
                     } else {
                         None
                     }
                 })
                 .flatten()
-                .filter(|d| !added_construct_dids.contains(d))
+                .filter(|d| !added_construct_dids.contains(d) && is_targeted(d))
                 .collect::<Vec<_>>();
             descendants_of_critically_changed_commands.sort();
             descendants_of_critically_changed_commands.dedup();
@@ -462,12 +507,8 @@ impl Runbook {
             let actions: Vec<(String, Option<String>)> = descendants_of_critically_changed_commands
                 .iter()
                 .map(|construct_did| {
-                    let documentation = flow_context
-                        .execution_context
-                        .commands_inputs_evaluation_results
-                        .get(construct_did)
-                        .and_then(|r| r.inputs.get_string("description"))
-                        .and_then(|d| Some(d.to_string()));
+                    let documentation =
+                        flow_context.execution_context.get_command_description(construct_did);
                     let command = flow_context
                         .execution_context
                         .commands_instances
@@ -481,12 +522,8 @@ impl Runbook {
             let added_actions: Vec<(String, Option<String>)> = added_construct_dids
                 .iter()
                 .map(|construct_did| {
-                    let documentation = flow_context
-                        .execution_context
-                        .commands_inputs_evaluation_results
-                        .get(construct_did)
-                        .and_then(|r| r.inputs.get_string("description"))
-                        .and_then(|d| Some(d.to_string()));
+                    let documentation =
+                        flow_context.execution_context.get_command_description(construct_did);
                     let command = flow_context
                         .execution_context
                         .commands_instances
@@ -521,6 +558,72 @@ impl Runbook {
         (actions_to_re_execute, actions_to_execute)
     }
 
+    /// Resolves the `targets` constructs (e.g. `output.address`) of the flows, with the constructs
+    /// they depend on. Fails if a target is not found in any flow.
+    ///
+    /// Returns the resolved constructs, by flow name.
+    pub fn resolve_targets(
+        &self,
+        targets: &Vec<String>,
+    ) -> Result<HashMap<String, HashSet<ConstructDid>>, String> {
+        let mut targets_closures = HashMap::new();
+        let mut unresolved_targets = targets.iter().collect::<HashSet<_>>();
+        for flow_context in self.flow_contexts.iter() {
+            let mut closure = HashSet::new();
+            for (construct_did, construct_id) in flow_context.workspace_context.constructs.iter() {
+                let name =
+                    format!("{}.{}", construct_id.construct_type, construct_id.construct_name);
+                if targets.contains(&name) {
+                    unresolved_targets.remove(&name);
+                    closure.extend(
+                        flow_context
+                            .graph_context
+                            .get_upstream_dependencies_for_construct_did(construct_did),
+                    );
+                    closure.insert(construct_did.clone());
+                }
+            }
+            targets_closures.insert(flow_context.name.clone(), closure);
+        }
+        if let Some(target) = unresolved_targets.into_iter().next() {
+            return Err(format!("unable to find target '{}' in runbook", target));
+        }
+        Ok(targets_closures)
+    }
+
+    /// Restricts the execution of the flows to the constructs resolved by
+    /// [Runbook::resolve_targets]. The other constructs are skipped, and are left unexecuted in
+    /// the state file.
+    ///
+    /// Returns the number of constructs left to execute, across all flows.
+    pub fn restrict_flows_to_targets(
+        &mut self,
+        targets_closures: &HashMap<String, HashSet<ConstructDid>>,
+    ) -> usize {
+        let mut constructs_to_execute = 0;
+        for flow_context in self.flow_contexts.iter_mut() {
+            let Some(closure) = targets_closures.get(&flow_context.name) else {
+                continue;
+            };
+            let execution_context = &mut flow_context.execution_context;
+            execution_context.order_for_commands_execution.retain(|c| closure.contains(c));
+            execution_context.order_for_signers_initialization.retain(|c| closure.contains(c));
+            if let RunbookExecutionMode::Partial(ref mut constructs) =
+                execution_context.execution_mode
+            {
+                constructs.retain(|c| closure.contains(c));
+            }
+            if execution_context.execution_mode != RunbookExecutionMode::Ignored {
+                constructs_to_execute += execution_context
+                    .order_for_commands_execution
+                    .iter()
+                    .filter(|c| execution_context.commands_instances.contains_key(c))
+                    .count();
+            }
+        }
+        constructs_to_execute
+    }
+
     pub fn write_runbook_state(
         &self,
         runbook_state_location: Option<RunbookStateLocation>,
@@ -539,12 +642,6 @@ impl Runbook {
                 &self.runbook_id.name,
                 Some(&self.top_level_inputs_map.current_top_level_input_name()),
             );
-            if let Some(RunbookTransientStateLocation(lock_file)) =
-                RunbookTransientStateLocation::from_state_file_location(&state_file_location)
-            {
-                let _ = std::fs::remove_file(&lock_file.to_string());
-            }
-
             let diff = RunbookSnapshotContext::new();
             let snapshot = diff
                 .snapshot_runbook_execution(
@@ -555,8 +652,17 @@ impl Runbook {
                 )
                 .map_err(|e| e.message)?;
             state_file_location
-                .write_content(serde_json::to_string_pretty(&snapshot).unwrap().as_bytes())
-                .expect("unable to save state");
+                .write_atomically(|writer| {
+                    serde_json::to_writer_pretty(writer, &snapshot).map_err(|e| e.to_string())
+                })
+                .map_err(|e| format!("unable to save state ({})", e))?;
+
+            // The lock file is only discarded once the state it recovers from is safely written.
+            if let Some(RunbookTransientStateLocation(lock_file)) =
+                RunbookTransientStateLocation::from_state_file_location(&state_file_location)
+            {
+                let _ = std::fs::remove_file(&lock_file.to_string());
+            }
             Ok(Some(state_file_location))
         } else {
             Ok(None)
@@ -597,8 +703,10 @@ impl Runbook {
                 )
                 .map_err(|e| e.message)?;
             lock_file
-                .write_content(serde_json::to_string_pretty(&snapshot).unwrap().as_bytes())
-                .map_err(|e| format!("unable to save state ({})", e.to_string()))?;
+                .write_atomically(|writer| {
+                    serde_json::to_writer_pretty(writer, &snapshot).map_err(|e| e.to_string())
+                })
+                .map_err(|e| format!("unable to save state ({})", e))?;
             Ok(Some(lock_file))
         } else {
             Ok(None)
@@ -677,24 +785,44 @@ impl RunbookOutputs {
     }
 
     pub fn to_json(&self, addon_converters: &Vec<AddonJsonConverter>) -> JsonValue {
-        let mut json = json!({});
-        let only_one_flow = self.outputs.len() == 1;
-        for (flow_name, flow_outputs) in self.outputs.iter() {
-            let mut flow_json = json!({});
-            for (output_name, (output_value, output_description)) in flow_outputs.iter() {
-                let mut output_json = json!({});
-                output_json["value"] = output_value.to_json(Some(&addon_converters));
-                if let Some(ref output_description) = output_description {
-                    output_json["description"] = output_description.clone().into();
-                }
-                flow_json[output_name] = output_json;
+        serde_json::to_value(SerializableRunbookOutputs { outputs: self, addon_converters })
+            .unwrap_or(JsonValue::Null)
+    }
+
+    /// Streams the outputs to `writer` in the requested format, without building the
+    /// intermediate JSON tree returned by [RunbookOutputs::to_json].
+    pub fn write_to<W: Write>(
+        &self,
+        mut writer: W,
+        addon_converters: &Vec<AddonJsonConverter>,
+        format: &RunbookOutputsFormat,
+    ) -> Result<(), String> {
+        match format {
+            RunbookOutputsFormat::Json => {
+                let outputs = SerializableRunbookOutputs { outputs: self, addon_converters };
+                serde_json::to_writer_pretty(&mut writer, &outputs)
+                    .map_err(|e| format!("failed to serialize outputs: {e}"))?;
+                writer.write_all(b"\n").map_err(|e| format!("failed to write outputs: {e}"))?;
             }
-            if only_one_flow {
-                return flow_json;
+            RunbookOutputsFormat::JsonLines => {
+                for (flow_name, flow_outputs) in self.outputs.iter() {
+                    for (output_name, (output_value, output_description)) in flow_outputs.iter() {
+                        let line = SerializableOutputLine {
+                            flow: flow_name,
+                            name: output_name,
+                            value: output_value.as_json_serializable(Some(addon_converters)),
+                            description: output_description.as_ref(),
+                        };
+                        serde_json::to_writer(&mut writer, &line)
+                            .map_err(|e| format!("failed to serialize output: {e}"))?;
+                        writer
+                            .write_all(b"\n")
+                            .map_err(|e| format!("failed to write outputs: {e}"))?;
+                    }
+                }
             }
-            json[flow_name] = flow_json;
         }
-        json
+        writer.flush().map_err(|e| format!("failed to write outputs: {e}"))
     }
 
     pub fn is_empty(&self) -> bool {
@@ -711,6 +839,89 @@ impl RunbookOutputs {
     }
 }
 
+/// The formats [RunbookOutputs] can be streamed in.
+#[derive(Clone, Debug, PartialEq)]
+pub enum RunbookOutputsFormat {
+    /// A single JSON document, keyed by flow name when the runbook has more than one flow
+    Json,
+    /// One JSON object per line, per output
+    JsonLines,
+}
+
+impl RunbookOutputsFormat {
+    pub fn file_extension(&self) -> &'static str {
+        match self {
+            RunbookOutputsFormat::Json => "json",
+            RunbookOutputsFormat::JsonLines => "jsonl",
+        }
+    }
+}
+
+struct SerializableRunbookOutputs<'a, 'b> {
+    outputs: &'a RunbookOutputs,
+    addon_converters: &'a Vec<AddonJsonConverter<'b>>,
+}
+
+impl Serialize for SerializableRunbookOutputs<'_, '_> {
+    fn serialize<S>(&self, serializer: S) -> Result<S::Ok, S::Error>
+    where
+        S: Serializer,
+    {
+        let addon_converters = self.addon_converters;
+        if self.outputs.outputs.len() == 1 {
+            let (_, flow_outputs) = self.outputs.outputs.first().unwrap();
+            return SerializableFlowOutputs { flow_outputs, addon_converters }
+                .serialize(serializer);
+        }
+        let mut map = serializer.serialize_map(Some(self.outputs.outputs.len()))?;
+        for (flow_name, flow_outputs) in self.outputs.outputs.iter() {
+            map.serialize_entry(
+                flow_name,
+                &SerializableFlowOutputs { flow_outputs, addon_converters },
+            )?;
+        }
+        map.end()
+    }
+}
+
+struct SerializableFlowOutputs<'a, 'b> {
+    flow_outputs: &'a IndexMap<String, (Value, Option<String>)>,
+    addon_converters: &'a Vec<AddonJsonConverter<'b>>,
+}
+
+impl Serialize for SerializableFlowOutputs<'_, '_> {
+    fn serialize<S>(&self, serializer: S) -> Result<S::Ok, S::Error>
+    where
+        S: Serializer,
+    {
+        let mut map = serializer.serialize_map(Some(self.flow_outputs.len()))?;
+        for (output_name, (output_value, output_description)) in self.flow_outputs.iter() {
+            let output = SerializableOutput {
+                value: output_value.as_json_serializable(Some(self.addon_converters)),
+                description: output_description.as_ref(),
+            };
+            map.serialize_entry(output_name, &output)?;
+        }
+        map.end()
+    }
+}
+
+#[derive(Serialize)]
+struct SerializableOutput<'a, 'b> {
+    value: JsonSerializableValue<'a, 'b>,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    description: Option<&'a String>,
+}
+
+#[derive(Serialize)]
+struct SerializableOutputLine<'a, 'b> {
+    flow: &'a str,
+    name: &'a str,
+    value: JsonSerializableValue<'a, 'b>,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    description: Option<&'a String>,
+}
+
 #[derive(Clone, Debug)]
 pub struct RunbookTopLevelInputsMap {
     current_environment: Option<String>,
@@ -4,6 +4,9 @@ use serde::Deserialize;
 use serde::Serialize;
 use std::collections::HashMap;
 use std::collections::VecDeque;
+use std::sync::Arc;
+use txtx_addon_kit::constants::{RPC_API_URL, RPC_MAX_IN_FLIGHT_REQUESTS, RPC_REQUESTS_PER_SECOND};
+use txtx_addon_kit::helpers::rpc_limiter::{configure_rpc_endpoint, RpcEndpointLimits};
 use txtx_addon_kit::types::commands::DependencyExecutionResultCache;
 use txtx_addon_kit::types::stores::AddonDefaults;
 use txtx_addon_kit::types::stores::ValueStore;
@@ -15,9 +18,11 @@ use txtx_addon_kit::{
             CommandId, CommandInputsEvaluationResult, CommandInstance, CommandInstanceType,
             PreCommandSpecification,
         },
+        cost_estimation::{CostEstimationFuture, CostEstimationRequest},
         diagnostics::Diagnostic,
+        embedded_runbooks::EmbeddedRunbookInstanceSpecification,
         functions::FunctionSpecification,
-        signers::{SignerInstance, SignerSpecification},
+        signers::{SignerInstance, SignerSpecification, SignersState},
         types::Value,
         AuthorizationContext, ConstructDid, ContractSourceTransform, Did, PackageDid, PackageId,
         RunbookId,
@@ -153,6 +158,51 @@ impl RuntimeContext {
         Ok(consolidated_dependencies)
     }
 
+    /// Returns one future per addon estimating the costs of the transactions produced by the
+    /// commands not executed yet, from the inputs evaluated by a simulation of the runbook.
+    /// The commands of all the flows are gathered, so that addons fetch the balance of a signer
+    /// once for the whole runbook. The futures are meant to be awaited concurrently.
+    pub fn estimate_transactions_costs<'a>(
+        &self,
+        runbook_execution_contexts: impl IntoIterator<Item = &'a RunbookExecutionContext>,
+    ) -> Vec<CostEstimationFuture> {
+        let mut grouped_requests: HashMap<String, Vec<CostEstimationRequest>> = HashMap::new();
+        let mut signers = SignersState::new();
+        for runbook_execution_context in runbook_execution_contexts.into_iter() {
+            for (did, command_instance) in runbook_execution_context.commands_instances.iter() {
+                if !command_instance.specification.implements_signing_capability
+                    || runbook_execution_context.commands_execution_results.contains_key(did)
+                {
+                    continue;
+                }
+                let Some(inputs_simulation_results) =
+                    runbook_execution_context.commands_inputs_evaluation_results.get(did)
+                else {
+                    continue;
+                };
+                grouped_requests.entry(command_instance.namespace.clone()).or_default().push(
+                    CostEstimationRequest {
+                        construct_did: did.clone(),
+                        construct_name: command_instance.name.clone(),
+                        matcher: command_instance.specification.matcher.clone(),
+                        inputs: inputs_simulation_results.inputs.clone(),
+                    },
+                );
+            }
+            if let Some(signers_state) = &runbook_execution_context.signers_state {
+                signers.store.extend(signers_state.store.clone());
+            }
+        }
+        let mut estimations = vec![];
+        for (addon_key, commands) in grouped_requests.into_iter() {
+            let Some((addon, _)) = self.addons_context.registered_addons.get(&addon_key) else {
+                continue;
+            };
+            estimations.push(addon.estimate_transactions_costs(commands, signers.clone()));
+        }
+        estimations
+    }
+
     /// Checks if the provided `addon_id` matches the namespace of a supported addon
     /// that is available in the `get_addon_by_namespace` fn of the [RuntimeContext].
     /// If there is no match, returns [Vec<Diagnostic>].
@@ -322,6 +372,42 @@ impl RuntimeContext {
             }
             addon_defaults.insert(&key, value);
         }
+
+        if let Some(rpc_api_url) = addon_defaults.store.get_string(RPC_API_URL) {
+            let store = &addon_defaults.store;
+            let max_in_flight_requests = match store.get_value(RPC_MAX_IN_FLIGHT_REQUESTS) {
+                None => None,
+                Some(value) => match value.as_integer().map(usize::try_from) {
+                    Some(Ok(max)) if max > 0 => Some(max),
+                    _ => {
+                        return Err(diagnosed_error!(
+                            "invalid '{}': expected a positive integer, found '{}'",
+                            RPC_MAX_IN_FLIGHT_REQUESTS,
+                            value.to_string()
+                        ))
+                    }
+                },
+            };
+            let requests_per_second = match store.get_value(RPC_REQUESTS_PER_SECOND) {
+                None => None,
+                Some(value) => {
+                    match value.as_float().or(value.as_integer().map(|rate| rate as f64)) {
+                        Some(rate) if rate.is_finite() && rate > 0.0 => Some(rate),
+                        _ => {
+                            return Err(diagnosed_error!(
+                                "invalid '{}': expected a positive number, found '{}'",
+                                RPC_REQUESTS_PER_SECOND,
+                                value.to_string()
+                            ))
+                        }
+                    }
+                }
+            };
+            let limits = RpcEndpointLimits { max_in_flight_requests, requests_per_second };
+            if limits != RpcEndpointLimits::default() {
+                configure_rpc_endpoint(rpc_api_url, limits);
+            }
+        }
         Ok(addon_defaults)
     }
 
@@ -476,9 +562,15 @@ impl RuntimeContext {
 #[derive(Debug)]
 pub struct AddonsContext {
     pub registered_addons: HashMap<String, (Box<dyn Addon>, bool)>,
-    pub addon_construct_factories: HashMap<(PackageDid, String), AddonConstructFactory>,
+    /// Construct factories, per package. Factories are built once per addon and shared
+    /// across packages, so registering an addon with another package is a pointer copy.
+    pub addon_construct_factories: HashMap<(PackageDid, String), Arc<AddonConstructFactory>>,
     /// Function to get an available addon by namespace
     pub get_addon_by_namespace: fn(&str) -> Option<Box<dyn Addon>>,
+    /// Embedded runbooks specifications, by hash of their published content. Specifications
+    /// are built against the addons registered in this context, and their static contexts are
+    /// shared by all the instances of an embedded runbook.
+    pub embedded_runbooks_specifications: HashMap<Did, Arc<EmbeddedRunbookInstanceSpecification>>,
 }
 
 impl AddonsContext {
@@ -487,6 +579,7 @@ impl AddonsContext {
             registered_addons: HashMap::new(),
             addon_construct_factories: HashMap::new(),
             get_addon_by_namespace,
+            embedded_runbooks_specifications: HashMap::new(),
         }
     }
 
@@ -517,19 +610,30 @@ impl AddonsContext {
         scope: bool,
     ) -> Result<(), Diagnostic> {
         let key = (package_did.clone(), addon_id.to_string());
-        let Some(addon) = (self.get_addon_by_namespace)(addon_id) else {
-            return Err(diagnosed_error!("unable to find addon {}", addon_id));
-        };
         if self.addon_construct_factories.contains_key(&key) {
             return Ok(());
         }
 
-        // Build and register factory
-        let factory = AddonConstructFactory {
-            functions: addon.build_function_lookup(),
-            commands: addon.build_command_lookup(),
-            signers: addon.build_signer_lookup(),
+        // Reuse the factory built when the addon was first registered by another package
+        let shared_factory = self
+            .addon_construct_factories
+            .iter()
+            .find(|((_, namespace), _)| namespace.eq(addon_id))
+            .map(|(_, factory)| factory.clone());
+
+        if let Some(factory) = shared_factory {
+            if let Some((_, addon_scope)) = self.registered_addons.get_mut(addon_id) {
+                *addon_scope = scope;
+                self.addon_construct_factories.insert(key, factory);
+                return Ok(());
+            }
+        }
+
+        let Some(addon) = (self.get_addon_by_namespace)(addon_id) else {
+            return Err(diagnosed_error!("unable to find addon {}", addon_id));
         };
+        // Build and register factory
+        let factory = Arc::new(AddonConstructFactory::from_addon(addon.as_ref()));
         self.registered_addons.insert(addon_id.to_string(), (addon, scope));
         self.addon_construct_factories.insert(key, factory);
         Ok(())
@@ -595,6 +699,15 @@ pub struct AddonConstructFactory {
 }
 
 impl AddonConstructFactory {
+    /// Indexes the functions, commands and signers exposed by `addon`.
+    pub fn from_addon(addon: &dyn Addon) -> Self {
+        AddonConstructFactory {
+            functions: addon.build_function_lookup(),
+            commands: addon.build_command_lookup(),
+            signers: addon.build_signer_lookup(),
+        }
+    }
+
     pub fn create_command_instance(
         self: &Self,
         command_id: &CommandId,
@@ -617,9 +730,9 @@ impl AddonConstructFactory {
         match pre_command_spec {
             PreCommandSpecification::Atomic(command_spec) => {
                 let command_instance = CommandInstance {
-                    specification: command_spec.clone(),
+                    specification: Arc::new(command_spec.clone()),
                     name: command_name.to_string(),
-                    block: block.clone(),
+                    block: Arc::new(block.clone()),
                     package_id: package_id.clone(),
                     typing,
                     namespace: namespace.to_string(),
@@ -0,0 +1,148 @@
+use std::collections::HashMap;
+use std::path::PathBuf;
+use std::sync::Arc;
+
+use txtx_addon_kit::indexmap::IndexMap;
+use txtx_addon_kit::types::diagnostics::Diagnostic;
+use txtx_addon_kit::types::types::Value;
+use txtx_addon_kit::types::ConstructDid;
+
+use super::diffing_context::{CommandSnapshot, ValuePostEvaluation};
+
+/// Inputs of recorded snapshots estimated below this size are kept in memory.
+pub const SPILL_THRESHOLD_BYTES: usize = 16 * 1024;
+
+/// Temporary directory holding spilled values, removed once the last execution context
+/// referencing it is dropped.
+#[derive(Debug)]
+struct SpillDirectory {
+    path: PathBuf,
+}
+
+impl Drop for SpillDirectory {
+    fn drop(&mut self) {
+        let _ = std::fs::remove_dir_all(&self.path);
+    }
+}
+
+/// Large input values of the commands snapshots recorded during a run (program binaries, init
+/// code, ...). Once the evaluated inputs of a command are released, these values are written to
+/// disk, and only read back when the runbook snapshot is assembled.
+#[derive(Debug, Clone, Default)]
+pub struct SpilledSnapshotsValues {
+    directory: Option<Arc<SpillDirectory>>,
+    /// Files holding the spilled inputs of each command, indexed by input name
+    entries: HashMap<ConstructDid, IndexMap<String, PathBuf>>,
+}
+
+impl SpilledSnapshotsValues {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Writes the inputs of the snapshot that are larger than [SPILL_THRESHOLD_BYTES] to disk,
+    /// and replaces them with null in the snapshot. Values that can't be written stay in memory.
+    #[cfg(not(feature = "wasm"))]
+    pub fn spill(&mut self, construct_did: &ConstructDid, snapshot: &mut CommandSnapshot) {
+        self.entries.remove(construct_did);
+        for (input_name, input) in snapshot.inputs.iter_mut() {
+            if estimate_value_post_evaluation_size(&input.value_post_evaluation)
+                < SPILL_THRESHOLD_BYTES
+            {
+                continue;
+            }
+            let Ok(path) = self.write(&input.value_post_evaluation) else {
+                continue;
+            };
+            input.value_post_evaluation = ValuePostEvaluation::Value(Value::null());
+            self.entries.entry(construct_did.clone()).or_default().insert(input_name.clone(), path);
+        }
+    }
+
+    #[cfg(feature = "wasm")]
+    pub fn spill(&mut self, _construct_did: &ConstructDid, _snapshot: &mut CommandSnapshot) {}
+
+    /// Reads back the spilled inputs of a snapshot.
+    pub fn restore(
+        &self,
+        construct_did: &ConstructDid,
+        snapshot: &mut CommandSnapshot,
+    ) -> Result<(), Diagnostic> {
+        let Some(spilled_inputs) = self.entries.get(construct_did) else {
+            return Ok(());
+        };
+        for (input_name, path) in spilled_inputs.iter() {
+            let Some(input) = snapshot.inputs.get_mut(input_name) else {
+                continue;
+            };
+            let file = std::fs::File::open(path).map_err(|e| {
+                diagnosed_error!("unable to read spilled input '{}': {}", input_name, e)
+            })?;
+            input.value_post_evaluation = serde_json::from_reader(std::io::BufReader::new(file))
+                .map_err(|e| {
+                    diagnosed_error!("unable to read spilled input '{}': {}", input_name, e)
+                })?;
+        }
+        Ok(())
+    }
+
+    /// Forgets the spilled inputs of a command, when its snapshot is discarded.
+    pub fn discard(&mut self, construct_did: &ConstructDid) {
+        // files are shared with the copies of the execution context, and reclaimed with the
+        // directory
+        self.entries.remove(construct_did);
+    }
+
+    pub fn contains(&self, construct_did: &ConstructDid, input_name: &str) -> bool {
+        self.entries.get(construct_did).map(|e| e.contains_key(input_name)).unwrap_or(false)
+    }
+
+    #[cfg(not(feature = "wasm"))]
+    fn write(&mut self, value: &ValuePostEvaluation) -> Result<PathBuf, String> {
+        let directory = match &self.directory {
+            Some(directory) => directory.clone(),
+            None => {
+                let mut path = std::env::temp_dir();
+                path.push(format!("txtx-snapshots-{}", txtx_addon_kit::uuid::Uuid::new_v4()));
+                std::fs::create_dir_all(&path).map_err(|e| e.to_string())?;
+                let directory = Arc::new(SpillDirectory { path });
+                self.directory = Some(directory.clone());
+                directory
+            }
+        };
+        // copies of the execution context share the directory, file names are unique across them
+        let mut path = directory.path.clone();
+        path.push(format!("{}.json", txtx_addon_kit::uuid::Uuid::new_v4().simple()));
+        let file = std::fs::File::create(&path).map_err(|e| e.to_string())?;
+        let mut writer = std::io::BufWriter::new(file);
+        serde_json::to_writer(&mut writer, value).map_err(|e| e.to_string())?;
+        std::io::Write::flush(&mut writer).map_err(|e| e.to_string())?;
+        Ok(path)
+    }
+}
+
+fn estimate_value_post_evaluation_size(value: &ValuePostEvaluation) -> usize {
+    match value {
+        ValuePostEvaluation::Value(value) => estimate_value_size(value),
+        ValuePostEvaluation::ObjectValue(props) => {
+            props.iter().map(|(k, (v, _))| k.len() + estimate_value_size(v)).sum()
+        }
+        ValuePostEvaluation::MapValue(entries) => entries
+            .iter()
+            .flat_map(|props| props.iter())
+            .map(|(k, (v, _))| k.len() + estimate_value_size(v))
+            .sum(),
+    }
+}
+
+/// Rough size of the serialized value, buffers being hex encoded.
+fn estimate_value_size(value: &Value) -> usize {
+    match value {
+        Value::String(string) => string.len(),
+        Value::Buffer(bytes) => bytes.len() * 2,
+        Value::Addon(addon_data) => addon_data.bytes.len() * 2,
+        Value::Array(values) => values.iter().map(estimate_value_size).sum(),
+        Value::Object(props) => props.iter().map(|(k, v)| k.len() + estimate_value_size(v)).sum(),
+        Value::Bool(_) | Value::Null | Value::Integer(_) | Value::Float(_) => 8,
+    }
+}
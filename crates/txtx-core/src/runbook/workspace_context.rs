@@ -1,4 +1,5 @@
 use std::collections::{BTreeMap, HashMap, HashSet, VecDeque};
+use std::sync::Arc;
 
 use crate::runbook::embedded_runbook::EmbeddedRunbookInstanceBuilder;
 use crate::runbook::RawHclContent;
@@ -431,7 +432,7 @@ impl RunbookWorkspaceContext {
     /// Returns the new [ConstructDid]
     pub fn index_top_level_input(&mut self, key: &str, value: &Value) -> ConstructDid {
         let construct_did =
-            ConstructDid(Did::from_components(vec!["runbook_input".as_bytes(), key.as_bytes()]));
+            ConstructDid(Did::from_components(["runbook_input".as_bytes(), key.as_bytes()]));
         self.top_level_inputs_values.insert(construct_did.clone(), value.clone());
         self.top_level_inputs_did_lookup.insert(key.to_string(), construct_did.clone());
         construct_did
@@ -496,9 +497,9 @@ impl RunbookWorkspaceContext {
                 package.modules_dids.insert(construct_did.clone());
                 package.modules_did_lookup.insert(construct_name.clone(), construct_did.clone());
                 ConstructInstanceType::Executable(CommandInstance {
-                    specification: commands::new_module_specification(),
+                    specification: Arc::new(commands::new_module_specification()),
                     name: construct_name.clone(),
-                    block: block.clone(),
+                    block: Arc::new(block.clone()),
                     package_id: package_id.clone(),
                     namespace: construct_name.clone(),
                     typing: CommandInstanceType::Module,
@@ -508,9 +509,9 @@ impl RunbookWorkspaceContext {
                 package.variables_dids.insert(construct_did.clone());
                 package.variables_did_lookup.insert(construct_name.clone(), construct_did.clone());
                 ConstructInstanceType::Executable(CommandInstance {
-                    specification: commands::new_variable_specification(),
+                    specification: Arc::new(commands::new_variable_specification()),
                     name: construct_name.clone(),
-                    block: block.clone(),
+                    block: Arc::new(block.clone()),
                     package_id: package_id.clone(),
                     namespace: construct_name.clone(),
                     typing: CommandInstanceType::Variable,
@@ -529,9 +530,9 @@ impl RunbookWorkspaceContext {
                 package.outputs_dids.insert(construct_did.clone());
                 package.outputs_did_lookup.insert(construct_name.clone(), construct_did.clone());
                 ConstructInstanceType::Executable(CommandInstance {
-                    specification: commands::new_output_specification(),
+                    specification: Arc::new(commands::new_output_specification()),
                     name: construct_name.clone(),
-                    block: block.clone(),
+                    block: Arc::new(block.clone()),
                     package_id: package_id.clone(),
                     namespace: construct_name.clone(),
                     typing: CommandInstanceType::Output,
@@ -565,7 +566,8 @@ impl RunbookWorkspaceContext {
         graph_context.index_construct(&construct_did);
         match construct_instance_type {
             ConstructInstanceType::Executable(instance) => {
-                execution_context.commands_instances.insert(construct_did.clone(), instance);
+                Arc::make_mut(&mut execution_context.commands_instances)
+                    .insert(construct_did.clone(), instance);
             }
             ConstructInstanceType::Signing(instance) => {
                 execution_context.signers_instances.insert(construct_did.clone(), instance);
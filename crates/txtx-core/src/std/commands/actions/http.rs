@@ -1,4 +1,9 @@
-use txtx_addon_kit::reqwest::{self, Method};
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
+
+use txtx_addon_kit::indexmap::IndexMap;
+use txtx_addon_kit::reqwest::header::{HeaderMap, HeaderValue, CACHE_CONTROL, ETAG, IF_NONE_MATCH};
+use txtx_addon_kit::reqwest::{self, Method, StatusCode};
 use txtx_addon_kit::types::commands::{CommandExecutionFutureResult, PreCommandSpecification};
 use txtx_addon_kit::types::frontend::{Actions, BlockEvent};
 use txtx_addon_kit::types::stores::ValueStore;
@@ -57,6 +62,22 @@ lazy_static! {
                     optional: true,
                     tainting: true,
                     internal: false
+                },
+                cache_response: {
+                  documentation: indoc!{r#"
+                  If true, successful GET and HEAD responses are reused by identical requests for the rest of the run.
+                  Responses are reused while fresh according to their Cache-Control max-age, and revalidated with their ETag once stale."#},
+                  typing: Type::bool(),
+                  optional: true,
+                  tainting: false,
+                  internal: false
+                },
+                max_response_bytes: {
+                  documentation: "The maximum size of the response body, in bytes. The request fails if the body is larger.",
+                  typing: Type::integer(),
+                  optional: true,
+                  tainting: true,
+                  internal: false
                 }
             ],
             outputs: [
@@ -82,6 +103,145 @@ lazy_static! {
         }
     };
 }
+
+/// Bodies larger than this are never pre-allocated from their announced `Content-Length`.
+const MAX_PREALLOCATED_BODY_BYTES: u64 = 16 * 1024 * 1024;
+/// Bodies larger than this are not cached.
+const MAX_CACHED_BODY_BYTES: usize = 1024 * 1024;
+/// Total size of the bodies cached during a run, the least recently stored responses being
+/// evicted first.
+const MAX_CACHED_BODIES_BYTES: usize = 16 * 1024 * 1024;
+
+/// HTTP resources of a run, dropped with it: the connections pooled by the client are bound to
+/// the runtime executing the run, and cached responses are not shared across runs.
+struct HttpRunResources {
+    /// Client shared by the requests of the run: connections are kept alive and reused, instead
+    /// of paying a connection setup and TLS handshake per request.
+    client: reqwest::Client,
+    responses_cache: Mutex<HttpResponsesCache>,
+}
+
+impl HttpRunResources {
+    fn new() -> Self {
+        Self {
+            client: reqwest::Client::new(),
+            responses_cache: Mutex::new(HttpResponsesCache::new(MAX_CACHED_BODIES_BYTES)),
+        }
+    }
+}
+
+/// Responses of the requests opting in `cache_response`, by method, url and headers, in the
+/// order they were stored.
+#[derive(Debug)]
+struct HttpResponsesCache {
+    responses: IndexMap<String, CachedHttpResponse>,
+    bodies_bytes: usize,
+    max_bodies_bytes: usize,
+}
+
+impl HttpResponsesCache {
+    fn new(max_bodies_bytes: usize) -> Self {
+        Self { responses: IndexMap::new(), bodies_bytes: 0, max_bodies_bytes }
+    }
+
+    fn get(&self, key: &str) -> Option<CachedHttpResponse> {
+        self.responses.get(key).cloned()
+    }
+
+    fn insert(&mut self, key: String, response: CachedHttpResponse) {
+        if let Some(previous) = self.responses.shift_remove(&key) {
+            self.bodies_bytes -= previous.response_body.len();
+        }
+        let body_bytes = response.response_body.len();
+        if body_bytes > self.max_bodies_bytes {
+            return;
+        }
+        if self.bodies_bytes + body_bytes > self.max_bodies_bytes {
+            // stale responses without an ETag can't be revalidated, they are dropped first
+            let now = Instant::now();
+            self.responses.retain(|_, cached| cached.etag.is_some() || now < cached.fresh_until);
+            self.bodies_bytes = self.responses.values().map(|r| r.response_body.len()).sum();
+        }
+        while self.bodies_bytes + body_bytes > self.max_bodies_bytes {
+            let Some((_, evicted)) = self.responses.shift_remove_index(0) else {
+                break;
+            };
+            self.bodies_bytes -= evicted.response_body.len();
+        }
+        self.bodies_bytes += body_bytes;
+        self.responses.insert(key, response);
+    }
+}
+
+#[derive(Clone, Debug)]
+struct CachedHttpResponse {
+    status_code: u16,
+    response_body: String,
+    etag: Option<HeaderValue>,
+    /// The response can be reused without revalidation until then
+    fresh_until: Instant,
+}
+
+impl CachedHttpResponse {
+    fn into_execution_result(self) -> CommandExecutionResult {
+        let mut result = CommandExecutionResult::new();
+        result.outputs.insert(format!("status_code"), Value::integer(self.status_code.into()));
+        result.outputs.insert(format!("response_body"), Value::string(self.response_body));
+        result
+    }
+}
+
+/// Returns how long a response can be reused without revalidation, from its Cache-Control
+/// header, or `None` if the response must not be stored.
+fn response_freshness(headers: &HeaderMap) -> Option<Duration> {
+    let Some(cache_control) = headers.get(CACHE_CONTROL).and_then(|v| v.to_str().ok()) else {
+        return Some(Duration::ZERO);
+    };
+    let mut max_age = Duration::ZERO;
+    let mut no_cache = false;
+    for directive in cache_control.split(',').map(|d| d.trim().to_ascii_lowercase()) {
+        if directive == "no-store" {
+            return None;
+        }
+        if directive == "no-cache" {
+            no_cache = true;
+        }
+        if let Some(age) = directive.strip_prefix("max-age=") {
+            if let Ok(age) = age.trim_matches('"').parse::<u64>() {
+                max_age = Duration::from_secs(age);
+            }
+        }
+    }
+    Some(if no_cache { Duration::ZERO } else { max_age })
+}
+
+/// Reads the response body chunk by chunk, failing as soon as it exceeds `max_response_bytes`.
+async fn read_response_body(
+    mut res: reqwest::Response,
+    max_response_bytes: Option<usize>,
+) -> Result<String, Diagnostic> {
+    let announced = res.content_length().unwrap_or(0).min(MAX_PREALLOCATED_BODY_BYTES) as usize;
+    let mut body = Vec::with_capacity(match max_response_bytes {
+        Some(max_response_bytes) => announced.min(max_response_bytes),
+        None => announced,
+    });
+    while let Some(chunk) = res.chunk().await.map_err(|e| {
+        Diagnostic::error_from_string(format!("Failed to parse http request result: {e}"))
+    })? {
+        if let Some(max_response_bytes) = max_response_bytes {
+            if body.len() + chunk.len() > max_response_bytes {
+                return Err(diagnosed_error!(
+                    "http response body exceeds max_response_bytes ({} bytes)",
+                    max_response_bytes
+                ));
+            }
+        }
+        body.extend_from_slice(&chunk);
+    }
+    Ok(String::from_utf8(body)
+        .unwrap_or_else(|e| String::from_utf8_lossy(e.as_bytes()).into_owned()))
+}
+
 pub struct SendHttpRequest;
 
 impl CommandImplementation for SendHttpRequest {
@@ -108,9 +268,9 @@ impl CommandImplementation for SendHttpRequest {
         _spec: &CommandSpecification,
         values: &ValueStore,
         _progress_tx: &txtx_addon_kit::channel::Sender<BlockEvent>,
-        _auth_ctx: &txtx_addon_kit::types::AuthorizationContext,
+        auth_ctx: &txtx_addon_kit::types::AuthorizationContext,
     ) -> CommandExecutionFutureResult {
-        let mut result = CommandExecutionResult::new();
+        let http = auth_ctx.run_resources.get_or_init(HttpRunResources::new);
         let values = values.clone();
         let url = values.get_expected_string("url")?.to_string();
         let request_body = values.get_value("body").cloned();
@@ -119,31 +279,48 @@ impl CommandImplementation for SendHttpRequest {
             Method::try_from(value).unwrap()
         };
         let request_headers = values.get_value("headers").cloned();
+        let timeout_ms = values.get_uint("timeout_ms").map_err(|e| diagnosed_error!("{}", e))?;
+        let max_response_bytes = values
+            .get_uint("max_response_bytes")
+            .map_err(|e| diagnosed_error!("{}", e))?
+            .map(|max| max as usize);
+        let cache_response = values.get_bool("cache_response").unwrap_or(false)
+            && (method == Method::GET || method == Method::HEAD);
 
         let future = async move {
-            let request_headers = request_headers
-                .as_ref()
-                .map(|value| {
-                    value
-                        .as_object()
-                        .ok_or_else(|| diagnosed_error!("request headers must be an object"))
-                })
-                .transpose()?;
-
-            let client = reqwest::Client::new();
-            let mut req_builder = client.request(method, url);
-
+            let mut headers = vec![];
             if let Some(request_headers) = request_headers {
+                let request_headers = request_headers
+                    .as_object()
+                    .ok_or_else(|| diagnosed_error!("request headers must be an object"))?;
                 for (k, v) in request_headers.iter() {
-                    req_builder = req_builder.header(
-                        k,
-                        v.as_string().ok_or_else(|| {
-                            diagnosed_error!("request header value must be a string; found type '{}' for header '{}'", v.get_type().to_string(), k)
-                        })?,
-                    );
+                    let v = v.as_string().ok_or_else(|| {
+                        diagnosed_error!("request header value must be a string; found type '{}' for header '{}'", v.get_type().to_string(), k)
+                    })?;
+                    headers.push((k.clone(), v.to_string()));
                 }
             }
 
+            let cache_key = cache_response.then(|| format!("{} {} {:?}", method, url, headers));
+            let cached =
+                cache_key.as_ref().and_then(|key| http.responses_cache.lock().unwrap().get(key));
+            if let Some(cached) = cached.as_ref() {
+                if Instant::now() < cached.fresh_until {
+                    return Ok(cached.clone().into_execution_result());
+                }
+            }
+
+            let mut req_builder = http.client.request(method, url);
+            for (k, v) in headers.iter() {
+                req_builder = req_builder.header(k, v);
+            }
+            if let Some(etag) = cached.as_ref().and_then(|cached| cached.etag.clone()) {
+                req_builder = req_builder.header(IF_NONE_MATCH, etag);
+            }
+            if let Some(timeout_ms) = timeout_ms {
+                req_builder = req_builder.timeout(Duration::from_millis(timeout_ms));
+            }
+
             if let Some(request_body) = request_body {
                 if request_body.as_object().is_some() {
                     req_builder = req_builder.json(&request_body.to_json(None));
@@ -157,17 +334,35 @@ impl CommandImplementation for SendHttpRequest {
             })?;
 
             let status_code = res.status();
-            let response_body = res.text().await.map_err(|e| {
-                Diagnostic::error_from_string(format!("Failed to parse http request result: {e}"))
-            })?;
+            let freshness = response_freshness(res.headers());
+            let etag = res.headers().get(ETAG).cloned();
 
-            result
-                .outputs
-                .insert(format!("status_code"), Value::integer(status_code.as_u16().into()));
+            let response = match (status_code, cached) {
+                // the cached response was revalidated by the server
+                (StatusCode::NOT_MODIFIED, Some(mut cached)) => {
+                    cached.fresh_until = Instant::now() + freshness.unwrap_or_default();
+                    cached.etag = etag.or(cached.etag);
+                    cached
+                }
+                _ => CachedHttpResponse {
+                    status_code: status_code.as_u16(),
+                    response_body: read_response_body(res, max_response_bytes).await?,
+                    etag,
+                    fresh_until: Instant::now() + freshness.unwrap_or_default(),
+                },
+            };
 
-            result.outputs.insert(format!("response_body"), Value::string(response_body));
+            if let (Some(cache_key), Some(freshness)) = (cache_key, freshness) {
+                let reusable = !freshness.is_zero() || response.etag.is_some();
+                if StatusCode::from_u16(response.status_code).map_or(false, |s| s.is_success())
+                    && reusable
+                    && response.response_body.len() <= MAX_CACHED_BODY_BYTES
+                {
+                    http.responses_cache.lock().unwrap().insert(cache_key, response.clone());
+                }
+            }
 
-            Ok::<CommandExecutionResult, Diagnostic>(result)
+            Ok::<CommandExecutionResult, Diagnostic>(response.into_execution_result())
         };
         #[cfg(feature = "wasm")]
         panic!("async commands are not enabled for wasm");
@@ -175,3 +370,66 @@ impl CommandImplementation for SendHttpRequest {
         Ok(Box::pin(future))
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use std::time::{Duration, Instant};
+
+    use txtx_addon_kit::reqwest::header::{HeaderMap, HeaderValue, CACHE_CONTROL};
+
+    use super::{response_freshness, CachedHttpResponse, HttpResponsesCache};
+
+    fn freshness(cache_control: Option<&'static str>) -> Option<Duration> {
+        let mut headers = HeaderMap::new();
+        if let Some(cache_control) = cache_control {
+            headers.insert(CACHE_CONTROL, HeaderValue::from_static(cache_control));
+        }
+        response_freshness(&headers)
+    }
+
+    #[test]
+    fn it_reads_response_freshness_from_cache_control() {
+        assert_eq!(freshness(None), Some(Duration::ZERO));
+        assert_eq!(freshness(Some("public, max-age=60")), Some(Duration::from_secs(60)));
+        assert_eq!(freshness(Some("max-age=60, no-cache")), Some(Duration::ZERO));
+        assert_eq!(freshness(Some("private, no-store, max-age=60")), None);
+    }
+
+    fn cached_response(body_bytes: usize, etag: bool, fresh_for: Duration) -> CachedHttpResponse {
+        CachedHttpResponse {
+            status_code: 200,
+            response_body: "x".repeat(body_bytes),
+            etag: etag.then(|| HeaderValue::from_static("\"v1\"")),
+            fresh_until: Instant::now() + fresh_for,
+        }
+    }
+
+    #[test]
+    fn it_bounds_the_responses_cache() {
+        let fresh = Duration::from_secs(60);
+        let mut cache = HttpResponsesCache::new(100);
+        cache.insert("a".into(), cached_response(40, true, fresh));
+        cache.insert("b".into(), cached_response(40, true, fresh));
+        cache.insert("c".into(), cached_response(40, true, fresh));
+        // the least recently stored response is evicted
+        assert!(cache.get("a").is_none());
+        assert!(cache.get("b").is_some() && cache.get("c").is_some());
+        assert_eq!(cache.bodies_bytes, 80);
+
+        // stale responses that can't be revalidated are dropped before fresh ones
+        let mut cache = HttpResponsesCache::new(100);
+        cache.insert("a".into(), cached_response(40, true, fresh));
+        cache.insert("b".into(), cached_response(40, false, Duration::ZERO));
+        cache.insert("c".into(), cached_response(40, false, fresh));
+        assert!(cache.get("a").is_some() && cache.get("c").is_some());
+        assert!(cache.get("b").is_none());
+
+        // replacing a response releases the size of the previous one
+        cache.insert("c".into(), cached_response(10, false, fresh));
+        assert_eq!(cache.bodies_bytes, 50);
+
+        cache.insert("d".into(), cached_response(101, true, fresh));
+        assert!(cache.get("d").is_none());
+        assert_eq!(cache.bodies_bytes, 50);
+    }
+}
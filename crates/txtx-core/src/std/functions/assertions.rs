@@ -522,7 +522,7 @@ mod tests {
     }
 
     fn dummy_auth_ctx() -> AuthorizationContext {
-        AuthorizationContext { workspace_location: FileLocation::working_dir() }
+        AuthorizationContext::new(FileLocation::working_dir())
     }
 
     #[test_case("assert_eq", Value::Integer(5), Value::Integer(5), AssertionResult::Success; "assert_eq success")]
@@ -1,4 +1,6 @@
 use super::{arg_checker, to_diag};
+use txtx_addon_kit::helpers::{base58, hex};
+use txtx_addon_kit::types::AuthorizationContext;
 use txtx_addon_kit::{
     define_function, indoc,
     types::{
@@ -7,7 +9,6 @@ use txtx_addon_kit::{
         types::{Type, Value},
     },
 };
-use txtx_addon_kit::{hex, types::AuthorizationContext};
 
 lazy_static! {
     pub static ref FUNCTIONS: Vec<FunctionSpecification> = vec![define_function! {
@@ -50,13 +51,24 @@ impl FunctionImplementation for Base58Encode {
         args: &Vec<Value>,
     ) -> Result<Value, Diagnostic> {
         arg_checker(fn_spec, args)?;
-        let hex = args.get(0).unwrap().to_string();
-        let hex = if hex.starts_with("0x") { &hex[2..] } else { &hex[..] };
-
-        let bytes = hex::decode(hex)
-            .map_err(|e| to_diag(fn_spec, format!("failed to decode hex string {}: {}", hex, e)))?;
+        let decoded;
+        let bytes: &[u8] = match args.get(0).unwrap() {
+            Value::Addon(addon_data) => &addon_data.bytes,
+            Value::Buffer(bytes) => bytes,
+            value => {
+                let hex = value.to_string();
+                decoded = hex::decode_prefixed(&hex).map_err(|e| {
+                    to_diag(fn_spec, format!("failed to decode hex string {}: {}", hex, e))
+                })?;
+                &decoded
+            }
+        };
 
-        let encoded = bs58::encode(bytes).into_string();
-        Ok(Value::string(format!("{}", encoded)))
+        // 32 byte values (public keys, hashes) are by far the most common input
+        let encoded = match <&[u8; 32]>::try_from(bytes) {
+            Ok(bytes) => base58::encode_32(bytes),
+            Err(_) => bs58::encode(bytes).into_string(),
+        };
+        Ok(Value::string(encoded))
     }
 }
@@ -56,7 +56,6 @@ impl FunctionImplementation for Base64Decode {
                 encoded, e
             ))
         })?;
-        let decoded = txtx_addon_kit::hex::encode(decoded);
-        Ok(Value::string(format!("0x{decoded}")))
+        Ok(Value::string(txtx_addon_kit::helpers::hex::encode_prefixed(decoded)))
     }
 }
@@ -63,8 +63,9 @@ impl FunctionImplementation for Secp256k1Recover {
         let recovery_id = RecoveryId::parse(signature_bytes[0]).unwrap();
         let signature = Signature::parse_standard_slice(&signature_bytes[1..]).unwrap();
         let public_key = recover(&message, &signature, &recovery_id).unwrap();
-        let public_key_hex = txtx_addon_kit::hex::encode(public_key.serialize_compressed());
+        let public_key_hex =
+            txtx_addon_kit::helpers::hex::encode_prefixed(public_key.serialize_compressed());
 
-        Ok(Value::string(format!("0x{}", public_key_hex)))
+        Ok(Value::string(public_key_hex))
     }
 }
@@ -49,7 +49,7 @@ impl FunctionImplementation for EncodeHex {
         args: &Vec<Value>,
     ) -> Result<Value, Diagnostic> {
         let input = args.get(0).unwrap().expect_string();
-        let hex = txtx_addon_kit::hex::encode(input);
+        let hex = txtx_addon_kit::helpers::hex::encode(input);
         Ok(Value::string(hex))
     }
 }
@@ -1,13 +1,28 @@
+use txtx_addon_kit::channel::Sender;
+use txtx_addon_kit::define_command;
 use txtx_addon_kit::types::{
+    cloud_interface::CloudServiceContext,
+    commands::{
+        return_synchronous_result, CommandExecutionFutureResult, CommandExecutionResult,
+        CommandImplementation, CommandSpecification, PreCommandSpecification,
+    },
+    diagnostics::Diagnostic,
     frontend::{
-        ActionItemResponse, ActionItemResponseType, ActionItemStatus, ProvidedInputResponse,
+        ActionItemResponse, ActionItemResponseType, ActionItemStatus, ActionPanelData, Actions,
+        BlockEvent, NormalizedActionItemRequestUpdate, ProvidedInputResponse,
         ReviewedInputResponse,
     },
-    types::Value,
+    stores::ValueStore,
+    types::{RunbookSupervisionContext, Type, Value},
+    AuthorizationContext, ConstructDid,
 };
+use txtx_addon_kit::uuid::Uuid;
 use txtx_addon_kit::{types::block_id::BlockId, Addon};
-use txtx_test_utils::test_harness::setup_test;
+use txtx_test_utils::test_harness::{
+    build_runbook_from_fixture, setup_test, setup_test_with_queued_responses,
+};
 
+use crate::runbook::{ConsolidatedPlanChanges, InputsRetentionPolicy, RunbookSnapshotContext};
 use crate::std::StdAddon;
 
 pub fn get_addon_by_namespace(namespace: &str) -> Option<Box<dyn Addon>> {
@@ -113,3 +128,452 @@ fn test_ab_c_runbook_no_env() {
 
     harness.expect_runbook_complete();
 }
+
+/// Reviews the inputs of ab_c.tx and updates the value of `b`. The responses are sent one at a
+/// time and returned, or when `queued_responses` are provided, these are queued before the
+/// runloop starts and drained at once. Returns the action item updates of each event received
+/// once the runbook started, the output review panel, and the responses.
+fn review_ab_c_inputs(
+    queued_responses: Option<Vec<ActionItemResponse>>,
+) -> (Vec<Vec<NormalizedActionItemRequestUpdate>>, ActionPanelData, Vec<ActionItemResponse>) {
+    let abc_tx = include_str!("./fixtures/ab_c.tx");
+    let harness = setup_test_with_queued_responses(
+        "ab_c.tx",
+        &abc_tx,
+        get_addon_by_namespace,
+        queued_responses.as_deref().unwrap_or(&[]),
+    );
+    let send = |response: &ActionItemResponse| {
+        if queued_responses.is_none() {
+            harness.send(response);
+        }
+    };
+
+    let action_panel_data = harness.expect_action_panel(None, "runbook checklist", vec![vec![1]]);
+    let start_runbook = &action_panel_data.groups[0].sub_groups[0].action_items[0];
+    let validate_start = ActionItemResponse {
+        action_item_id: start_runbook.id.clone(),
+        payload: ActionItemResponseType::ValidateBlock,
+    };
+    send(&validate_start);
+    harness.expect_action_item_update(
+        Some(validate_start.clone()),
+        vec![(&start_runbook.id, Some(ActionItemStatus::Success(None)))],
+    );
+
+    let inputs_panel_data = harness.expect_action_panel(None, "variables review", vec![vec![2, 1]]);
+    let input_a_action = &inputs_panel_data.groups[0].sub_groups[0].action_items[0];
+    let input_b_action = &inputs_panel_data.groups[0].sub_groups[0].action_items[1];
+    let review = |action_item_id| ActionItemResponse {
+        action_item_id,
+        payload: ActionItemResponseType::ReviewInput(ReviewedInputResponse {
+            value_checked: true,
+            input_name: "value".into(),
+            force_execution: true,
+        }),
+    };
+    let review_a = review(input_a_action.id.clone());
+    let provide_b = ActionItemResponse {
+        action_item_id: input_b_action.id.clone(),
+        payload: ActionItemResponseType::ProvideInput(ProvidedInputResponse {
+            updated_value: Value::integer(5),
+            input_name: "value".into(),
+        }),
+    };
+    let review_b = review(input_b_action.id.clone());
+    let responses = vec![validate_start, review_a, provide_b, review_b];
+    if let Some(queued_responses) = queued_responses.as_ref() {
+        // the action items ids are stable within a process, the queued responses target this run
+        assert_eq!(
+            serde_json::to_value(queued_responses).unwrap(),
+            serde_json::to_value(&responses).unwrap()
+        );
+    }
+
+    let mut updates = vec![];
+    let mut receive_updates = |count: usize| {
+        for _ in 0..count {
+            updates.push(harness.receive_event().expect_updated_action_items().clone());
+        }
+    };
+    if queued_responses.is_some() {
+        // the statuses of the reviewed inputs, then the evaluation pass
+        receive_updates(2);
+    } else {
+        send(&responses[1]);
+        receive_updates(2);
+        // provided inputs are applied without any event
+        send(&responses[2]);
+        harness.expect_noop();
+        send(&responses[3]);
+        receive_updates(2);
+    }
+    harness.expect_noop();
+
+    harness.send(&ActionItemResponse {
+        action_item_id: BlockId::new(&vec![]),
+        payload: ActionItemResponseType::ValidateBlock,
+    });
+    harness.receive_event().expect_updated_action_items();
+    let output_panel_data = harness.expect_action_panel(None, "output review", vec![vec![1]]);
+    harness.expect_runbook_complete();
+    (updates, output_panel_data, responses)
+}
+
+#[test]
+fn test_burst_of_responses_is_evaluated_once() {
+    let (sequential_updates, sequential_outputs, responses) = review_ab_c_inputs(None);
+    let (batched_updates, batched_outputs, _) = review_ab_c_inputs(Some(responses));
+
+    // one evaluation pass per response, against one for the whole burst
+    assert_eq!(sequential_updates.len(), 4);
+    assert_eq!(batched_updates.len(), 2);
+
+    // the statuses of the reviewed inputs are updated at once
+    let sequential_statuses = [&sequential_updates[0][..], &sequential_updates[2][..]].concat();
+    assert_eq!(
+        serde_json::to_value(&batched_updates[0]).unwrap(),
+        serde_json::to_value(&sequential_statuses).unwrap()
+    );
+    // and the runbook reaches the same state
+    assert_eq!(
+        serde_json::to_value(&batched_updates[1]).unwrap(),
+        serde_json::to_value(&sequential_updates[3]).unwrap()
+    );
+    assert_eq!(
+        serde_json::to_value(&batched_outputs).unwrap(),
+        serde_json::to_value(&sequential_outputs).unwrap()
+    );
+    let output = &batched_outputs.groups[0].sub_groups[0].action_items[0];
+    let output = output.action_type.as_display_output().unwrap();
+    assert_eq!(output.value, Value::integer(6));
+}
+
+#[test]
+fn test_targeted_execution_skips_unrelated_constructs() {
+    use txtx_addon_kit::futures::executor::block_on;
+
+    let fixture = r#"
+variable "a" {
+    value = 1
+}
+variable "b" {
+    value = variable.a + 1
+}
+variable "c" {
+    value = variable.b + 1
+}
+output "b_out" {
+    value = variable.b
+}
+output "c_out" {
+    value = variable.c
+}
+"#;
+    let mut runbook =
+        block_on(build_runbook_from_fixture("targets.tx", fixture, get_addon_by_namespace))
+            .expect("unable to build runbook from fixture");
+    runbook.enable_full_execution_mode();
+    assert!(runbook.resolve_targets(&vec!["output.d_out".into()]).is_err());
+    let targets_closures = runbook.resolve_targets(&vec!["output.b_out".into()]).unwrap();
+
+    // constructs added out of the targets are neither reported nor executed
+    let flow_context = &runbook.flow_contexts[0];
+    let mut plan_changes = ConsolidatedPlanChanges::new();
+    plan_changes.new_constructs_to_add = flow_context
+        .execution_context
+        .order_for_commands_execution
+        .iter()
+        .map(|construct_did| (construct_did.clone(), None))
+        .collect();
+    let plans_to_update =
+        txtx_addon_kit::indexmap::IndexMap::from([(flow_context.name.clone(), plan_changes)]);
+    let (_, actions_to_execute) =
+        runbook.prepared_flows_for_updated_plans(&plans_to_update, Some(&targets_closures));
+    let mut added = actions_to_execute
+        .values()
+        .next()
+        .unwrap()
+        .iter()
+        .map(|(name, _)| name.clone())
+        .collect::<Vec<_>>();
+    added.sort();
+    assert_eq!(added, vec!["a", "b", "b_out"]);
+
+    let constructs_to_execute = runbook.restrict_flows_to_targets(&targets_closures);
+    assert_eq!(constructs_to_execute, 3);
+
+    let (progress_tx, _progress_rx) = txtx_addon_kit::channel::unbounded();
+    block_on(crate::start_unsupervised_runbook_runloop(&mut runbook, &progress_tx))
+        .expect("unable to execute runbook");
+
+    let execution_context = &runbook.flow_contexts[0].execution_context;
+    let mut executed = execution_context
+        .commands_execution_results
+        .keys()
+        .filter_map(|c| execution_context.commands_instances.get(c))
+        .map(|c| c.name.clone())
+        .collect::<Vec<_>>();
+    executed.sort();
+    assert_eq!(executed, vec!["a", "b", "b_out"]);
+}
+
+#[test]
+fn test_recorded_commands_snapshots_match_rebuilt_snapshots() {
+    use txtx_addon_kit::futures::executor::block_on;
+
+    let fixture = include_str!("./fixtures/sorting/4.tx");
+    let mut runbook =
+        block_on(build_runbook_from_fixture("snapshots.tx", fixture, get_addon_by_namespace))
+            .expect("unable to build runbook from fixture");
+    runbook.enable_full_execution_mode();
+    // snapshots are rebuilt below from the evaluated inputs
+    for flow_context in runbook.flow_contexts.iter_mut() {
+        flow_context.execution_context.inputs_retention_policy = InputsRetentionPolicy::RetainAll;
+    }
+    let (progress_tx, _progress_rx) = txtx_addon_kit::channel::unbounded();
+    block_on(crate::start_unsupervised_runbook_runloop(&mut runbook, &progress_tx))
+        .expect("unable to execute runbook");
+
+    let execution_context = &runbook.flow_contexts[0].execution_context;
+    for construct_did in execution_context.commands_instances.keys() {
+        assert!(execution_context.commands_snapshots.contains_key(construct_did));
+    }
+
+    let ctx = RunbookSnapshotContext::new();
+    let assembled = ctx
+        .snapshot_runbook_execution(
+            &runbook.runbook_id,
+            &runbook.flow_contexts,
+            None,
+            &runbook.top_level_inputs_map,
+        )
+        .unwrap();
+    let mut flow_contexts = runbook.flow_contexts.clone();
+    for flow_context in flow_contexts.iter_mut() {
+        flow_context.execution_context.commands_snapshots.clear();
+    }
+    let rebuilt = ctx
+        .snapshot_runbook_execution(
+            &runbook.runbook_id,
+            &flow_contexts,
+            None,
+            &runbook.top_level_inputs_map,
+        )
+        .unwrap();
+    assert_eq!(
+        serde_json::to_value(&assembled.flows).unwrap(),
+        serde_json::to_value(&rebuilt.flows).unwrap()
+    );
+}
+
+#[test]
+fn test_completed_commands_inputs_are_released() {
+    use txtx_addon_kit::futures::executor::block_on;
+
+    let large_value = "a".repeat(crate::runbook::snapshot_spill::SPILL_THRESHOLD_BYTES);
+    let fixture = format!(
+        r#"
+variable "small" {{
+    value = "some value"
+}}
+variable "large" {{
+    value = "{large_value}"
+}}
+output "b" {{
+    value = variable.large
+}}
+"#
+    );
+    let mut runbook =
+        block_on(build_runbook_from_fixture("release.tx", &fixture, get_addon_by_namespace))
+            .expect("unable to build runbook from fixture");
+    runbook.enable_full_execution_mode();
+    let (progress_tx, _progress_rx) = txtx_addon_kit::channel::unbounded();
+    block_on(crate::start_unsupervised_runbook_runloop(&mut runbook, &progress_tx))
+        .expect("unable to execute runbook");
+
+    let execution_context = &runbook.flow_contexts[0].execution_context;
+    for (construct_did, command_instance) in execution_context.commands_instances.iter() {
+        let retained =
+            execution_context.commands_inputs_evaluation_results.contains_key(construct_did);
+        // outputs are displayed at the end of the run
+        assert_eq!(retained, command_instance.name == "b");
+        // released inputs are moved to the snapshot, the large ones being spilled to disk
+        let snapshot = execution_context.commands_snapshots.get(construct_did).unwrap();
+        let spilled = execution_context.spilled_snapshots_values.contains(construct_did, "value");
+        assert_eq!(spilled, command_instance.name == "large");
+        if spilled {
+            let in_memory = snapshot.inputs.get("value").unwrap();
+            assert_eq!(in_memory.value_post_evaluation.as_value(), Some(&Value::null()));
+        }
+        let restored =
+            execution_context.get_recorded_command_snapshot(construct_did).unwrap().unwrap();
+        let value = restored.inputs.get("value").unwrap().value_post_evaluation.as_value();
+        if command_instance.name != "small" {
+            assert_eq!(value, Some(&Value::string(large_value.clone())));
+        }
+    }
+
+    // spilled values are read back when the runbook snapshot is assembled
+    let snapshot = RunbookSnapshotContext::new()
+        .snapshot_runbook_execution(
+            &runbook.runbook_id,
+            &runbook.flow_contexts,
+            None,
+            &runbook.top_level_inputs_map,
+        )
+        .unwrap();
+    let serialized = serde_json::to_string(&snapshot).unwrap();
+    assert!(serialized.contains(&large_value));
+}
+
+/// Addon whose `test::echo` action returns its input from a background task, as transactions
+/// sending actions do with their receipts.
+#[derive(Debug)]
+struct BackgroundTaskAddon;
+
+impl Addon for BackgroundTaskAddon {
+    fn get_name(&self) -> &str {
+        "Background task"
+    }
+
+    fn get_description(&self) -> &str {
+        ""
+    }
+
+    fn get_namespace(&self) -> &str {
+        "test"
+    }
+
+    fn get_actions(&self) -> Vec<PreCommandSpecification> {
+        vec![define_command! {
+            BackgroundEcho => {
+                name: "Echo",
+                matcher: "echo",
+                documentation: "Returns its input from a background task.",
+                implements_signing_capability: false,
+                implements_background_task_capability: true,
+                inputs: [
+                    value: {
+                        documentation: "The value to return.",
+                        typing: Type::string(),
+                        optional: false,
+                        tainting: true,
+                        internal: false
+                    }
+                ],
+                outputs: [
+                    value: {
+                        documentation: "The value returned.",
+                        typing: Type::string()
+                    }
+                ],
+                example: "",
+            }
+        }]
+    }
+}
+
+struct BackgroundEcho;
+
+impl CommandImplementation for BackgroundEcho {
+    fn check_instantiability(
+        _ctx: &CommandSpecification,
+        _args: Vec<Type>,
+    ) -> Result<Type, Diagnostic> {
+        unimplemented!()
+    }
+
+    fn check_executability(
+        _construct_id: &ConstructDid,
+        _instance_name: &str,
+        _spec: &CommandSpecification,
+        _values: &ValueStore,
+        _supervision_context: &RunbookSupervisionContext,
+        _auth_context: &AuthorizationContext,
+    ) -> Result<Actions, Diagnostic> {
+        Ok(Actions::none())
+    }
+
+    fn run_execution(
+        _construct_id: &ConstructDid,
+        _spec: &CommandSpecification,
+        _values: &ValueStore,
+        _progress_tx: &Sender<BlockEvent>,
+        _auth_context: &AuthorizationContext,
+    ) -> CommandExecutionFutureResult {
+        return_synchronous_result(Ok(CommandExecutionResult::new()))
+    }
+
+    fn build_background_task(
+        _construct_did: &ConstructDid,
+        _spec: &CommandSpecification,
+        values: &ValueStore,
+        _outputs: &ValueStore,
+        _progress_tx: &Sender<BlockEvent>,
+        _background_tasks_uuid: &Uuid,
+        _supervision_context: &RunbookSupervisionContext,
+        _cloud_service_context: &Option<CloudServiceContext>,
+        _auth_context: &AuthorizationContext,
+    ) -> CommandExecutionFutureResult {
+        let value = values.get_value("value").cloned().unwrap_or(Value::null());
+        Ok(Box::pin(async move {
+            let mut result = CommandExecutionResult::new();
+            result.outputs.insert("value".into(), value);
+            Ok(result)
+        }))
+    }
+}
+
+fn get_addon_by_namespace_with_background_tasks(namespace: &str) -> Option<Box<dyn Addon>> {
+    if namespace.starts_with("test") {
+        return Some(Box::new(BackgroundTaskAddon));
+    }
+    get_addon_by_namespace(namespace)
+}
+
+#[test]
+fn test_background_task_commands_inputs_are_released() {
+    use txtx_addon_kit::futures::executor::block_on;
+
+    let large_value = "a".repeat(crate::runbook::snapshot_spill::SPILL_THRESHOLD_BYTES);
+    let fixture = format!(
+        r#"
+addon "test" {{
+}}
+action "echo" "test::echo" {{
+    value = "{large_value}"
+}}
+output "echoed" {{
+    value = action.echo.value
+}}
+"#
+    );
+    let mut runbook = block_on(build_runbook_from_fixture(
+        "background.tx",
+        &fixture,
+        get_addon_by_namespace_with_background_tasks,
+    ))
+    .expect("unable to build runbook from fixture");
+    runbook.enable_full_execution_mode();
+    let (progress_tx, _progress_rx) = txtx_addon_kit::channel::unbounded();
+    block_on(crate::start_unsupervised_runbook_runloop(&mut runbook, &progress_tx))
+        .expect("unable to execute runbook");
+
+    let execution_context = &runbook.flow_contexts[0].execution_context;
+    let (echo_did, _) = execution_context
+        .commands_instances
+        .iter()
+        .find(|(_, command_instance)| command_instance.name == "echo")
+        .unwrap();
+    let execution_result = execution_context.commands_execution_results.get(echo_did).unwrap();
+    assert_eq!(execution_result.outputs.get("value"), Some(&Value::string(large_value.clone())));
+
+    // the snapshot is recorded once the background task completed, and the inputs released
+    assert!(!execution_context.commands_inputs_evaluation_results.contains_key(echo_did));
+    assert!(execution_context.spilled_snapshots_values.contains(echo_did, "value"));
+    let restored = execution_context.get_recorded_command_snapshot(echo_did).unwrap().unwrap();
+    let value = restored.inputs.get("value").unwrap().value_post_evaluation.as_value();
+    assert_eq!(value, Some(&Value::string(large_value)));
+}
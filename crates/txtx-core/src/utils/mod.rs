@@ -1,6 +1,6 @@
 use kit::{helpers::fs::FileLocation, types::types::AddonJsonConverter};
 
-use crate::runbook::RunbookOutputs;
+use crate::runbook::{RunbookOutputs, RunbookOutputsFormat};
 
 pub fn try_write_outputs_to_file(
     output_loc: &str,
@@ -9,11 +9,8 @@ pub fn try_write_outputs_to_file(
     runbook_id: &str,
     environment: &str,
     addon_converters: &Vec<AddonJsonConverter>,
+    format: &RunbookOutputsFormat,
 ) -> Result<FileLocation, String> {
-    let json_outputs = runbook_outputs.to_json(addon_converters);
-    let output = serde_json::to_string_pretty(&json_outputs)
-        .map_err(|e| format!("failed to serialize outputs: {e}"))?;
-
     let mut output_location = workspace_location
         .get_parent_location()
         .map_err(|e| format!("failed to write to output file: {e}"))?;
@@ -27,11 +24,14 @@ pub fn try_write_outputs_to_file(
     let now = chrono::Local::now();
     let formatted = now.format("%Y-%m-%d--%H-%M-%S").to_string();
     output_location
-        .append_path(&format!("{}_{}.output.json", runbook_id, formatted))
+        .append_path(&format!("{}_{}.output.{}", runbook_id, formatted, format.file_extension()))
         .map_err(|e| format!("invalid output file path: {e}"))?;
 
-    output_location
-        .write_content(output.as_bytes())
+    let writer = output_location
+        .get_buffered_writer()
+        .map_err(|e| format!("failed to write to output file: {e}"))?;
+    runbook_outputs
+        .write_to(writer, addon_converters, format)
         .map_err(|e| format!("failed to write to output file: {e}"))?;
 
     Ok(output_location)
@@ -0,0 +1,69 @@
+//! Allocation benchmark of the constructs evaluation. It lives in its own test binary, so that
+//! the counting allocator does not replace the allocator of the unit tests.
+//!
+//! cargo test -p txtx-core --test evaluation_allocations -- --ignored --nocapture
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+use txtx_addon_kit::futures::executor::block_on;
+use txtx_addon_kit::Addon;
+use txtx_core::std::StdAddon;
+use txtx_test_utils::test_harness::build_runbook_from_fixture;
+
+struct CountingAllocator;
+
+static ALLOCATIONS: AtomicUsize = AtomicUsize::new(0);
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAllocator = CountingAllocator;
+
+fn get_addon_by_namespace(namespace: &str) -> Option<Box<dyn Addon>> {
+    let addon = StdAddon::new();
+    if namespace.starts_with(addon.get_namespace()) {
+        return Some(Box::new(addon));
+    }
+    None
+}
+
+#[test]
+#[ignore = "allocation benchmark, run with `--ignored --nocapture`"]
+fn bench_constructs_evaluation_allocations() {
+    const CONSTRUCTS: usize = 1000;
+    let mut fixture = String::from("variable \"v0\" {\n    value = 1\n}\n");
+    for i in 1..CONSTRUCTS - 1 {
+        fixture
+            .push_str(&format!("variable \"v{i}\" {{\n    value = variable.v{} + 1\n}}\n", i - 1));
+    }
+    fixture
+        .push_str(&format!("output \"result\" {{\n    value = variable.v{}\n}}\n", CONSTRUCTS - 2));
+
+    let mut runbook =
+        block_on(build_runbook_from_fixture("bench.tx", &fixture, get_addon_by_namespace))
+            .expect("unable to build runbook from fixture");
+    let (progress_tx, _progress_rx) = txtx_addon_kit::channel::unbounded();
+
+    let allocations_before = ALLOCATIONS.load(Ordering::Relaxed);
+    block_on(txtx_core::start_unsupervised_runbook_runloop(&mut runbook, &progress_tx))
+        .expect("unable to execute runbook");
+    let allocations = ALLOCATIONS.load(Ordering::Relaxed) - allocations_before;
+
+    println!(
+        "{CONSTRUCTS} constructs: {allocations} allocations ({} per construct)",
+        allocations / CONSTRUCTS
+    );
+}
@@ -0,0 +1,252 @@
+use std::{
+    collections::{BTreeMap, VecDeque},
+    fs::{File, OpenOptions},
+    io::{BufWriter, Write},
+};
+
+use log::warn;
+use txtx_addon_kit::types::{
+    block_id::BlockId,
+    frontend::{ActionGroup, ActionItemStatus, Block, NormalizedActionItemRequestUpdate, Panel},
+};
+
+/// Number of completed blocks kept in full detail by default.
+pub const DEFAULT_BLOCK_RETENTION: usize = 256;
+
+/// Maintains the block store shared with the supervisor over a long run.
+///
+/// Action items are indexed by the blocks holding them, so that updates are applied without
+/// scanning the whole store. Once a block is completed (all its action items succeeded), it is
+/// queued and, past the retention window, compacted into a summary keeping its uuid, title and
+/// description: it is still listed by the GraphQL queries, without its action items. The full
+/// block can be spilled to disk, as JSON lines, before being compacted.
+pub struct BlockStoreManager {
+    /// Key of the next block inserted, keys are never reused
+    next_key: usize,
+    /// Number of completed blocks kept in full detail
+    retention: usize,
+    /// Blocks holding a given action item
+    action_items_index: BTreeMap<BlockId, Vec<usize>>,
+    /// Completed blocks kept in full detail, oldest first
+    completed_blocks: VecDeque<usize>,
+    spill: Option<BufWriter<File>>,
+}
+
+impl BlockStoreManager {
+    pub fn new(retention: usize, spill_path: Option<&String>) -> Result<Self, String> {
+        let spill = match spill_path {
+            Some(path) => {
+                let file =
+                    OpenOptions::new().create(true).append(true).open(path).map_err(|e| {
+                        format!("unable to open block store spill file {}: {}", path, e)
+                    })?;
+                Some(BufWriter::new(file))
+            }
+            None => None,
+        };
+        Ok(Self {
+            next_key: 0,
+            retention,
+            action_items_index: BTreeMap::new(),
+            completed_blocks: VecDeque::new(),
+            spill,
+        })
+    }
+
+    pub fn insert(&mut self, block_store: &mut BTreeMap<usize, Block>, block: Block) {
+        let key = self.next_key;
+        self.next_key += 1;
+        for group in panel_groups(&block.panel) {
+            for sub_group in group.sub_groups.iter() {
+                for action_item in sub_group.action_items.iter() {
+                    self.action_items_index.entry(action_item.id.clone()).or_default().push(key);
+                }
+            }
+        }
+        let is_completed = is_block_completed(&block);
+        block_store.insert(key, block);
+        if is_completed {
+            self.complete_block(block_store, key);
+        }
+    }
+
+    pub fn clear(&mut self, block_store: &mut BTreeMap<usize, Block>) {
+        block_store.clear();
+        self.action_items_index.clear();
+        self.completed_blocks.clear();
+    }
+
+    /// Applies the updates to the blocks holding their action item, and returns the updates
+    /// that changed a block.
+    pub fn apply_action_item_updates(
+        &mut self,
+        block_store: &mut BTreeMap<usize, Block>,
+        updates: &Vec<NormalizedActionItemRequestUpdate>,
+    ) -> Vec<NormalizedActionItemRequestUpdate> {
+        let mut filtered_updates = vec![];
+        let mut updated_blocks = vec![];
+        for update in updates.iter() {
+            let Some(keys) = self.action_items_index.get(&update.id) else {
+                continue;
+            };
+            for key in keys.iter() {
+                let Some(block) = block_store.get_mut(key) else {
+                    continue;
+                };
+                if block.apply_action_item_updates(update.clone()) {
+                    filtered_updates.push(update.clone());
+                    updated_blocks.push(*key);
+                }
+            }
+        }
+        updated_blocks.sort();
+        updated_blocks.dedup();
+        for key in updated_blocks.into_iter() {
+            if block_store.get(&key).map(is_block_completed).unwrap_or(false)
+                && !self.completed_blocks.contains(&key)
+            {
+                self.complete_block(block_store, key);
+            }
+        }
+        filtered_updates
+    }
+
+    fn complete_block(&mut self, block_store: &mut BTreeMap<usize, Block>, key: usize) {
+        self.completed_blocks.push_back(key);
+        while self.completed_blocks.len() > self.retention {
+            let Some(key) = self.completed_blocks.pop_front() else {
+                break;
+            };
+            let Some(block) = block_store.get_mut(&key) else {
+                continue;
+            };
+            if let Some(spill) = self.spill.as_mut() {
+                let res = serde_json::to_writer(&mut *spill, &block)
+                    .map_err(|e| e.to_string())
+                    .and_then(|_| spill.write_all(b"\n").map_err(|e| e.to_string()))
+                    .and_then(|_| spill.flush().map_err(|e| e.to_string()));
+                if let Err(e) = res {
+                    warn!("unable to spill block {} to disk: {}", block.uuid, e);
+                }
+            }
+            for group in panel_groups(&block.panel) {
+                for sub_group in group.sub_groups.iter() {
+                    for action_item in sub_group.action_items.iter() {
+                        if let Some(keys) = self.action_items_index.get_mut(&action_item.id) {
+                            keys.retain(|k| *k != key);
+                            if keys.is_empty() {
+                                self.action_items_index.remove(&action_item.id);
+                            }
+                        }
+                    }
+                }
+            }
+            compact_block(block);
+        }
+    }
+}
+
+fn panel_groups(panel: &Panel) -> &Vec<ActionGroup> {
+    match panel {
+        Panel::ActionPanel(data) => &data.groups,
+        Panel::ModalPanel(data) => &data.groups,
+        Panel::ErrorPanel(data) => &data.groups,
+    }
+}
+
+/// Action and modal panels are completed once all their action items succeeded, error panels
+/// remain in full detail.
+fn is_block_completed(block: &Block) -> bool {
+    let groups = match &block.panel {
+        Panel::ActionPanel(data) => &data.groups,
+        Panel::ModalPanel(data) => &data.groups,
+        Panel::ErrorPanel(_) => return false,
+    };
+    let mut action_items = groups
+        .iter()
+        .flat_map(|group| group.sub_groups.iter())
+        .flat_map(|sub_group| sub_group.action_items.iter())
+        .peekable();
+    action_items.peek().is_some()
+        && action_items.all(|item| matches!(item.action_status, ActionItemStatus::Success(_)))
+}
+
+fn compact_block(block: &mut Block) {
+    match &mut block.panel {
+        Panel::ActionPanel(data) => data.groups.clear(),
+        Panel::ModalPanel(data) => data.groups.clear(),
+        Panel::ErrorPanel(data) => data.groups.clear(),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::collections::BTreeMap;
+
+    use txtx_addon_kit::{
+        types::{
+            block_id::BlockId,
+            frontend::{
+                ActionGroup, ActionItemRequestType, ActionItemStatus, ActionSubGroup, Block,
+                NormalizedActionItemRequestUpdate, Panel,
+            },
+        },
+        uuid::Uuid,
+    };
+
+    use super::BlockStoreManager;
+
+    fn action_block(item_id: &BlockId) -> Block {
+        let mut item = ActionItemRequestType::ValidateModal.to_request("item", "validate");
+        item.id = item_id.clone();
+        let groups =
+            vec![ActionGroup::new("group", vec![ActionSubGroup::new(None, vec![item], false)])];
+        Block::new(&Uuid::new_v4(), Panel::new_action_panel("title", "description", groups))
+    }
+
+    fn success(item_id: &BlockId) -> NormalizedActionItemRequestUpdate {
+        NormalizedActionItemRequestUpdate {
+            id: item_id.clone(),
+            action_status: Some(ActionItemStatus::Success(None)),
+            action_type: None,
+        }
+    }
+
+    fn groups_len(block: &Block) -> usize {
+        match &block.panel {
+            Panel::ActionPanel(data) => data.groups.len(),
+            _ => unreachable!(),
+        }
+    }
+
+    #[test]
+    fn it_compacts_completed_blocks_past_the_retention_window() {
+        let mut block_store = BTreeMap::new();
+        let mut manager = BlockStoreManager::new(1, None).unwrap();
+        let ids = (0..3u8).map(|i| BlockId::new(&[i])).collect::<Vec<_>>();
+        for id in ids.iter() {
+            manager.insert(&mut block_store, action_block(id));
+        }
+
+        // completing the first block keeps it in full, within the retention window
+        let applied = manager.apply_action_item_updates(&mut block_store, &vec![success(&ids[0])]);
+        assert_eq!(applied.len(), 1);
+        assert_eq!(groups_len(&block_store[&0]), 1);
+
+        // completing the second block compacts the first one
+        manager.apply_action_item_updates(&mut block_store, &vec![success(&ids[1])]);
+        assert_eq!(block_store.len(), 3);
+        assert_eq!(groups_len(&block_store[&0]), 0);
+        assert_eq!(groups_len(&block_store[&1]), 1);
+        assert_eq!(groups_len(&block_store[&2]), 1);
+
+        // updates to compacted blocks are not applied
+        let applied = manager.apply_action_item_updates(&mut block_store, &vec![success(&ids[0])]);
+        assert!(applied.is_empty());
+
+        // keys are not reused after a clear
+        manager.clear(&mut block_store);
+        manager.insert(&mut block_store, action_block(&ids[2]));
+        assert_eq!(block_store.keys().collect::<Vec<_>>(), vec![&3]);
+    }
+}
@@ -8,6 +8,7 @@ use txtx_addon_kit::types::frontend::{
     ActionItemResponse, Block, BlockEvent, LogEvent, SupervisorAddonData,
 };
 
+pub mod block_store;
 pub mod mutation;
 pub mod query;
 pub mod subscription;
@@ -40,6 +40,7 @@ use txtx_core::runbook::RunbookTopLevelInputsMap;
 use txtx_core::start_supervised_runbook_runloop;
 use txtx_core::std::StdAddon;
 use txtx_core::types::{Runbook, RunbookSources};
+use txtx_gql::block_store::{BlockStoreManager, DEFAULT_BLOCK_RETENTION};
 use txtx_gql::Context as GqlContext;
 use txtx_gql::{new_graphql_schema, Context as GraphContext, GraphqlSchema};
 use txtx_supervisor_ui::cloud_relayer::{
@@ -375,6 +376,8 @@ pub async fn execute_runbook(
         channel::unbounded::<ActionItemRequest>();
     let (action_item_events_tx, action_item_events_rx) = tokio::sync::broadcast::channel(32);
     let block_store = Arc::new(RwLock::new(BTreeMap::new()));
+    let mut block_store_manager = BlockStoreManager::new(DEFAULT_BLOCK_RETENTION, None)
+        .map_err(|e| Box::<dyn StdError>::from(e))?;
     let log_store = Arc::new(RwLock::new(Vec::new()));
     let (kill_loops_tx, kill_loops_rx) = channel::bounded(1);
     let (relayer_channel_tx, relayer_channel_rx) = channel::unbounded();
@@ -447,38 +450,27 @@ pub async fn execute_runbook(
                 let mut do_propagate_event = true;
                 match block_event.clone() {
                     BlockEvent::Action(new_block) => {
-                        let len = block_store.len();
-                        block_store.insert(len, new_block.clone());
+                        block_store_manager.insert(&mut block_store, new_block);
                     }
                     BlockEvent::Clear => {
-                        *block_store = BTreeMap::new();
+                        block_store_manager.clear(&mut block_store);
                     }
                     BlockEvent::UpdateActionItems(updates) => {
                         // for action item updates, track if we actually changed anything before propagating the event
-                        do_propagate_event = false;
-                        let mut filtered_updates = vec![];
-                        for update in updates.iter() {
-                            for (_, block) in block_store.iter_mut() {
-                                let did_update = block.apply_action_item_updates(update.clone());
-                                if did_update {
-                                    do_propagate_event = true;
-                                    filtered_updates.push(update.clone());
-                                }
-                            }
-                        }
+                        let filtered_updates = block_store_manager
+                            .apply_action_item_updates(&mut block_store, &updates);
+                        do_propagate_event = !filtered_updates.is_empty();
                         block_event = BlockEvent::UpdateActionItems(filtered_updates);
                     }
                     BlockEvent::Modal(new_block) => {
-                        let len = block_store.len();
-                        block_store.insert(len, new_block.clone());
+                        block_store_manager.insert(&mut block_store, new_block);
                     }
                     BlockEvent::RunbookCompleted(_) => {
                         println!("\n{}", green!("Runbook complete!"));
                         break;
                     }
                     BlockEvent::Error(new_block) => {
-                        let len = block_store.len();
-                        block_store.insert(len, new_block.clone());
+                        block_store_manager.insert(&mut block_store, new_block);
                     }
                     BlockEvent::Exit => break,
                     BlockEvent::LogEvent(log) => {
@@ -256,6 +256,17 @@ pub fn setup_test(
     file_name: &str,
     fixture: &str,
     get_addon_by_namespace: fn(&str) -> Option<Box<dyn Addon>>,
+) -> TestHarness {
+    setup_test_with_queued_responses(file_name, fixture, get_addon_by_namespace, &[])
+}
+
+/// Sets up a test whose `queued_responses` are sent before the runloop starts: they are drained
+/// at once by its first iteration, as a burst of responses submitted by a frontend would be.
+pub fn setup_test_with_queued_responses(
+    file_name: &str,
+    fixture: &str,
+    get_addon_by_namespace: fn(&str) -> Option<Box<dyn Addon>>,
+    queued_responses: &[ActionItemResponse],
 ) -> TestHarness {
     let future = build_runbook_from_fixture(file_name, fixture, get_addon_by_namespace);
     let mut runbook = block_on(future).expect("unable to build runbook from fixture");
@@ -272,6 +283,9 @@ pub fn setup_test(
         action_item_events_tx: action_item_events_tx.clone(),
         action_item_events_rx: action_item_events_rx.resubscribe(),
     };
+    for response in queued_responses.iter() {
+        harness.send(response);
+    }
     let _ = hiro_system_kit::thread_named("Runbook Runloop").spawn(move || {
         let runloop_future =
             start_supervised_runbook_runloop(&mut runbook, block_tx, action_item_events_rx);
@@ -0,0 +1,182 @@
+//! Transactions confirmed over the `rpc_ws_url` websocket of a local node.
+//!
+//! These tests start their node and are ignored by default, run them with:
+//! `cargo test -p txtx-test-utils --test websocket_confirmations -- --ignored`
+//! with `anvil` (EVM), `solana-test-validator` and `solana-keygen` (SVM) in the path.
+
+use std::collections::HashMap;
+use std::net::TcpStream;
+use std::process::{Child, Command, Stdio};
+use std::thread::sleep;
+use std::time::{Duration, Instant};
+
+use txtx_addon_kit::types::frontend::{BlockEvent, LogEvent, LogLevel};
+use txtx_addon_kit::types::types::Value;
+use txtx_addon_kit::Addon;
+use txtx_addon_network_evm::EvmNetworkAddon;
+use txtx_addon_network_svm::SvmNetworkAddon;
+use txtx_core::start_unsupervised_runbook_runloop;
+use txtx_test_utils::test_harness::build_runbook_from_fixture;
+use txtx_test_utils::StdAddon;
+
+fn get_addon_by_namespace(namespace: &str) -> Option<Box<dyn Addon>> {
+    let available_addons: Vec<Box<dyn Addon>> = vec![
+        Box::new(StdAddon::new()),
+        Box::new(EvmNetworkAddon::new()),
+        Box::new(SvmNetworkAddon::new()),
+    ];
+    available_addons.into_iter().find(|addon| addon.get_namespace() == namespace)
+}
+
+/// A local node, killed when dropped.
+struct LocalNode(Child);
+
+impl LocalNode {
+    fn spawn(program: &str, args: &[&str], rpc_port: u16) -> Self {
+        let child = Command::new(program)
+            .args(args)
+            .stdout(Stdio::null())
+            .stderr(Stdio::null())
+            .spawn()
+            .unwrap_or_else(|e| panic!("unable to start {}: {}", program, e));
+        let node = LocalNode(child);
+        let started_at = Instant::now();
+        while TcpStream::connect(("127.0.0.1", rpc_port)).is_err() {
+            assert!(started_at.elapsed() < Duration::from_secs(60), "{} did not start", program);
+            sleep(Duration::from_millis(200));
+        }
+        node
+    }
+}
+
+impl Drop for LocalNode {
+    fn drop(&mut self) {
+        let _ = self.0.kill();
+        let _ = self.0.wait();
+    }
+}
+
+/// Runs the runbook unsupervised, and returns the outputs of the action `action_name` with the
+/// warnings logged during the run.
+fn run_runbook(fixture: &str, action_name: &str) -> (HashMap<String, Value>, Vec<String>) {
+    let mut runbook = hiro_system_kit::nestable_block_on(build_runbook_from_fixture(
+        "confirmations.tx",
+        fixture,
+        get_addon_by_namespace,
+    ))
+    .expect("unable to build runbook from fixture");
+    runbook.enable_full_execution_mode();
+    let (progress_tx, progress_rx) = txtx_addon_kit::channel::unbounded();
+    hiro_system_kit::nestable_block_on(start_unsupervised_runbook_runloop(
+        &mut runbook,
+        &progress_tx,
+    ))
+    .expect("unable to execute runbook");
+
+    let warnings = progress_rx
+        .try_iter()
+        .filter_map(|event| match event {
+            BlockEvent::LogEvent(LogEvent::Static(log)) if log.level == LogLevel::Warn => {
+                Some(format!("{}: {}", log.details.summary, log.details.message))
+            }
+            _ => None,
+        })
+        .collect();
+
+    let execution_context = &runbook.flow_contexts[0].execution_context;
+    let (action_did, _) = execution_context
+        .commands_instances
+        .iter()
+        .find(|(_, command_instance)| command_instance.name == action_name)
+        .unwrap();
+    let outputs = execution_context
+        .commands_execution_results
+        .get(action_did)
+        .expect("action not executed")
+        .outputs
+        .clone();
+    (outputs, warnings)
+}
+
+#[test]
+#[ignore = "requires anvil"]
+fn evm_transaction_is_confirmed_over_websocket() {
+    let _anvil = LocalNode::spawn("anvil", &["--port", "18545", "--block-time", "1"], 18545);
+    let fixture = r#"
+addon "evm" {
+    chain_id = 31337
+    rpc_api_url = "http://127.0.0.1:18545"
+    rpc_ws_url = "ws://127.0.0.1:18545"
+}
+signer "alice" "evm::secret_key" {
+    secret_key = "0xac0974bec39a17e36ba4a6b4d238ff944bacb478cbed5efcae784d7bf4f2ff80"
+}
+action "transfer" "evm::send_eth" {
+    recipient_address = "0x70997970C51812dc3A010C7d01b50e0d17dc79C8"
+    amount = 1000
+    signer = signer.alice
+    confirmations = 2
+}
+"#;
+    let (outputs, warnings) = run_runbook(fixture, "transfer");
+    assert!(outputs.contains_key("tx_hash"));
+    // the confirmations were not polled for lack of a websocket connection
+    assert!(warnings.is_empty(), "{:?}", warnings);
+}
+
+#[test]
+#[ignore = "requires solana-test-validator and solana-keygen"]
+fn svm_transaction_is_confirmed_over_websocket() {
+    let ledger = std::env::temp_dir().join(format!("txtx-ws-confirmations-{}", std::process::id()));
+    let payer_keypair = ledger.with_extension("json");
+    let status = Command::new("solana-keygen")
+        .args(["new", "--no-bip39-passphrase", "--silent", "--force", "--outfile"])
+        .arg(&payer_keypair)
+        .status()
+        .expect("unable to start solana-keygen");
+    assert!(status.success());
+    let payer = String::from_utf8(
+        Command::new("solana-keygen")
+            .arg("pubkey")
+            .arg(&payer_keypair)
+            .output()
+            .expect("unable to start solana-keygen")
+            .stdout,
+    )
+    .unwrap()
+    .trim()
+    .to_string();
+
+    // the payer is funded at genesis, the websocket is served on the rpc port + 1
+    let ledger_path = ledger.to_string_lossy().to_string();
+    let validator = LocalNode::spawn(
+        "solana-test-validator",
+        &["--reset", "--quiet", "--rpc-port", "18899", "--ledger", &ledger_path, "--mint", &payer],
+        18899,
+    );
+    let fixture = format!(
+        r#"
+addon "svm" {{
+    network_id = "localnet"
+    rpc_api_url = "http://127.0.0.1:18899"
+    rpc_ws_url = "ws://127.0.0.1:18900"
+}}
+signer "payer" "svm::secret_key" {{
+    keypair_json = "{}"
+}}
+action "transfer" "svm::send_sol" {{
+    amount = 1000000
+    recipient = "{}"
+    signer = signer.payer
+}}
+"#,
+        payer_keypair.display(),
+        payer
+    );
+    let (outputs, warnings) = run_runbook(&fixture, "transfer");
+    drop(validator);
+    let _ = std::fs::remove_dir_all(&ledger);
+    let _ = std::fs::remove_file(&payer_keypair);
+    assert!(outputs.contains_key("signature"));
+    assert!(warnings.is_empty(), "{:?}", warnings);
+}